@@ -1,8 +1,29 @@
 #include <iostream>
 
 #include "pimpl/sentence.hpp"
+#include "pimpl/stream.hpp"
 
 int main(int argc, char** argv)
 {
     std::cout << "Hello Logic" << std::endl;
+
+    if (argc < 2) {
+        return 0;
+    }
+
+    // One sentence per line, each is handed over as soon as its line is parsed
+    auto summary = pimpl::parse_file(argv[1], [argv](size_t line, std::optional<pimpl::Sentence> sentence) {
+        if (!sentence) {
+            std::cerr << argv[1] << ":" << line << ": parse error" << std::endl;
+        }
+        return true;
+    });
+
+    if (!summary) {
+        std::cerr << "file '" << argv[1] << "' not found" << std::endl;
+        return 1;
+    }
+
+    std::cout << summary->sentences << " sentences, " << summary->errors << " errors" << std::endl;
+    return summary->errors == 0 ? 0 : 2;
 }
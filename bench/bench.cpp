@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lexy/action/parse.hpp"
+#include "lexy/input/string_input.hpp"
+
+#include "pimpl/compiled_sentence.hpp"
+#include "pimpl/parsing.hpp"
+#include "pimpl/sentence.hpp"
+#include "pimpl/stream.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocation counting, every global new in the process goes through here
+
+namespace
+{
+
+std::atomic<uint64_t> allocations = 0;
+
+void* counted_new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+}   // namespace
+
+void* operator new(size_t size) { return counted_new(size); }
+void* operator new[](size_t size) { return counted_new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+using namespace pimpl;
+
+// Keep the compiler from dropping a result that is never used
+template <typename T>
+void keep(const T& value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+struct Options
+{
+    std::string filter;
+    std::string json;
+    double min_time = 0.2;
+};
+
+// Benchmark parameters by name, numbers are written to JSON as numbers
+using Params = std::map<std::string, std::string>;
+
+struct Result
+{
+    std::string name;
+    Params params;
+    uint64_t iterations;
+    double ns_per_op;
+    double nodes_per_sec;
+    double allocs_per_op;
+};
+
+class Harness
+{
+public:
+    explicit Harness(Options options) : options_(std::move(options)) {}
+
+    // Time fn() until at least min_time has passed, nodes is the size of the input one call works on
+    void run(const std::string& name, const Params& params, size_t nodes,
+             const std::function<void()>& fn)
+    {
+        std::string full = name;
+        for (const auto& [key, value] : params) {
+            full += "/" + key + ":" + value;
+        }
+        if (full.find(options_.filter) == std::string::npos) {
+            return;
+        }
+
+        using clock = std::chrono::steady_clock;
+        fn();   // warm up caches and lazily built state
+
+        uint64_t iterations = 1;
+        while (true) {
+            const uint64_t allocs = allocations.load(std::memory_order_relaxed);
+            const auto start = clock::now();
+            for (uint64_t i = 0; i < iterations; ++i) {
+                fn();
+            }
+            const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+            const uint64_t allocated = allocations.load(std::memory_order_relaxed) - allocs;
+
+            if (elapsed >= options_.min_time || iterations >= (uint64_t(1) << 40)) {
+                const double ns = elapsed * 1e9 / iterations;
+                results_.push_back({name, params, iterations, ns, nodes * 1e9 / ns, double(allocated) / iterations});
+                print(full, results_.back());
+                return;
+            }
+            // aim a little past min_time on the next round
+            const double scale = elapsed > 0 ? 1.4 * options_.min_time / elapsed : 100;
+            iterations = std::max(iterations + 1, uint64_t(iterations * std::min(scale, 100.0)));
+        }
+    }
+
+    bool write_json() const
+    {
+        if (options_.json.empty()) {
+            return true;
+        }
+        std::ofstream file;
+        if (options_.json != "-") {
+            file.open(options_.json);
+            if (!file) {
+                return false;
+            }
+        }
+        std::ostream& out = options_.json == "-" ? std::cout : file;
+
+        out << "{\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const auto& r = results_[i];
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << r.name << "\", \"params\": {";
+            bool first = true;
+            for (const auto& [key, value] : r.params) {
+                const bool number = !value.empty() && value.find_first_not_of("0123456789") == std::string::npos;
+                out << (first ? "" : ", ") << "\"" << key << "\": " << (number ? value : "\"" + value + "\"");
+                first = false;
+            }
+            out << "}, \"iterations\": " << r.iterations
+                << ", \"ns_per_op\": " << r.ns_per_op
+                << ", \"nodes_per_sec\": " << r.nodes_per_sec
+                << ", \"allocs_per_op\": " << r.allocs_per_op << "}";
+        }
+        out << "\n  ]\n}\n";
+        return bool(out);
+    }
+
+private:
+    static void print(const std::string& name, const Result& r)
+    {
+        std::cerr << std::left << std::setw(56) << name << std::right
+                  << std::setw(14) << std::fixed << std::setprecision(1) << r.ns_per_op << " ns/op"
+                  << std::setw(14) << std::setprecision(0) << r.nodes_per_sec << " nodes/s"
+                  << std::setw(12) << std::setprecision(1) << r.allocs_per_op << " allocs/op" << std::endl;
+    }
+
+    Options options_;
+    std::vector<Result> results_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Formula generators, zero symbols gives a formula of T and F only
+
+enum class Shape
+{
+    BALANCED,   // random operators, depth about log2(operators)
+    CHAIN,      // a0 <=> a1 <=> ..., left-deep with depth equal to the number of operators
+};
+
+const char* shape_name(Shape shape)
+{
+    return shape == Shape::BALANCED ? "balanced" : "chain";
+}
+
+std::string leaf(size_t symbols, std::mt19937& rng)
+{
+    std::string s = rng() % 4 == 0 ? "~" : "";
+    if (symbols == 0) {
+        return s + (rng() % 2 ? "T" : "F");
+    }
+    return s + "s" + std::to_string(rng() % symbols);
+}
+
+std::string balanced(size_t ops, size_t symbols, std::mt19937& rng)
+{
+    if (ops == 0) {
+        return leaf(symbols, rng);
+    }
+    static const char* names[] = {" & ", " | ", " => ", " <=> "};
+    const size_t left = (ops - 1) / 2;
+    return "(" + balanced(left, symbols, rng) + names[rng() % 4] + balanced(ops - 1 - left, symbols, rng) + ")";
+}
+
+std::string formula(Shape shape, size_t ops, size_t symbols, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    if (shape == Shape::BALANCED) {
+        return balanced(ops, symbols, rng);
+    }
+    std::string text = leaf(symbols, rng);
+    for (size_t i = 0; i < ops; ++i) {
+        text += " <=> " + leaf(symbols, rng);
+    }
+    return text;
+}
+
+// Number of positions in the tree, shared leaves are counted every time they appear
+size_t tree_size(const Sentence& sentence)
+{
+    size_t count = 0;
+    std::vector<const Sentence::sentence_t*> stack{sentence.data().get()};
+    while (!stack.empty()) {
+        const auto* s = stack.back();
+        stack.pop_back();
+        ++count;
+        std::visit([&stack](const auto& n) {
+            if constexpr (requires { n.left; }) {
+                stack.push_back(n.left.get());
+            }
+            if constexpr (requires { n.right; }) {
+                stack.push_back(n.right.get());
+            }
+        }, *s);
+    }
+    return count;
+}
+
+ast::abstract_ptr parse_ast(const std::string& text)
+{
+    auto input = lexy::string_input<lexy::utf8_encoding>(text.data(), text.size());
+    auto result = lexy::parse<grammar::GrammarSentence>(input, lexy::noop);
+    if (!result.is_success() || result.value().size() != 1) {
+        std::cerr << "benchmark formula failed to parse" << std::endl;
+        std::exit(1);
+    }
+    return result.value().front();
+}
+
+void benchmarks(Harness& harness)
+{
+    constexpr size_t SIZES[] = {15, 255, 4095, 65535};
+    constexpr size_t SYMBOLS[] = {4, 64};
+
+    for (auto shape : {Shape::BALANCED, Shape::CHAIN}) {
+        for (size_t ops : SIZES) {
+            // constants only, for truth()
+            {
+                const auto text = formula(shape, ops, 0, 1);
+                const auto sentence = ast::toSentence(parse_ast(text));
+                const Params params{{"shape", shape_name(shape)}, {"ops", std::to_string(ops)}, {"symbols", "0"}};
+                harness.run("truth", params, tree_size(sentence), [&] { keep(sentence.truth()); });
+            }
+
+            for (size_t symbols : SYMBOLS) {
+                const auto text = formula(shape, ops, symbols, 2);
+                const auto tree = parse_ast(text);
+                const auto sentence = ast::toSentence(tree);
+                const auto copy = ast::toSentence(parse_ast(text));
+                const size_t nodes = tree_size(sentence);
+                const Params params{{"shape", shape_name(shape)}, {"ops", std::to_string(ops)},
+                                    {"symbols", std::to_string(symbols)}};
+
+                harness.run("parse_ast", params, nodes, [&] { keep(parse_ast(text)); });
+                harness.run("to_sentence", params, nodes, [&] { keep(ast::toSentence(tree)); });
+                harness.run("parse_sentence", params, nodes, [&] { keep(parse_sentence(text)); });
+
+                std::mt19937 rng(3);
+                const size_t width = sentence.symbol_names().size();
+                std::unique_ptr<bool[]> values(new bool[width]);
+                std::unordered_map<std::string, bool> by_name;
+                for (size_t i = 0; i < width; ++i) {
+                    values[i] = rng() % 2;
+                    by_name[sentence.symbol_names()[i]] = values[i];
+                }
+                const std::span<const bool> span(values.get(), width);
+
+                harness.run("evaluate_map", params, nodes, [&] { keep(sentence.evaluate(by_name)); });
+                harness.run("evaluate_ids", params, nodes, [&] { keep(sentence.evaluate_ids(span)); });
+                const CompiledSentence compiled(sentence);
+                harness.run("evaluate_compiled", params, nodes, [&] { keep(compiled.evaluate(span)); });
+
+                harness.run("compare", params, nodes, [&] { keep(*sentence.data() == *copy.data()); });
+            }
+        }
+    }
+}
+
+void usage(const char* argv0)
+{
+    std::cerr << "usage: " << argv0 << " [--filter substring] [--min-time seconds] [--json file|-]" << std::endl;
+}
+
+}   // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--filter") {
+            options.filter = argv[++i];
+        } else if (i + 1 < argc && arg == "--min-time") {
+            options.min_time = std::atof(argv[++i]);
+        } else if (i + 1 < argc && arg == "--json") {
+            options.json = argv[++i];
+        } else {
+            usage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Harness harness(options);
+    benchmarks(harness);
+
+    if (!harness.write_json()) {
+        std::cerr << "couldn't write '" << options.json << "'" << std::endl;
+        return 1;
+    }
+    return 0;
+}
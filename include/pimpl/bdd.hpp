@@ -0,0 +1,172 @@
+#ifndef __PIMPL__BDD_HPP__
+#define __PIMPL__BDD_HPP__
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "pimpl/node_store.hpp"
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+class BddManager;
+
+// Reference to a function owned by a BddManager
+// Keeps the nodes of the function alive across garbage collection and reordering.
+// A Bdd must not outlive its manager.
+class Bdd
+{
+public:
+    Bdd() = default;
+    Bdd(const Bdd& other);
+    Bdd(Bdd&& other) noexcept;
+    Bdd& operator=(Bdd other) noexcept;
+    ~Bdd();
+
+    bool valid() const { return manager_ != nullptr; }
+    bool is_true() const;
+    bool is_false() const;
+
+    // Functions are canonical, so equivalence is a single comparison
+    bool operator==(const Bdd& rhs) const;
+
+private:
+    friend class BddManager;
+
+    Bdd(BddManager* manager, uint32_t root) : manager_(manager), root_(root) {}
+
+    BddManager* manager_ = nullptr;
+    uint32_t root_ = 0;     // slot in the manager's root table
+};
+
+// Reduced ordered binary decision diagrams with complement edges
+// Nodes are hash-consed in a unique table, and ite() results are memoized in a direct-mapped
+// computed table, so every function has exactly one representation for a given variable order.
+// Unreferenced nodes are collected once the table has doubled since the last collection.
+class BddManager
+{
+public:
+    explicit BddManager(size_t cache_size = 1 << 16);
+
+    BddManager(const BddManager&) = delete;
+    BddManager& operator=(const BddManager&) = delete;
+
+    Bdd constant(bool value);
+    Bdd variable(std::string_view name);
+
+    // Build the function of a sentence
+    // Variables for new symbols are placed in depth-first order of their first occurrence
+    // Returns std::nullopt if the sentence is empty or malformed
+    std::optional<Bdd> build(const Sentence& sentence);
+
+    Bdd ite(const Bdd& f, const Bdd& g, const Bdd& h);
+    Bdd negate(const Bdd& f);
+    // op is one of the binary node kinds
+    Bdd apply(NodeStore::Kind op, const Bdd& f, const Bdd& g);
+    // Cofactor of f with the variable fixed to value, f itself if there is no such variable
+    Bdd restrict(const Bdd& f, std::string_view name, bool value);
+
+    // Number of assignments to all variables of the manager that make f true
+    double sat_count(const Bdd& f) const;
+    // values holds one value per variable
+    std::optional<bool> evaluate(const Bdd& f, std::span<const bool> values) const;
+    // Nodes reachable from f, the terminal included
+    size_t node_count(const Bdd& f) const;
+
+    size_t num_vars() const { return var_names_.size(); }
+    const std::string& var_name(uint32_t var) const { return var_names_[var]; }
+    std::optional<uint32_t> find_var(std::string_view name) const;
+    uint32_t level(uint32_t var) const { return levels_[var]; }
+    // Variable at every level, from the root down
+    const std::vector<uint32_t>& order() const { return order_; }
+
+    // Nodes in the unique table, including unreferenced ones until the next collection
+    size_t size() const { return nodes_.size(); }
+
+    void collect_garbage();
+
+    // Rebuild every referenced function with order[i] as the variable at level i
+    // Returns false if order isn't a permutation of the variables
+    bool reorder(std::span<const uint32_t> order);
+
+    // Move each variable to the level that minimizes the number of live nodes
+    // Every candidate position is evaluated by a full rebuild, so this is meant for tens of variables
+    void sift();
+
+private:
+    friend class Bdd;
+
+    // An edge is a node index shifted left once, with the low bit set for complemented edges
+    using edge_t = uint32_t;
+    static constexpr edge_t TRUE = 0;
+    static constexpr edge_t FALSE = 1;
+    static constexpr uint32_t TERMINAL = UINT32_MAX;
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    // The high edge is never complemented, which keeps complement edges canonical
+    struct Node
+    {
+        uint32_t var;
+        edge_t high;
+        edge_t low;
+
+        bool operator==(const Node&) const = default;
+    };
+
+    struct CacheEntry
+    {
+        edge_t f = EMPTY;
+        edge_t g = EMPTY;
+        edge_t h = EMPTY;
+        edge_t result = EMPTY;
+    };
+
+    struct Root
+    {
+        edge_t edge;
+        uint32_t refs;
+    };
+
+    struct StringHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    uint32_t new_var(std::string_view name);
+    uint32_t edge_level(edge_t e) const;
+
+    edge_t make(uint32_t var, edge_t high, edge_t low);
+    void rehash(size_t capacity);
+    static size_t hash(const Node& node);
+
+    edge_t ite(edge_t f, edge_t g, edge_t h);
+    edge_t restrict(edge_t f, uint32_t level, bool value, std::unordered_map<edge_t, edge_t>& done);
+
+    Bdd wrap(edge_t e);
+    void release(uint32_t root);
+
+    std::vector<Node> nodes_;           // node 0 is the terminal, children precede parents
+    std::vector<uint32_t> table_;       // open addressing, EMPTY marks an empty slot
+    std::vector<CacheEntry> cache_;
+
+    std::vector<Root> roots_;
+    std::vector<uint32_t> free_roots_;
+    size_t gc_threshold_;
+
+    std::vector<std::string> var_names_;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> var_ids_;
+    std::vector<uint32_t> levels_;      // level of every variable
+    std::vector<uint32_t> order_;       // variable at every level
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__BDD_HPP__
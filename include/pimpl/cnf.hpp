@@ -0,0 +1,118 @@
+#ifndef __PIMPL__CNF_HPP__
+#define __PIMPL__CNF_HPP__
+
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "pimpl/node_store.hpp"
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+// A literal is a variable and a sign packed as 2 * var + negated
+using lit_t = uint32_t;
+
+inline constexpr lit_t make_lit(uint32_t var, bool negated = false) { return 2 * var + negated; }
+inline constexpr uint32_t lit_var(lit_t lit) { return lit >> 1; }
+inline constexpr bool lit_negated(lit_t lit) { return lit & 1; }
+inline constexpr lit_t lit_not(lit_t lit) { return lit ^ 1; }
+
+// Clauses stored back to back in one flat literal array
+struct Cnf
+{
+    uint32_t num_vars = 0;
+    // Variables [0, num_symbols) are symbols, the rest are auxiliary variables
+    uint32_t num_symbols = 0;
+
+    std::vector<lit_t> literals;
+    // Clause i is literals[clause_starts[i], clause_starts[i + 1])
+    std::vector<uint32_t> clause_starts{0};
+
+    size_t size() const { return clause_starts.size() - 1; }
+
+    std::span<const lit_t> clause(size_t i) const
+    {
+        return std::span(literals).subspan(clause_starts[i], clause_starts[i + 1] - clause_starts[i]);
+    }
+
+    void add_clause(std::span<const lit_t> clause)
+    {
+        literals.insert(literals.end(), clause.begin(), clause.end());
+        clause_starts.push_back(literals.size());
+    }
+
+    void add_clause(std::initializer_list<lit_t> clause)
+    {
+        add_clause(std::span<const lit_t>(clause.begin(), clause.size()));
+    }
+};
+
+enum class CnfEncoding
+{
+    // Only the implications a node's polarity needs, preserves satisfiability
+    PLAISTED_GREENBAUM,
+    // Full equivalences, every model of the sentence extends to exactly one model of the CNF
+    TSEITIN,
+};
+
+namespace cnf
+{
+
+constexpr uint8_t POSITIVE = 1;
+constexpr uint8_t NEGATIVE = 2;
+constexpr uint8_t BOTH = POSITIVE | NEGATIVE;
+
+// Emit the clauses of x <=> (a op b) for a binary node kind, limited to the given polarity
+// (POSITIVE emits x => (a op b), NEGATIVE emits (a op b) => x)
+// add_clause is called with a std::initializer_list<lit_t> per clause
+template <typename AddClause>
+void define(NodeStore::Kind kind, lit_t x, lit_t a, lit_t b, uint8_t polarity, AddClause&& add_clause)
+{
+    const lit_t nx = lit_not(x);
+    const lit_t na = lit_not(a);
+    const lit_t nb = lit_not(b);
+    const bool pos = polarity & POSITIVE;
+    const bool neg = polarity & NEGATIVE;
+
+    switch (kind) {
+        case NodeStore::Kind::AND:
+            if (pos) { add_clause({nx, a}); add_clause({nx, b}); }
+            if (neg) { add_clause({x, na, nb}); }
+            break;
+        case NodeStore::Kind::OR:
+            if (pos) { add_clause({nx, a, b}); }
+            if (neg) { add_clause({x, na}); add_clause({x, nb}); }
+            break;
+        case NodeStore::Kind::IMP:
+            if (pos) { add_clause({nx, na, b}); }
+            if (neg) { add_clause({x, a}); add_clause({x, nb}); }
+            break;
+        case NodeStore::Kind::IFF:
+            if (pos) { add_clause({nx, na, b}); add_clause({nx, a, nb}); }
+            if (neg) { add_clause({x, a, b}); add_clause({x, na, nb}); }
+            break;
+        default:
+            break;
+    }
+}
+
+}   // namespace cnf
+
+// Encode the node root of a store, variable i < store.symbol_count() is symbol id i of the store
+// The last clause is the unit clause asserting the root
+Cnf to_cnf(const NodeStore& store, NodeStore::node_id_t root,
+           CnfEncoding encoding = CnfEncoding::PLAISTED_GREENBAUM);
+
+// Encode a sentence, variable i < sentence.symbol_names().size() is symbol id i of the sentence
+// With negate the root is asserted false instead, e.g. to search for a counterexample
+// Returns std::nullopt if the sentence is empty or malformed
+std::optional<Cnf> to_cnf(const Sentence& sentence,
+                          CnfEncoding encoding = CnfEncoding::PLAISTED_GREENBAUM, bool negate = false);
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__CNF_HPP__
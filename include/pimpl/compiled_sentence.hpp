@@ -0,0 +1,72 @@
+#ifndef __PIMPL__COMPILED_SENTENCE_HPP__
+#define __PIMPL__COMPILED_SENTENCE_HPP__
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+// A Sentence flattened into a linear program for an accumulator machine
+// Symbols are read from dense slots (Sentence symbol ids) instead of being substituted into the tree,
+// and &, |, => jump straight past their right hand side when the left hand side decides the result.
+// <=> always needs both sides, so its left value is saved on a small stack instead.
+// Operators referenced from more than one place (a DAG built through shared_ptr) are compiled once,
+// after the main program, as a subroutine that caches its value for the rest of the evaluation.
+// The program therefore stays linear in the number of distinct nodes rather than the tree size.
+class CompiledSentence
+{
+public:
+    enum class Op : uint8_t
+    {
+        LOAD_SYMBOL,    // acc = values[arg]
+        LOAD_BOOL,      // acc = arg
+        INVALID,        // unsubstituted symbol or monostate, evaluation fails
+        NOT,            // acc = !acc
+        JUMP_FALSE,     // if !acc, pc = arg
+        JUMP_TRUE,      // if acc, pc = arg
+        PUSH,           // push acc
+        IFF,            // acc = (pop == acc)
+        CALL,           // acc = cached value of subroutine arg, running it first if needed
+        RETURN,         // cache acc as the value of subroutine arg, return to the caller
+    };
+
+    struct Instruction
+    {
+        Op op;
+        uint32_t arg;
+    };
+
+    CompiledSentence() = default;
+    explicit CompiledSentence(const Sentence& sentence);
+
+    // Evaluate with one value per symbol slot
+    // Returns std::nullopt if the number of values is wrong or the sentence is malformed
+    std::optional<bool> evaluate(std::span<const bool> values) const;
+
+    // Same as Sentence::evaluate(), values are looked up by name once and then run as slots
+    std::optional<bool> evaluate(const std::unordered_map<std::string, bool>& symbol_values) const;
+
+    const std::vector<std::string>& symbols() const { return symbols_; }
+    std::optional<uint32_t> slot(std::string_view symbol) const;
+
+    const std::vector<Instruction>& program() const { return program_; }
+
+private:
+    std::vector<Instruction> program_;
+    std::vector<std::string> symbols_;
+    std::vector<uint32_t> entries_;     // first instruction of every subroutine
+    size_t main_end_ = 0;               // the main program is followed by the subroutines
+    size_t max_stack_ = 0;
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__COMPILED_SENTENCE_HPP__
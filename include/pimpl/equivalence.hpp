@@ -0,0 +1,50 @@
+#ifndef __PIMPL__EQUIVALENCE_HPP__
+#define __PIMPL__EQUIVALENCE_HPP__
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+struct EquivalenceResult
+{
+    bool holds = false;
+    // Union of the symbols of both sentences, sorted by name
+    std::vector<std::string> symbols;
+    // When the relation doesn't hold, one value per entry of symbols under which it fails
+    std::optional<std::vector<bool>> counterexample;
+};
+
+struct EquivalenceStats
+{
+    enum class Stage
+    {
+        STRUCTURE,      // identical after hash-consing and operand normalization
+        SIMULATION,     // simulation found a counterexample, or covered every assignment
+        SAT,            // decided by the miter
+    };
+
+    Stage decided_by = Stage::STRUCTURE;
+    uint64_t simulated_words = 0;   // 64 assignments each
+};
+
+// Check if a and b are true under exactly the same assignments
+// Both sentences are hash-consed into one store, with the operands of commutative operators ordered
+// and double negations dropped, so structurally equal sentences are answered without search.
+// Otherwise a few hundred random assignments are simulated 64 at a time, which refutes most
+// non-equivalent pairs, and only then is the miter ~(a <=> b) handed to the SAT solver.
+// Returns std::nullopt if either sentence is empty or malformed
+std::optional<EquivalenceResult> equivalent(const Sentence& a, const Sentence& b, EquivalenceStats* stats = nullptr);
+
+// Check if b is true under every assignment that makes a true, in the same three stages with a & ~b
+// as the miter
+std::optional<EquivalenceResult> implies(const Sentence& a, const Sentence& b, EquivalenceStats* stats = nullptr);
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__EQUIVALENCE_HPP__
@@ -0,0 +1,128 @@
+#ifndef __PIMPL__GENERATOR_HPP__
+#define __PIMPL__GENERATOR_HPP__
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <utility>
+
+namespace pimpl
+{
+
+// Lazy input range backed by a coroutine, a stand-in for C++23 std::generator
+// until the standard library ships it. The coroutine runs up to each co_yield when the
+// range is advanced, and the yielded value is referenced in place, never copied.
+// A generator can be iterated once, and is a view, so it composes with std::views.
+template <typename T>
+class Generator : public std::ranges::view_interface<Generator<T>>
+{
+public:
+    struct promise_type
+    {
+        const T* value = nullptr;
+        std::exception_ptr exception;
+
+        Generator get_return_object() { return Generator(handle_t::from_promise(*this)); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        std::suspend_always final_suspend() const noexcept { return {}; }
+
+        // a temporary lives until the end of the co_yield expression, which outlasts the suspension
+        std::suspend_always yield_value(const T& v) noexcept
+        {
+            value = std::addressof(v);
+            return {};
+        }
+
+        void return_void() const noexcept {}
+        void unhandled_exception() { exception = std::current_exception(); }
+
+        // only co_yield is meaningful in a generator
+        template <typename U>
+        std::suspend_never await_transform(U&&) = delete;
+    };
+
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    class iterator
+    {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+
+        const T& operator*() const { return *handle_.promise().value; }
+        const T* operator->() const { return handle_.promise().value; }
+
+        iterator& operator++()
+        {
+            advance(handle_);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const { return handle_ == nullptr || handle_.done(); }
+
+    private:
+        friend class Generator;
+        explicit iterator(handle_t handle) : handle_(handle) {}
+
+        handle_t handle_ = nullptr;
+    };
+
+    Generator() = default;
+    Generator(Generator&& other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr)), started_(other.started_) {}
+    Generator& operator=(Generator&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+            started_ = other.started_;
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() { reset(); }
+
+    // Runs the coroutine up to its first co_yield
+    iterator begin()
+    {
+        if (handle_ != nullptr && !started_) {
+            started_ = true;
+            advance(handle_);
+        }
+        return iterator(handle_);
+    }
+    std::default_sentinel_t end() const { return std::default_sentinel; }
+
+private:
+    explicit Generator(handle_t handle) : handle_(handle) {}
+
+    static void advance(handle_t handle)
+    {
+        handle.resume();
+        if (handle.promise().exception) {
+            std::rethrow_exception(std::exchange(handle.promise().exception, nullptr));
+        }
+    }
+
+    void reset()
+    {
+        if (handle_ != nullptr) {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    handle_t handle_ = nullptr;
+    bool started_ = false;
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__GENERATOR_HPP__
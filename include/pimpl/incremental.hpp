@@ -0,0 +1,64 @@
+#ifndef __PIMPL__INCREMENTAL_HPP__
+#define __PIMPL__INCREMENTAL_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "pimpl/node_store.hpp"
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+// Evaluator that keeps the value of every node between calls
+// The sentence is hash-consed into a DAG with parent links, so changing a symbol only recomputes
+// the ancestors of its leaf, in topological order, and stops wherever a value comes out unchanged.
+// The cost of an update is proportional to the number of nodes whose value actually changes
+// (plus their parents), not to the size of the sentence.
+class IncrementalEvaluator
+{
+public:
+    IncrementalEvaluator() = default;
+    explicit IncrementalEvaluator(const Sentence& sentence);
+
+    // Evaluate from scratch with one value per symbol id (see Sentence::symbol_names())
+    // Returns std::nullopt if the number of values is wrong or the sentence is malformed
+    std::optional<bool> reset(std::span<const bool> values);
+
+    // Change one symbol and propagate, reset() has to be called first
+    // Returns std::nullopt if the symbol id is out of range or nothing has been evaluated yet
+    std::optional<bool> set(uint32_t symbol, bool value);
+
+    // Change several symbols at once, every affected node is still recomputed only once
+    std::optional<bool> update(std::span<const std::pair<uint32_t, bool>> changes);
+
+    // Value of the sentence after the last reset(), set() or update()
+    std::optional<bool> value() const;
+
+    size_t symbol_count() const { return symbol_nodes_.size(); }
+    size_t node_count() const { return store_.size(); }
+
+    // Nodes recomputed by the last set() or update()
+    size_t last_recomputed() const { return last_recomputed_; }
+
+private:
+    bool compute(NodeStore::node_id_t id) const;
+
+    NodeStore store_;
+    NodeStore::node_id_t root_ = NodeStore::INVALID;
+    std::vector<NodeStore::node_id_t> symbol_nodes_;    // leaf by symbol id, INVALID if unused
+    std::vector<uint32_t> parent_offsets_;              // parents of node i are parents_[offsets[i], offsets[i + 1])
+    std::vector<NodeStore::node_id_t> parents_;
+    std::vector<uint8_t> values_;                       // by node id, empty until reset()
+    std::vector<bool> queued_;
+    std::vector<NodeStore::node_id_t> heap_;            // min-heap worklist, children pop before parents
+    size_t last_recomputed_ = 0;
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__INCREMENTAL_HPP__
@@ -0,0 +1,76 @@
+#ifndef __PIMPL__KNOWLEDGE_BASE_HPP__
+#define __PIMPL__KNOWLEDGE_BASE_HPP__
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "pimpl/cnf.hpp"
+#include "pimpl/node_store.hpp"
+#include "pimpl/sentence.hpp"
+#include "pimpl/solver.hpp"
+
+namespace pimpl
+{
+
+// A set of sentences over one shared vocabulary, answering entailment queries
+// Symbols are interned by name, so sentences parsed separately talk about the same symbols.
+// Every node is Tseitin encoded into a single incremental solver the first time it is seen, and
+// each told sentence is guarded by its own activation literal. Queries are then solved under
+// assumptions, so clauses, encodings and learned clauses all carry over from one ask() to the next.
+class KnowledgeBase
+{
+public:
+    using fact_id_t = uint32_t;
+
+    KnowledgeBase() = default;
+
+    // Add a sentence to the knowledge base
+    // Returns std::nullopt if the sentence is empty or malformed
+    std::optional<fact_id_t> tell(const Sentence& sentence);
+
+    // Remove a told sentence, returns false if it is unknown or was already retracted
+    bool retract(fact_id_t fact);
+
+    // Check if the active sentences entail the query
+    // Returns std::nullopt if the query is empty or malformed
+    std::optional<bool> ask(const Sentence& query);
+
+    // Check if the active sentences can all be true at once
+    bool consistent();
+
+    // Expand a told sentence back into a Sentence, retracted ones included
+    // Returns std::nullopt if the id was never handed out by tell()
+    std::optional<Sentence> fact(fact_id_t fact) const
+    {
+        if (fact >= facts_.size()) {
+            return std::nullopt;
+        }
+        return store_.sentence(facts_[fact]);
+    }
+    size_t size() const { return active_.size(); }
+
+    const NodeStore& store() const { return store_; }
+    const Solver::Stats& stats() const { return solver_.stats(); }
+
+private:
+    static constexpr lit_t NO_LIT = UINT32_MAX;
+    static constexpr lit_t QUEUED = UINT32_MAX - 1;
+
+    std::optional<NodeStore::node_id_t> add(const Sentence& sentence);
+    // Encode every node below root that isn't in the solver yet, returns the literal of root
+    lit_t encode(NodeStore::node_id_t root);
+
+    NodeStore store_;
+    Solver solver_;
+    std::vector<lit_t> lits_;               // literal of every encoded node, NO_LIT otherwise
+    std::optional<lit_t> true_lit_;
+
+    std::vector<NodeStore::node_id_t> facts_;
+    std::vector<lit_t> selectors_;          // activation literal of every fact
+    std::vector<lit_t> active_;             // selectors of the facts that weren't retracted
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__KNOWLEDGE_BASE_HPP__
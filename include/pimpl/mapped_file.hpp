@@ -0,0 +1,43 @@
+#ifndef __PIMPL__MAPPED_FILE_HPP__
+#define __PIMPL__MAPPED_FILE_HPP__
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace pimpl
+{
+
+// Read-only memory mapping of a whole file
+// Pages are only read in when touched, and release() hands pages that were already
+// consumed back to the kernel, so a front to back pass over the file keeps a flat footprint.
+class MappedFile
+{
+public:
+    // Returns std::nullopt if the file can't be opened or mapped
+    static std::optional<MappedFile> open(const std::string& path);
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    std::string_view text() const { return {data_, size_}; }
+    size_t size() const { return size_; }
+
+    // Drop the resident pages that lie entirely before offset
+    // The text stays valid, pages are read in again if they are touched later
+    void release(size_t offset) const;
+
+private:
+    MappedFile(const char* data, size_t size) : data_(data), size_(size) {}
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__MAPPED_FILE_HPP__
@@ -0,0 +1,85 @@
+#ifndef __PIMPL__MODEL_COUNT_HPP__
+#define __PIMPL__MODEL_COUNT_HPP__
+
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "pimpl/cnf.hpp"
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+// Unsigned integer of any size, with just the arithmetic model counting needs
+class BigUint
+{
+public:
+    BigUint(uint64_t value = 0);
+
+    BigUint& operator+=(const BigUint& other);
+    BigUint& operator*=(const BigUint& other);
+    friend BigUint operator+(BigUint lhs, const BigUint& rhs) { return lhs += rhs; }
+    friend BigUint operator*(BigUint lhs, const BigUint& rhs) { return lhs *= rhs; }
+
+    bool operator==(const BigUint&) const = default;
+    std::strong_ordering operator<=>(const BigUint& other) const;
+
+    bool is_zero() const { return limbs_.empty(); }
+    // std::nullopt if the value doesn't fit
+    std::optional<uint64_t> to_u64() const;
+    double to_double() const;
+    std::string to_string() const;
+
+private:
+    std::vector<uint32_t> limbs_;   // least significant first, no leading zero limbs
+};
+
+std::ostream& operator<<(std::ostream& out, const BigUint& value);
+
+// Weights of the two literals of a variable, a weighted count sums the product of the
+// weights of every literal of a model over all models
+struct LiteralWeight
+{
+    double if_true = 1;
+    double if_false = 1;
+};
+
+struct ModelCountStats
+{
+    uint64_t decisions = 0;
+    uint64_t components = 0;     // components counted, cache hits included
+    uint64_t cache_hits = 0;
+};
+
+// Exact #SAT by DPLL with unit propagation and connected-component decomposition
+// After every decision the unsatisfied clauses are split into components that share no variable,
+// which are counted independently and multiplied. Component counts are cached by their exact
+// residual clause set (its variables and clause ids), so a subproblem that is reached again along
+// another branch is not searched twice. Branching follows a min-degree elimination order of the
+// variables, so the ones that separate the formula into components are decided first.
+//
+// The count is over all cnf.num_vars variables, variables that occur in no clause count twice.
+BigUint count_models(const Cnf& cnf, ModelCountStats* stats = nullptr);
+
+// Weighted count, weights has one entry per variable, variables past its end weigh 1 both ways
+double count_models(const Cnf& cnf, std::span<const LiteralWeight> weights, ModelCountStats* stats = nullptr);
+
+// Number of assignments to the symbols of the sentence (one per symbol id) that make it true
+// The sentence is Tseitin-encoded, every auxiliary variable is fixed by the symbols so the count
+// is unchanged. Returns std::nullopt if the sentence is empty or malformed
+std::optional<BigUint> count_models(const Sentence& sentence, ModelCountStats* stats = nullptr);
+
+// Weighted count with one weight per symbol id, e.g. {p, 1 - p} for the probability that the
+// sentence holds when each symbol is independently true with probability p
+// Returns std::nullopt if the sentence is malformed or the number of weights is wrong
+std::optional<double> count_models(const Sentence& sentence, std::span<const LiteralWeight> weights,
+                                   ModelCountStats* stats = nullptr);
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__MODEL_COUNT_HPP__
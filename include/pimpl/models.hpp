@@ -0,0 +1,25 @@
+#ifndef __PIMPL__MODELS_HPP__
+#define __PIMPL__MODELS_HPP__
+
+#include <vector>
+
+#include "pimpl/generator.hpp"
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+// Every assignment that makes the sentence true, one value per symbol id, found one at a time
+// The assignments are split into disjoint cubes along the last model found: after a model m,
+// the cubes m[0..k) ~m[k] for every k are left to explore, deepest first, and each is settled
+// by one call to the incremental CDCL solver under assumptions. Nothing is added to the solver
+// for a model already seen, so memory stays linear in the number of symbols however many models
+// there are, and the first model costs a single solve.
+//
+// A yielded model is only valid until the range is advanced, copy it to keep it.
+// An empty, malformed or unsatisfiable sentence yields nothing.
+Generator<std::vector<bool>> models(const Sentence& sentence);
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__MODELS_HPP__
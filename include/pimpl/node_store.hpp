@@ -0,0 +1,139 @@
+#ifndef __PIMPL__NODE_STORE_HPP__
+#define __PIMPL__NODE_STORE_HPP__
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "pimpl/sentence.hpp"
+#include "pimpl/symbol_table.hpp"
+
+namespace pimpl
+{
+
+// Arena of hash-consed sentence nodes
+// Nodes are stored contiguously and refer to their children by 32 bit index.
+// Every structurally identical subterm is stored exactly once, so node equality is index equality.
+// A node can only be created after its children, thus indices are always in topological order
+// (children before parents), which lets most passes walk the store with a plain loop.
+class NodeStore
+{
+public:
+    using node_id_t = uint32_t;
+    using symbol_id_t = uint32_t;
+
+    static constexpr node_id_t INVALID = UINT32_MAX;
+
+    enum class Kind : uint8_t
+    {
+        SYMBOL,
+        BOOL,
+        NOT,
+        AND,
+        OR,
+        IMP,
+        IFF,
+    };
+
+    struct Node
+    {
+        Kind kind;
+        uint32_t left;      // symbol id for SYMBOL, value for BOOL, operand for NOT
+        uint32_t right;     // zero for leaves and NOT
+
+        bool operator==(const Node&) const = default;
+    };
+
+    NodeStore() = default;
+
+    node_id_t make_symbol(std::string_view name);
+    node_id_t make_bool(bool value);
+    node_id_t make_not(node_id_t right);
+    node_id_t make_binary(Kind kind, node_id_t left, node_id_t right);
+
+    // Copy a sentence tree into the store
+    // Returns std::nullopt if the tree contains a monostate
+    std::optional<node_id_t> add(const Sentence::sentence_t& sentence);
+
+    // Copy a sentence into the store, interning all of its symbols first in symbol id order
+    // In a store without symbols yet, every symbol then keeps its Sentence symbol id.
+    // Returns std::nullopt if the sentence is empty, contains a monostate or uses a symbol it doesn't list
+    std::optional<node_id_t> add(const Sentence& sentence);
+
+    // Expand a node back into a Sentence, sharing the shared_ptr of every repeated subterm
+    Sentence sentence(node_id_t root) const;
+
+    const Node& operator[](node_id_t id) const { return nodes_[id]; }
+    std::span<const Node> nodes() const { return nodes_; }
+    size_t size() const { return nodes_.size(); }
+    void reserve(size_t n);
+
+    symbol_id_t intern(std::string_view name);
+    std::optional<symbol_id_t> find_symbol(std::string_view name) const;
+    const std::string& symbol_name(symbol_id_t id) const { return symbol_names_[id]; }
+    SymbolTable::symbol_id_t global_symbol(symbol_id_t id) const { return global_ids_[id]; }
+    size_t symbol_count() const { return symbol_names_.size(); }
+
+    static bool is_binary(Kind kind) { return kind >= Kind::AND; }
+
+private:
+    node_id_t make(Node node);
+    // Copy a tree, rejecting symbols that aren't in the symbol table of owner unless it is nullptr
+    std::optional<node_id_t> add_tree(const Sentence::sentence_t& sentence, const Sentence* owner);
+    symbol_id_t local_symbol(Sentence::Symbol symbol);
+    void rehash(size_t capacity);
+
+    static size_t hash(const Node& node);
+
+    struct StringHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    std::vector<Node> nodes_;
+    std::vector<node_id_t> table_;  // open addressing, INVALID marks an empty slot
+    std::vector<std::string> symbol_names_;
+    std::unordered_map<std::string, symbol_id_t, StringHash, std::equal_to<>> symbol_ids_;
+    std::vector<SymbolTable::symbol_id_t> global_ids_;                  // by store symbol id
+    std::unordered_map<SymbolTable::symbol_id_t, symbol_id_t> local_ids_;  // leaves are added without touching names
+};
+
+// Value of a BOOL or operator node from the values of the nodes before it, false for SYMBOL
+// NodeT is NodeStore::Node or any node laid out like it, e.g. the nodes of a mapped SentenceImage
+template <typename NodeT>
+bool node_value(const NodeT& node, const uint8_t* values)
+{
+    using Kind = NodeStore::Kind;
+    switch (Kind(node.kind)) {
+        case Kind::SYMBOL: return false;
+        case Kind::BOOL: return node.left != 0;
+        case Kind::NOT: return !values[node.left];
+        case Kind::AND: return values[node.left] & values[node.right];
+        case Kind::OR: return values[node.left] | values[node.right];
+        case Kind::IMP: return (!values[node.left]) | values[node.right];
+        case Kind::IFF: return values[node.left] == values[node.right];
+    }
+    return false;
+}
+
+// Evaluate every node of a topologically ordered array in one sweep, with one value per symbol id
+// out gets the value of each node, and has to be as long as nodes
+template <typename NodeT>
+void evaluate_nodes(std::span<const NodeT> nodes, std::span<const bool> symbols, std::span<uint8_t> out)
+{
+    for (size_t id = 0; id < nodes.size(); ++id) {
+        const auto& node = nodes[id];
+        out[id] = NodeStore::Kind(node.kind) == NodeStore::Kind::SYMBOL ? symbols[node.left]
+                                                                        : node_value(node, out.data());
+    }
+}
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__NODE_STORE_HPP__
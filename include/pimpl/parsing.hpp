@@ -1,10 +1,14 @@
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "lexy/dsl.hpp"
 #include "lexy/callback.hpp"
 
+#include "pimpl/node_store.hpp"
+#include "pimpl/rule_set.hpp"
 #include "pimpl/sentence.hpp"
+#include "pimpl/stats.hpp"
 
 namespace pimpl
 {
@@ -42,6 +46,7 @@ struct AbstractUnary : public AbstractBase
     abstract_ptr right;
 
     explicit AbstractUnary(Op o, abstract_ptr r) : op(o), right(std::move(r)) {}
+    ~AbstractUnary() override;
 };
 
 struct AbstractBinary : public AbstractBase
@@ -58,10 +63,19 @@ struct AbstractBinary : public AbstractBase
 
     explicit AbstractBinary(abstract_ptr l, Op o, abstract_ptr r)
         : op(o), left(std::move(l)), right(std::move(r)) {}
+    ~AbstractBinary() override;
 };
 
 Sentence toSentence(abstract_ptr ptr);
 
+// Build the AST into a hash-consed store, returns NodeStore::INVALID for a nullptr
+NodeStore::node_id_t toNodes(abstract_ptr ptr, NodeStore& store);
+
+// Build every parsed sentence (e.g. the lines of GrammarSentence) into one RuleSet, in order,
+// so subformulas repeated across lines are built and evaluated once
+// Returns std::nullopt if any of them is a nullptr
+std::optional<RuleSet> toRuleSet(const std::vector<abstract_ptr>& ptrs);
+
 }   // namespace ast
 
 namespace grammar
@@ -69,6 +83,11 @@ namespace grammar
 
 namespace dsl = lexy::dsl;
 
+// Binary operator chains are parsed in a loop, only parentheses and prefix ~ recurse inside lexy,
+// and everything after the parse walks the tree with explicit stacks.
+// This bounds parenthesis and ~ nesting so lexy itself can't exhaust the thread's stack.
+constexpr size_t MAX_NESTING = 1024;
+
 struct Symbol : lexy::token_production
 {
     static constexpr auto rule = dsl::identifier(dsl::ascii::alpha, dsl::ascii::word);
@@ -102,6 +121,8 @@ struct NestedExpr : lexy::transparent_production
 
 struct Expr : lexy::expression_production
 {
+    static constexpr auto max_operator_nesting = MAX_NESTING;
+
     struct ExpectedOperand
     {
         static constexpr auto name = "expected operand";
@@ -152,9 +173,73 @@ struct Expr : lexy::expression_production
         lexy::new_<ast::AbstractBinary, ast::abstract_ptr>);
 };
 
+// Allocate one node of a sentence built by the productions below
+template <typename Node>
+Sentence::sentence_ptr_t make_node(Node&& node)
+{
+    PIMPL_STATS_ADD(NODES_BUILT, 1);
+    PIMPL_STATS_ADD(ALLOCATIONS, 1);
+    PIMPL_STATS_ADD(ALLOCATED_BYTES, sizeof(Sentence::sentence_t));
+    return std::make_shared<Sentence::sentence_t>(std::forward<Node>(node));
+}
+
+// Parse state of the direct productions below, one leaf per symbol name is shared by the whole sentence
+struct SentenceState
+{
+    std::unordered_map<std::string, Sentence::sentence_ptr_t>* symbols;
+};
+
+struct NestedSentenceExpr : lexy::transparent_production
+{
+    static constexpr auto rule = dsl::recurse<struct SentenceExpr>;
+    static constexpr auto value = lexy::forward<Sentence::sentence_ptr_t>;
+};
+
+// Same grammar as Expr, but the callbacks build Sentence nodes and fill the symbol map directly,
+// without going through the AST
+struct SentenceExpr : lexy::expression_production
+{
+    static constexpr auto max_operator_nesting = MAX_NESTING;
+
+    static constexpr auto atom = [] {
+        auto paren_expr = dsl::parenthesized(dsl::p<NestedSentenceExpr>);
+        return paren_expr | dsl::p<Bool> | dsl::p<Symbol> | dsl::error<Expr::ExpectedOperand>;
+    }();
+
+    using operation = Expr::Iff;
+
+    static constexpr auto value = lexy::bind(
+        lexy::callback<Sentence::sentence_ptr_t>(
+            [](const SentenceState&, Sentence::sentence_ptr_t s) { return s; },
+            [](const SentenceState& state, std::string name) {
+                auto [it, inserted] = state.symbols->try_emplace(name);
+                if (inserted) {
+                    it->second = make_node(Sentence::Symbol(it->first));
+                }
+                return it->second;
+            },
+            [](const SentenceState&, bool b) { return make_node(b); },
+            [](const SentenceState&, ast::AbstractUnary::Op, Sentence::sentence_ptr_t r) {
+                return make_node(Sentence::Not(std::move(r)));
+            },
+            [](const SentenceState&, Sentence::sentence_ptr_t l, ast::AbstractBinary::Op op, Sentence::sentence_ptr_t r) {
+                switch (op) {
+                    case ast::AbstractBinary::AND:
+                        return make_node(Sentence::And(std::move(l), std::move(r)));
+                    case ast::AbstractBinary::OR:
+                        return make_node(Sentence::Or(std::move(l), std::move(r)));
+                    case ast::AbstractBinary::IMP:
+                        return make_node(Sentence::Imp(std::move(l), std::move(r)));
+                    default:
+                        return make_node(Sentence::Iff(std::move(l), std::move(r)));
+                }
+            }),
+        lexy::parse_state, lexy::values);
+};
+
 struct GrammarSentence
 {
-    static constexpr auto max_recursion_depth = 19;
+    static constexpr auto max_recursion_depth = MAX_NESTING;
 
     static constexpr auto whitespace = dsl::ascii::blank;
 
@@ -163,6 +248,30 @@ struct GrammarSentence
     static constexpr auto value = lexy::as_list<std::vector<ast::abstract_ptr>>;
 };
 
+// A single sentence without the line structure, for parsing input one line at a time
+struct GrammarLine
+{
+    static constexpr auto max_recursion_depth = MAX_NESTING;
+
+    static constexpr auto whitespace = dsl::ascii::blank;
+
+    static constexpr auto rule = dsl::p<Expr> + dsl::eof;
+
+    static constexpr auto value = lexy::forward<ast::abstract_ptr>;
+};
+
+// GrammarLine parsed straight into a Sentence, needs a SentenceState as the parse state
+struct GrammarSentenceLine
+{
+    static constexpr auto max_recursion_depth = MAX_NESTING;
+
+    static constexpr auto whitespace = dsl::ascii::blank;
+
+    static constexpr auto rule = dsl::p<SentenceExpr> + dsl::eof;
+
+    static constexpr auto value = lexy::forward<Sentence::sentence_ptr_t>;
+};
+
 }   // namespace grammar
 
 }   // namespace pimpl
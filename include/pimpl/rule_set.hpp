@@ -0,0 +1,82 @@
+#ifndef __PIMPL__RULE_SET_HPP__
+#define __PIMPL__RULE_SET_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "pimpl/node_store.hpp"
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+// Many sentences compiled into one DAG with a root per rule
+// Every rule is hash-consed into the same store, so a subformula that occurs in any number of rules
+// (or several times in one) is a single node, and evaluating the whole set under an assignment
+// computes each node once, in one sweep over the store.
+// Symbols are shared by name across rules and numbered in the order they are first added.
+class RuleSet
+{
+public:
+    using rule_id_t = uint32_t;
+
+    RuleSet() = default;
+
+    // Add a sentence as the next rule, every symbol in its symbol table joins the set
+    // Returns std::nullopt if the sentence is empty, malformed or uses a symbol it doesn't list
+    std::optional<rule_id_t> add(const Sentence& sentence);
+
+    // Add a node that was built straight into store(), e.g. by ast::toNodes()
+    // Returns std::nullopt if the id isn't in the store
+    std::optional<rule_id_t> add(NodeStore::node_id_t root);
+
+    // Evaluate every rule with one value per symbol id, results gets one value per rule
+    // Returns false if either span has the wrong size
+    bool evaluate(std::span<const bool> values, std::span<bool> results) const;
+
+    // Same as above with values by name, every symbol of the set has to be given
+    // Returns std::nullopt if one is missing
+    std::optional<std::vector<bool>> evaluate(const std::unordered_map<std::string, bool>& symbol_values) const;
+
+    // Expand a rule back into a Sentence
+    // Returns std::nullopt if the id was never handed out by add()
+    std::optional<Sentence> rule(rule_id_t rule) const
+    {
+        if (rule >= roots_.size()) {
+            return std::nullopt;
+        }
+        return store_.sentence(roots_[rule]);
+    }
+    std::optional<NodeStore::node_id_t> root(rule_id_t rule) const
+    {
+        if (rule >= roots_.size()) {
+            return std::nullopt;
+        }
+        return roots_[rule];
+    }
+    size_t size() const { return roots_.size(); }
+
+    size_t symbol_count() const { return store_.symbol_count(); }
+    const std::string& symbol_name(uint32_t id) const { return store_.symbol_name(id); }
+    std::optional<uint32_t> symbol_id(std::string_view name) const { return store_.find_symbol(name); }
+
+    // Distinct nodes over all rules, each is computed once per evaluation
+    size_t node_count() const { return store_.size(); }
+
+    const NodeStore& store() const { return store_; }
+    NodeStore& store() { return store_; }
+
+private:
+    NodeStore store_;
+    std::vector<NodeStore::node_id_t> roots_;
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__RULE_SET_HPP__
@@ -7,20 +7,28 @@
 #include <stack>
 #include <unordered_map>
 #include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "pimpl/symbol_table.hpp"
 
 namespace pimpl
 {
 
+class ThreadPool;
+
 class Sentence
 {
 public:
+    struct Symbol;
     struct Not;
     struct And;
     struct Or;
     struct Imp;
     struct Iff;
     
-    using sentence_t = std::variant<std::monostate, std::string, bool, Not, And, Or, Imp, Iff>;
+    using sentence_t = std::variant<std::monostate, Symbol, bool, Not, And, Or, Imp, Iff>;
     using sentence_ptr_t = std::shared_ptr<sentence_t>;
     
     static constexpr size_t INDEX_MONOSTATE = 0;
@@ -32,15 +40,44 @@ public:
     static constexpr size_t INDEX_IMP = 6;
     static constexpr size_t INDEX_IFF = 7;
 
+    // A symbol leaf only holds its id in SymbolTable::global()
+    // Names convert implicitly, so a leaf can still be made straight from a string
+    struct Symbol
+    {
+        SymbolTable::symbol_id_t id;
+
+        explicit Symbol(SymbolTable::symbol_id_t i) : id(i) {}
+        Symbol(std::string_view name) : id(SymbolTable::global().intern(name)) {}
+        Symbol(const std::string& name) : Symbol(std::string_view(name)) {}
+        Symbol(const char* name) : Symbol(std::string_view(name)) {}
+
+        const std::string& name() const { return SymbolTable::global().name(id); }
+
+        bool operator==(const Symbol&) const = default;
+    };
+
+    // Operator nodes compare and tear down their subtrees with explicit stacks,
+    // so neither depends on the depth of the tree.
+    // Each also carries the structural hash and node count of its subtree, computed once from its
+    // children when it is built, so most unequal subtrees are told apart without looking inside.
+    // The children are not meant to be reassigned afterwards.
     struct Not
     {
         sentence_ptr_t right;
+        size_t hash;
+        uint64_t size;      // nodes in the tree, repeated subtrees counted every time
 
-        explicit Not(sentence_ptr_t r) : right(r) {}
+        explicit Not(sentence_ptr_t r)
+            : right(r), hash(combine_hash(INDEX_NOT, nullptr, right)), size(combine_size(nullptr, right)) {}
+        Not(const Not&) = default;
+        Not(Not&&) = default;
+        Not& operator=(const Not&) = default;
+        Not& operator=(Not&&) = default;
+        ~Not() { release(nullptr, right); }
 
         bool operator==(const Not& rhs) const
         {
-            return *right == *rhs.right;
+            return this == &rhs || (hash == rhs.hash && size == rhs.size && equal(right, rhs.right));
         }
     };
     
@@ -48,12 +85,21 @@ public:
     {
         sentence_ptr_t left;
         sentence_ptr_t right;
+        size_t hash;
+        uint64_t size;
 
-        explicit And(sentence_ptr_t l, sentence_ptr_t r) : left(l), right(r) {}
+        explicit And(sentence_ptr_t l, sentence_ptr_t r)
+            : left(l), right(r), hash(combine_hash(INDEX_AND, &left, right)), size(combine_size(&left, right)) {}
+        And(const And&) = default;
+        And(And&&) = default;
+        And& operator=(const And&) = default;
+        And& operator=(And&&) = default;
+        ~And() { release(&left, right); }
 
         bool operator==(const And& rhs) const
         {
-            return *right == *rhs.right && *left == *rhs.left;
+            return this == &rhs
+                || (hash == rhs.hash && size == rhs.size && equal(left, rhs.left) && equal(right, rhs.right));
         }
     };
     
@@ -61,12 +107,21 @@ public:
     {
         sentence_ptr_t left;
         sentence_ptr_t right;
-
-        explicit Or(sentence_ptr_t l, sentence_ptr_t r) : left(l), right(r) {}
-
-        bool operator==(const Or& rhs)  const
+        size_t hash;
+        uint64_t size;
+
+        explicit Or(sentence_ptr_t l, sentence_ptr_t r)
+            : left(l), right(r), hash(combine_hash(INDEX_OR, &left, right)), size(combine_size(&left, right)) {}
+        Or(const Or&) = default;
+        Or(Or&&) = default;
+        Or& operator=(const Or&) = default;
+        Or& operator=(Or&&) = default;
+        ~Or() { release(&left, right); }
+
+        bool operator==(const Or& rhs) const
         {
-            return *right == *rhs.right && *left == *rhs.left;
+            return this == &rhs
+                || (hash == rhs.hash && size == rhs.size && equal(left, rhs.left) && equal(right, rhs.right));
         }
     };
     
@@ -74,12 +129,21 @@ public:
     {
         sentence_ptr_t left;
         sentence_ptr_t right;
+        size_t hash;
+        uint64_t size;
 
-        explicit Imp(sentence_ptr_t l, sentence_ptr_t r) : left(l), right(r) {}
+        explicit Imp(sentence_ptr_t l, sentence_ptr_t r)
+            : left(l), right(r), hash(combine_hash(INDEX_IMP, &left, right)), size(combine_size(&left, right)) {}
+        Imp(const Imp&) = default;
+        Imp(Imp&&) = default;
+        Imp& operator=(const Imp&) = default;
+        Imp& operator=(Imp&&) = default;
+        ~Imp() { release(&left, right); }
 
         bool operator==(const Imp& rhs) const
         {
-            return *right == *rhs.right && *left == *rhs.left;
+            return this == &rhs
+                || (hash == rhs.hash && size == rhs.size && equal(left, rhs.left) && equal(right, rhs.right));
         }
     };
     
@@ -87,12 +151,21 @@ public:
     {
         sentence_ptr_t left;
         sentence_ptr_t right;
+        size_t hash;
+        uint64_t size;
 
-        explicit Iff(sentence_ptr_t l, sentence_ptr_t r) : left(l), right(r) {}
+        explicit Iff(sentence_ptr_t l, sentence_ptr_t r)
+            : left(l), right(r), hash(combine_hash(INDEX_IFF, &left, right)), size(combine_size(&left, right)) {}
+        Iff(const Iff&) = default;
+        Iff(Iff&&) = default;
+        Iff& operator=(const Iff&) = default;
+        Iff& operator=(Iff&&) = default;
+        ~Iff() { release(&left, right); }
 
         bool operator==(const Iff& rhs) const
         {
-            return *right == *rhs.right && *left == *rhs.left;
+            return this == &rhs
+                || (hash == rhs.hash && size == rhs.size && equal(left, rhs.left) && equal(right, rhs.right));
         }
     };
 
@@ -171,79 +244,98 @@ public:
     //};
 
     Sentence() = default;
-    Sentence(sentence_ptr_t d, std::unordered_map<std::string, sentence_ptr_t> v)
-        : data_(d), symbols_(v)
-    {
-    }
+    Sentence(sentence_ptr_t d, std::unordered_map<std::string, sentence_ptr_t> v);
 
     // Subtitute all symbols with a boolean value and determine if the sentence is true/false
     // Returns std::nullopt if a problem was encountered,
     // e.g. incorrect input symbols, issues with the sentence structure, etc
-    std::optional<bool> evaluate(std::unordered_map<std::string, bool> symbol_values);
+    std::optional<bool> evaluate(const std::unordered_map<std::string, bool>& symbol_values) const;
+
+    // Same as above, with one value per symbol id (see symbol_names())
+    // The tree is never modified, so a Sentence can be evaluated from several threads at once
+    std::optional<bool> evaluate_ids(std::span<const bool> symbol_values) const;
+
+    // Evaluate many assignments at once
+    // assignments is a row-major matrix with one row per result and one column per symbol id.
+    // Rows are spread over the pool when one is given, otherwise run on the calling thread.
+    // Returns false if the sizes don't match or any row couldn't be evaluated (its result is false)
+    bool evaluate_batch(std::span<const bool> assignments, std::span<bool> results,
+                        ThreadPool* pool = nullptr) const;
 
     // Check if the sentence evaluates to true or false
     // All symbols are expected to have been substituted for bools,
     // thus nullopt is returned if any are present
-    std::optional<bool> truth();
+    std::optional<bool> truth() const;
+
+    // Search for an assignment that makes the sentence true, one value per symbol id
+    // Runs the CDCL solver on a linear-size CNF of the sentence instead of trying every assignment.
+    // Returns std::nullopt if the sentence is unsatisfiable or malformed
+    std::optional<std::vector<bool>> satisfiable() const;
+
+    // Check if the sentence is true under every assignment, std::nullopt if it is malformed
+    std::optional<bool> valid() const;
+
+    // An assignment that makes the sentence false, std::nullopt if it is valid or malformed
+    std::optional<std::vector<bool>> counterexample() const;
+
+    // Substitute the known symbols and fold them away with Kleene's three-valued logic,
+    // e.g. F & x is F and T & x is x whatever x is, while an unknown x stays in the result.
+    // The residual only has the symbols that are still in its tree, and shares every subtree
+    // that no known symbol reaches with this sentence. Names that don't occur are ignored.
+    // Returns std::nullopt if the sentence is malformed
+    std::optional<Sentence> partial_evaluate(const std::unordered_map<std::string, bool>& known) const;
+
+    const sentence_ptr_t& data() const { return data_; }
+    const std::unordered_map<std::string, sentence_ptr_t>& symbols() const { return symbols_; }
+
+    // Symbol names ordered by id, ids are assigned in name order
+    const std::vector<std::string>& symbol_names() const { return symbol_names_; }
+    std::optional<uint32_t> symbol_id(std::string_view name) const;
+
+    // Global symbol table ids ordered by sentence symbol id
+    const std::vector<SymbolTable::symbol_id_t>& symbol_ids() const { return symbol_ids_; }
+
+    // Sentence symbol id of a leaf, an integer search instead of a name lookup
+    std::optional<uint32_t> symbol_slot(Symbol symbol) const;
+
+    // Structural hash of the tree, read from the root so it costs the same for any size
+    // Equal sentences hash equal, std::hash<Sentence> uses it
+    size_t hash() const { return data_ ? tree_hash(*data_) : 0; }
+
+    // Same tree (shared subtrees and hash mismatches short-circuit) over the same symbols
+    bool operator==(const Sentence& rhs) const;
+
+    // Hash and node count of any node, leaves are computed and operator nodes read their stored values
+    static size_t tree_hash(const sentence_t& sentence);
+    static uint64_t tree_size(const sentence_t& sentence);
 
 private:
     sentence_ptr_t data_;
     std::unordered_map<std::string, sentence_ptr_t> symbols_;
+    std::vector<std::string> symbol_names_;
+    std::vector<SymbolTable::symbol_id_t> symbol_ids_;
+    std::vector<std::pair<SymbolTable::symbol_id_t, uint32_t>> slots_;  // (global id, sentence id) by global id
 
-    struct TruthVisitor
-    {
-        static bool negate (bool b) { return !b; };
-
-        std::optional<bool> operator()(std::monostate _) { return std::nullopt; }
-        std::optional<bool> operator()(std::string _) { return std::nullopt; }
-        std::optional<bool> operator()(bool b) { return {b}; }
-        std::optional<bool> operator()(Not n)
-        {
-            return std::visit(*this, *n.right).transform(negate);
-        }
-
-        std::optional<bool> operator()(And a)
-        {
-            return std::visit(*this, *a.left).and_then(
-                [this, &a](bool b) -> std::optional<bool> {
-                    if (b) return std::visit(*this, *a.right);
-                    else return {false};
-                }
-            );
-        }
+    // Evaluate the tree with an explicit stack, symbols evaluate to std::nullopt when values is empty
+    std::optional<bool> evaluate_tree(std::span<const bool> values) const;
 
-        std::optional<bool> operator()(Or o)
-        {
-            return std::visit(*this, *o.left).and_then(
-                [this, &o](bool b) -> std::optional<bool> {
-                    if (b) return {true};
-                    else return std::visit(*this, *o.right);
-                }
-            );
-        }
+    // Structural equality of two subtrees, nullptr only equals nullptr
+    static bool equal(const sentence_ptr_t& lhs, const sentence_ptr_t& rhs);
 
-        std::optional<bool> operator()(Imp i)
-        {
-            return std::visit(*this, *i.right).and_then(
-                [this, &i](bool b) -> std::optional<bool> {
-                    if (b) return {true};
-                    else return std::visit(*this, *i.left).transform(negate);
-                }
-            );
-        }
+    // Drop a node's children, subtrees that nothing else refers to are taken apart one node at a time
+    static void release(sentence_ptr_t* left, sentence_ptr_t& right);
 
-        std::optional<bool> operator()(Iff i)
-        {
-            return std::visit(*this, *i.left).and_then(
-                [this, &i](bool b) -> std::optional<bool> {
-                    if (b) return std::visit(*this, *i.right);
-                    else return std::visit(*this, *i.right).transform(negate);
-                }
-            );
-        }
-    };
+    // Hash and size of an operator node from its children, left is nullptr for Not
+    static size_t combine_hash(size_t index, const sentence_ptr_t* left, const sentence_ptr_t& right);
+    static uint64_t combine_size(const sentence_ptr_t* left, const sentence_ptr_t& right);
 };
 
 }   // namespace pimpl
 
+template <>
+struct std::hash<pimpl::Sentence>
+{
+    size_t operator()(const pimpl::Sentence& sentence) const noexcept { return sentence.hash(); }
+};
+
 #endif  // __PIMPL__SENTENCE_HPP__
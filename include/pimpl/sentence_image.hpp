@@ -0,0 +1,92 @@
+#ifndef __PIMPL__SENTENCE_IMAGE_HPP__
+#define __PIMPL__SENTENCE_IMAGE_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pimpl/mapped_file.hpp"
+#include "pimpl/node_store.hpp"
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+// Binary image of a set of sentences sharing one hash-consed node array
+//
+// Layout, every offset is from the start of the image and 8 byte aligned:
+//   header     magic, version, byte order mark, counts and section offsets
+//   nodes      node_count BinaryNode, children always before their parents
+//   names      symbol_count + 1 uint32_t offsets into the characters that follow them
+//   roots      root_count uint32_t node ids
+//
+// Nothing in the image is a pointer, so it can be mapped anywhere and shared read-only between
+// processes through the page cache. Loading only checks the header and that every node refers
+// to earlier nodes and known symbols, nothing is parsed or allocated per node.
+class SentenceImage
+{
+public:
+    static constexpr uint32_t VERSION = 1;
+
+    struct BinaryNode
+    {
+        uint8_t kind;       // NodeStore::Kind
+        uint8_t padding[3];
+        uint32_t left;      // symbol id for SYMBOL, value for BOOL, operand for NOT
+        uint32_t right;     // zero for leaves and NOT
+    };
+
+    // Serialize the nodes reachable from roots, symbol i of the image is symbol i of the store
+    // Returns std::nullopt if a root is not a node of the store
+    static std::optional<std::vector<char>> serialize(const NodeStore& store,
+                                                      std::span<const NodeStore::node_id_t> roots);
+
+    // Serialize sentences as roots of one image, symbols are numbered in name order over all sentences
+    // Returns std::nullopt if a sentence is empty or malformed
+    static std::optional<std::vector<char>> serialize(std::span<const Sentence> sentences);
+
+    // Write an image to a file, returns false on I/O errors
+    static bool write(const std::string& path, std::span<const char> image);
+
+    // Map an image file, returns std::nullopt if it can't be opened or isn't a valid image
+    static std::optional<SentenceImage> open(const std::string& path);
+
+    // View an image in memory, the bytes must outlive the view and be 8 byte aligned
+    static std::optional<SentenceImage> view(std::span<const char> image);
+
+    size_t root_count() const { return roots_.size(); }
+    NodeStore::node_id_t root(size_t i) const { return roots_[i]; }
+    size_t node_count() const { return nodes_.size(); }
+    const BinaryNode& node(NodeStore::node_id_t id) const { return nodes_[id]; }
+    size_t symbol_count() const { return name_offsets_.empty() ? 0 : name_offsets_.size() - 1; }
+    std::string_view symbol_name(uint32_t id) const;
+    std::optional<uint32_t> find_symbol(std::string_view name) const;
+
+    // Evaluate one root with one value per image symbol id, same short-circuits as Sentence::evaluate()
+    // Returns std::nullopt if the index or the number of values is wrong
+    std::optional<bool> evaluate(size_t root, std::span<const bool> values) const;
+
+    // Evaluate every root in one pass over the node array, results has one entry per root
+    // Returns false if the sizes don't match
+    bool evaluate_all(std::span<const bool> values, std::span<bool> results) const;
+
+    // Expand a root into a Sentence, which allocates like any other Sentence
+    Sentence sentence(size_t root) const;
+
+private:
+    SentenceImage() = default;
+
+    std::optional<MappedFile> file_;
+    std::span<const BinaryNode> nodes_;
+    std::span<const uint32_t> name_offsets_;
+    const char* names_ = nullptr;
+    std::span<const uint32_t> roots_;
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__SENTENCE_IMAGE_HPP__
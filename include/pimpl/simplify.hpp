@@ -0,0 +1,37 @@
+#ifndef __PIMPL__SIMPLIFY_HPP__
+#define __PIMPL__SIMPLIFY_HPP__
+
+#include <cstddef>
+#include <optional>
+
+#include "pimpl/node_store.hpp"
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+// Distinct nodes reachable from the root before and after simplifying
+struct SimplifyStats
+{
+    size_t nodes_before = 0;
+    size_t nodes_after = 0;
+};
+
+// Fold constants and remove local redundancies bottom-up:
+// ~T, ~~x, x & T, x & F, x & x, x & ~x, x | ~x, x => x, x <=> x, x <=> ~x and friends.
+// Every node of the store is rewritten at most once, so shared subterms cost nothing extra
+// and a DAG is simplified in time linear in its number of distinct nodes.
+// New nodes are added to the store, the result is equivalent to root.
+NodeStore::node_id_t simplify(NodeStore& store, NodeStore::node_id_t root);
+
+// Simplify a sentence, the result keeps every symbol of the original even if it no longer
+// appears in the tree, so symbol ids and assignments carry over unchanged.
+// Returns std::nullopt if the sentence is empty or malformed
+std::optional<Sentence> simplify(const Sentence& sentence, SimplifyStats* stats = nullptr);
+
+// Number of distinct nodes reachable from root
+size_t reachable_count(const NodeStore& store, NodeStore::node_id_t root);
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__SIMPLIFY_HPP__
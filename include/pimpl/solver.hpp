@@ -0,0 +1,148 @@
+#ifndef __PIMPL__SOLVER_HPP__
+#define __PIMPL__SOLVER_HPP__
+
+#include <bit>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <vector>
+
+#include "pimpl/cnf.hpp"
+
+namespace pimpl
+{
+
+// Conflict-driven clause learning SAT solver
+// Unit propagation uses two watched literals per clause (with a blocking literal),
+// decisions come from an EVSIDS activity heap with phase saving, conflicts are analysed to the
+// first UIP and restarts follow the Luby sequence. Learned clauses are ranked by LBD and activity
+// and the worse half is deleted at a restart once there are too many of them.
+//
+// The solver is incremental: clauses can be added between calls to solve(), and every call can be
+// given a set of assumption literals that only hold for that call. Learned clauses are kept.
+class Solver
+{
+public:
+    struct Stats
+    {
+        uint64_t decisions = 0;
+        uint64_t propagations = 0;
+        uint64_t conflicts = 0;
+        uint64_t restarts = 0;
+        uint64_t learned = 0;
+        uint64_t deleted = 0;
+    };
+
+    Solver() = default;
+    explicit Solver(const Cnf& cnf) { add_cnf(cnf); }
+
+    uint32_t new_var();
+    uint32_t num_vars() const { return assigns_.size(); }
+
+    // Variables are created as needed
+    // Returns false once the clauses are unsatisfiable without any assumptions
+    bool add_clause(std::span<const lit_t> clause);
+    bool add_clause(std::initializer_list<lit_t> clause)
+    {
+        return add_clause(std::span<const lit_t>(clause.begin(), clause.size()));
+    }
+    bool add_cnf(const Cnf& cnf);
+
+    // Search for a model of every clause in which all assumptions are true
+    bool solve(std::span<const lit_t> assumptions = {});
+    bool solve(std::initializer_list<lit_t> assumptions)
+    {
+        return solve(std::span<const lit_t>(assumptions.begin(), assumptions.size()));
+    }
+
+    // Model found by the last successful solve(), indexed by variable
+    const std::vector<bool>& model() const { return model_; }
+
+    // false once the clauses alone are unsatisfiable
+    bool okay() const { return ok_; }
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    using cref_t = uint32_t;
+    static constexpr cref_t NO_CLAUSE = UINT32_MAX;
+    static constexpr lit_t NO_LIT = UINT32_MAX;
+
+    enum class Search
+    {
+        SAT,
+        UNSAT,
+        RESTART,
+    };
+
+    struct Watcher
+    {
+        cref_t clause;
+        lit_t blocker;
+    };
+
+    // Clause layout in the arena: size, flags (learned bit, lbd above it), activity, literals
+    static constexpr uint32_t HEADER = 3;
+    uint32_t clause_size(cref_t c) const { return arena_[c]; }
+    lit_t* clause_lits(cref_t c) { return arena_.data() + c + HEADER; }
+    uint32_t clause_lbd(cref_t c) const { return arena_[c + 1] >> 1; }
+    float clause_activity(cref_t c) const { return std::bit_cast<float>(arena_[c + 2]); }
+    void set_clause_activity(cref_t c, float a) { arena_[c + 2] = std::bit_cast<uint32_t>(a); }
+
+    cref_t alloc_clause(std::span<const lit_t> lits, bool learned, uint32_t lbd);
+    void attach(cref_t c);
+
+    // -1 false, 0 unassigned, 1 true
+    int8_t value(lit_t lit) const { return lit_negated(lit) ? -assigns_[lit_var(lit)] : assigns_[lit_var(lit)]; }
+    uint32_t decision_level() const { return trail_lim_.size(); }
+
+    void enqueue(lit_t lit, cref_t reason);
+    cref_t propagate();
+    void analyze(cref_t conflict, std::vector<lit_t>& learned, uint32_t& backtrack_level, uint32_t& lbd);
+    bool redundant(lit_t lit);
+    void cancel_until(uint32_t level);
+    lit_t pick_branch();
+    Search search(uint64_t conflict_budget);
+    void reduce();
+
+    void bump_var(uint32_t var);
+    void bump_clause(cref_t c);
+
+    // max-heap of unassigned variables ordered by activity
+    void heap_insert(uint32_t var);
+    void heap_up(size_t i);
+    void heap_down(size_t i);
+    uint32_t heap_pop();
+
+    std::vector<uint32_t> arena_;
+    std::vector<cref_t> clauses_;
+    std::vector<cref_t> learned_;
+    std::vector<std::vector<Watcher>> watches_;     // indexed by the watched literal
+
+    std::vector<int8_t> assigns_;
+    std::vector<uint32_t> level_;
+    std::vector<cref_t> reason_;
+    std::vector<bool> phase_;                       // saved sign of the last assignment
+    std::vector<uint8_t> seen_;
+    std::vector<lit_t> trail_;
+    std::vector<uint32_t> trail_lim_;
+    size_t qhead_ = 0;
+
+    std::vector<double> activity_;
+    std::vector<uint32_t> heap_;
+    std::vector<int32_t> heap_index_;               // -1 when not in the heap
+    double var_inc_ = 1.0;
+    float clause_inc_ = 1.0f;
+
+    std::vector<lit_t> assumptions_;
+    std::vector<lit_t> analyze_clear_;
+    size_t max_learned_ = 0;
+    bool ok_ = true;
+
+    std::vector<bool> model_;
+    Stats stats_;
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__SOLVER_HPP__
@@ -0,0 +1,149 @@
+#ifndef __PIMPL__STATS_HPP__
+#define __PIMPL__STATS_HPP__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Opt-in instrumentation of the hot paths, enabled by defining PIMPL_ENABLE_STATS
+// Every thread counts into its own block, a snapshot sums the blocks of all threads.
+// Without PIMPL_ENABLE_STATS the macros expand to nothing and a snapshot is all zeros.
+
+namespace pimpl::stats
+{
+
+enum class Counter : uint8_t
+{
+    NODES_BUILT,        // sentence and store nodes created
+    NODES_VISITED,      // nodes or instructions touched by evaluation and comparison
+    SHORT_CIRCUITS,     // &, | and => decided by one side
+    ALLOCATIONS,        // node and arena allocations
+    ALLOCATED_BYTES,
+};
+
+enum class Timer : uint8_t
+{
+    PARSE,
+    BUILD,
+    EVALUATE,
+};
+
+constexpr size_t COUNTERS = 5;
+constexpr size_t TIMERS = 3;
+
+#ifdef PIMPL_ENABLE_STATS
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+struct Snapshot
+{
+    std::array<uint64_t, COUNTERS> counters{};
+    std::array<uint64_t, TIMERS> nanoseconds{};
+    std::array<uint64_t, TIMERS> calls{};
+    size_t threads = 0;     // threads that have counted anything, including finished ones
+
+    uint64_t operator[](Counter c) const { return counters[size_t(c)]; }
+    uint64_t operator[](Timer t) const { return nanoseconds[size_t(t)]; }
+};
+
+const char* name(Counter c);
+const char* name(Timer t);
+
+// Sum of every thread since the last reset()
+Snapshot snapshot();
+void reset();
+
+// One name and value per line
+std::ostream& operator<<(std::ostream& out, const Snapshot& snapshot);
+
+#ifdef PIMPL_ENABLE_STATS
+
+namespace detail
+{
+
+// Only the owning thread writes a block, so a plain load and store is enough
+// and snapshot() may read it from any thread at the same time
+struct Block
+{
+    std::array<std::atomic<uint64_t>, COUNTERS> counters{};
+    std::array<std::atomic<uint64_t>, TIMERS> nanoseconds{};
+    std::array<std::atomic<uint64_t>, TIMERS> calls{};
+};
+
+inline void bump(std::atomic<uint64_t>& value, uint64_t n)
+{
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// Registers the block on first use, folds it into the totals when the thread exits
+struct LocalBlock
+{
+    Block* block = nullptr;
+    ~LocalBlock();
+};
+
+Block* register_thread();
+
+inline thread_local LocalBlock local_block;
+
+inline Block& local()
+{
+    if (local_block.block == nullptr) {
+        local_block.block = register_thread();
+    }
+    return *local_block.block;
+}
+
+}   // namespace detail
+
+inline void add(Counter c, uint64_t n = 1)
+{
+    detail::bump(detail::local().counters[size_t(c)], n);
+}
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Timer timer) : timer_(timer), start_(std::chrono::steady_clock::now()) {}
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        auto& block = detail::local();
+        detail::bump(block.nanoseconds[size_t(timer_)],
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        detail::bump(block.calls[size_t(timer_)], 1);
+    }
+
+private:
+    Timer timer_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif  // PIMPL_ENABLE_STATS
+
+}   // namespace pimpl::stats
+
+#define PIMPL_STATS_CONCAT_(a, b) a##b
+#define PIMPL_STATS_CONCAT(a, b) PIMPL_STATS_CONCAT_(a, b)
+
+#ifdef PIMPL_ENABLE_STATS
+// Add n to a counter, e.g. PIMPL_STATS_ADD(NODES_VISITED, visited)
+#define PIMPL_STATS_ADD(counter, n) ::pimpl::stats::add(::pimpl::stats::Counter::counter, (n))
+// Time the rest of the enclosing scope
+#define PIMPL_STATS_TIMER(timer) \
+    ::pimpl::stats::ScopedTimer PIMPL_STATS_CONCAT(pimpl_stats_timer_, __LINE__)(::pimpl::stats::Timer::timer)
+#else
+// the value is still named so locals that only feed a counter don't trip -Wunused
+#define PIMPL_STATS_ADD(counter, n) ((void)(n))
+#define PIMPL_STATS_TIMER(timer) ((void)0)
+#endif
+
+#endif  // __PIMPL__STATS_HPP__
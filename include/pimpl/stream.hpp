@@ -0,0 +1,51 @@
+#ifndef __PIMPL__STREAM_HPP__
+#define __PIMPL__STREAM_HPP__
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+class ThreadPool;
+
+struct ParseSummary
+{
+    size_t lines = 0;
+    size_t sentences = 0;
+    size_t errors = 0;
+};
+
+// Called once per non-blank line with its line number (starting at 1),
+// sentence is std::nullopt if the line couldn't be parsed
+// Returning false stops the parse after that line
+using LineCallback = std::function<bool(size_t line, std::optional<Sentence> sentence)>;
+
+// Parse a single sentence, surrounding blanks are ignored
+std::optional<Sentence> parse_sentence(std::string_view line);
+
+// Parse one sentence per line, handing each to the callback as soon as it is parsed
+// Only the current line's AST is alive at any time
+ParseSummary parse_lines(std::string_view text, const LineCallback& callback);
+
+// Same as above over a memory mapped file, pages are released as the parse moves past them
+// Returns std::nullopt if the file can't be opened
+std::optional<ParseSummary> parse_file(const std::string& path, const LineCallback& callback);
+
+// Parallel versions of the above
+// The text is cut at line boundaries into chunks of about chunk_bytes, a batch of chunks is parsed
+// across the pool, then the callback sees every sentence of the batch on the calling thread,
+// in line order and with the same line numbers as the sequential parse
+ParseSummary parse_lines(std::string_view text, ThreadPool& pool, const LineCallback& callback,
+                         size_t chunk_bytes = size_t(1) << 20);
+std::optional<ParseSummary> parse_file(const std::string& path, ThreadPool& pool, const LineCallback& callback,
+                                       size_t chunk_bytes = size_t(1) << 20);
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__STREAM_HPP__
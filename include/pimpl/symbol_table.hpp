@@ -0,0 +1,46 @@
+#ifndef __PIMPL__SYMBOL_TABLE_HPP__
+#define __PIMPL__SYMBOL_TABLE_HPP__
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace pimpl
+{
+
+// Interns symbol names to dense 32 bit ids
+// Ids are handed out in first-seen order and never change, names live as long as the table.
+// Lookups take a shared lock and interning a new name an exclusive one, so a table can be
+// shared by every sentence and by parser threads at the same time.
+class SymbolTable
+{
+public:
+    using symbol_id_t = uint32_t;
+
+    SymbolTable() = default;
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    // The table used by Sentence symbol leaves
+    static SymbolTable& global();
+
+    symbol_id_t intern(std::string_view name);
+    std::optional<symbol_id_t> find(std::string_view name) const;
+
+    // The reference stays valid for the lifetime of the table
+    const std::string& name(symbol_id_t id) const;
+    size_t size() const;
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::deque<std::string> names_;     // a deque never moves its elements, the map keys point into it
+    std::unordered_map<std::string_view, symbol_id_t> ids_;
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__SYMBOL_TABLE_HPP__
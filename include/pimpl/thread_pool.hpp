@@ -0,0 +1,72 @@
+#ifndef __PIMPL__THREAD_POOL_HPP__
+#define __PIMPL__THREAD_POOL_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pimpl
+{
+
+// Fixed set of worker threads for data parallel loops
+// parallel_for() splits [0, n) into one contiguous range of chunks per participant.
+// Participants claim chunks from the front of their own range, and once it is empty
+// steal chunks from the other ranges, so uneven chunks don't leave threads idle.
+// The calling thread takes part in the loop as well.
+class ThreadPool
+{
+public:
+    // threads is the total number of participants, including the caller
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size() + 1; }
+
+    // Call fn(begin, end) over [0, n) in chunks of at most grain items, blocking until all are done
+    // Concurrent calls from several threads are run one after the other.
+    // If fn throws, chunks nobody has started are skipped, and the first exception is rethrown
+    // here once every participant has stopped. A parallel_for() on the same pool from inside fn
+    // runs its loop inline on the thread that makes the call.
+    void parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+private:
+    struct Range
+    {
+        std::atomic<size_t> next;
+        size_t end;
+    };
+
+    void worker(size_t index);
+    void run(size_t participant);
+
+    std::vector<std::thread> workers_;
+
+    std::mutex job_mutex_;      // serializes parallel_for() calls
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    size_t generation_ = 0;
+    size_t running_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;          // first exception thrown by fn in the current job
+    std::atomic<bool> failed_ = false;  // stops participants from claiming more chunks
+
+    // current job
+    const std::function<void(size_t, size_t)>* fn_ = nullptr;
+    std::unique_ptr<Range[]> ranges_;
+    size_t n_ = 0;
+    size_t grain_ = 1;
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__THREAD_POOL_HPP__
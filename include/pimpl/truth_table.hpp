@@ -0,0 +1,77 @@
+#ifndef __PIMPL__TRUTH_TABLE_HPP__
+#define __PIMPL__TRUTH_TABLE_HPP__
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "pimpl/node_store.hpp"
+#include "pimpl/sentence.hpp"
+
+namespace pimpl
+{
+
+// Bit-sliced evaluation of a Sentence
+// Every symbol is given a word of assignment bits and the sentence is run once as bitwise operations,
+// so bit k of the result is the truth of the sentence under the assignment in bit k of each symbol word.
+// A pass covers 64 assignments per word, and 4 or 8 words at once when AVX2/AVX-512 are available.
+class BitSliceEvaluator
+{
+public:
+    enum class Isa
+    {
+        SCALAR,     // 1 word (64 assignments) per pass
+        AVX2,       // 4 words (256 assignments) per pass
+        AVX512,     // 8 words (512 assignments) per pass
+    };
+
+    // Truth tables are limited to 2^MAX_TABLE_SYMBOLS rows
+    static constexpr size_t MAX_TABLE_SYMBOLS = 32;
+
+    BitSliceEvaluator() = default;
+    explicit BitSliceEvaluator(const Sentence& sentence);
+
+    // false if the sentence is empty, has a monostate or a symbol that isn't in its symbol table
+    bool valid() const { return !code_.empty(); }
+
+    // Symbols in the same order as Sentence::symbol_names()
+    const std::vector<std::string>& symbols() const { return symbols_; }
+
+    // Best instruction set supported by the running CPU
+    static Isa detected_isa();
+    Isa isa() const { return isa_; }
+    // Request an instruction set, clamped to what the CPU supports
+    void use_isa(Isa isa);
+
+    // Evaluate 64 * out.size() assignments
+    // symbol_words holds out.size() words per symbol, symbol-major: symbol_words[slot * out.size() + word]
+    // Returns false if the sentence is invalid or the spans don't match
+    bool evaluate(std::span<const uint64_t> symbol_words, std::span<uint64_t> out) const;
+
+    // Row r of the table assigns bit i of r to symbol slot i, and is bit (r % 64) of word (r / 64)
+    // Returns std::nullopt for invalid sentences or more than MAX_TABLE_SYMBOLS symbols
+    std::optional<std::vector<uint64_t>> truth_table() const;
+
+    // Write the table words [first_word, first_word + out.size()) into out
+    bool truth_table(uint64_t first_word, std::span<uint64_t> out) const;
+
+    // Number of true rows, computed pass by pass without materializing the table
+    std::optional<uint64_t> count_true() const;
+
+private:
+    using kernel_t = void (*)(const NodeStore::Node*, size_t, const uint64_t*, uint64_t*);
+
+    size_t words_per_pass() const;
+    kernel_t kernel() const;
+    void table_pass(uint64_t word, uint64_t* symbol_words, uint64_t* scratch, uint64_t* out) const;
+
+    std::vector<NodeStore::Node> code_;     // topological order, SYMBOL nodes hold slots
+    std::vector<std::string> symbols_;
+    Isa isa_ = detected_isa();
+};
+
+}   // namespace pimpl
+
+#endif  // __PIMPL__TRUTH_TABLE_HPP__
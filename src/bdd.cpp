@@ -0,0 +1,697 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <utility>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/bdd.hpp"
+
+namespace pimpl
+{
+
+namespace
+{
+
+constexpr size_t MIN_GC_THRESHOLD = 1 << 14;
+
+size_t mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+}   // namespace
+
+Bdd::Bdd(const Bdd& other) : manager_(other.manager_), root_(other.root_)
+{
+    if (manager_ != nullptr) {
+        ++manager_->roots_[root_].refs;
+    }
+}
+
+Bdd::Bdd(Bdd&& other) noexcept : manager_(std::exchange(other.manager_, nullptr)), root_(other.root_) {}
+
+Bdd& Bdd::operator=(Bdd other) noexcept
+{
+    std::swap(manager_, other.manager_);
+    std::swap(root_, other.root_);
+    return *this;
+}
+
+Bdd::~Bdd()
+{
+    if (manager_ != nullptr) {
+        manager_->release(root_);
+    }
+}
+
+bool Bdd::is_true() const
+{
+    return manager_ != nullptr && manager_->roots_[root_].edge == BddManager::TRUE;
+}
+
+bool Bdd::is_false() const
+{
+    return manager_ != nullptr && manager_->roots_[root_].edge == BddManager::FALSE;
+}
+
+bool Bdd::operator==(const Bdd& rhs) const
+{
+    if (manager_ != rhs.manager_) {
+        return false;
+    }
+    return manager_ == nullptr || manager_->roots_[root_].edge == manager_->roots_[rhs.root_].edge;
+}
+
+BddManager::BddManager(size_t cache_size)
+    : cache_(std::bit_ceil(std::max<size_t>(cache_size, 1))), gc_threshold_(MIN_GC_THRESHOLD)
+{
+    nodes_.push_back({TERMINAL, TRUE, TRUE});
+    rehash(64);
+}
+
+Bdd BddManager::constant(bool value)
+{
+    return wrap(value ? TRUE : FALSE);
+}
+
+Bdd BddManager::variable(std::string_view name)
+{
+    auto var = find_var(name);
+    return wrap(make(var ? *var : new_var(name), TRUE, FALSE));
+}
+
+std::optional<Bdd> BddManager::build(const Sentence& sentence)
+{
+    using Kind = NodeStore::Kind;
+
+    if (sentence.data() == nullptr) {
+        return std::nullopt;
+    }
+    NodeStore store;
+    auto root = store.add(*sentence.data());
+    if (!root) {
+        return std::nullopt;
+    }
+
+    // the store interns symbols left to right in depth-first order, which gives the static order
+    std::vector<uint32_t> vars(store.symbol_count());
+    for (NodeStore::symbol_id_t s = 0; s < store.symbol_count(); ++s) {
+        auto var = find_var(store.symbol_name(s));
+        vars[s] = var ? *var : new_var(store.symbol_name(s));
+    }
+
+    // children precede parents, so one sweep builds every node after its operands
+    std::vector<edge_t> edges(*root + 1);
+    for (NodeStore::node_id_t id = 0; id <= *root; ++id) {
+        const auto& n = store[id];
+        switch (n.kind) {
+            case Kind::SYMBOL:
+                edges[id] = make(vars[n.left], TRUE, FALSE);
+                break;
+            case Kind::BOOL:
+                edges[id] = n.left ? TRUE : FALSE;
+                break;
+            case Kind::NOT:
+                edges[id] = edges[n.left] ^ 1;
+                break;
+            case Kind::AND:
+                edges[id] = ite(edges[n.left], edges[n.right], FALSE);
+                break;
+            case Kind::OR:
+                edges[id] = ite(edges[n.left], TRUE, edges[n.right]);
+                break;
+            case Kind::IMP:
+                edges[id] = ite(edges[n.left], edges[n.right], TRUE);
+                break;
+            case Kind::IFF:
+                edges[id] = ite(edges[n.left], edges[n.right], edges[n.right] ^ 1);
+                break;
+        }
+    }
+
+    return wrap(edges[*root]);
+}
+
+Bdd BddManager::ite(const Bdd& f, const Bdd& g, const Bdd& h)
+{
+    return wrap(ite(roots_[f.root_].edge, roots_[g.root_].edge, roots_[h.root_].edge));
+}
+
+Bdd BddManager::negate(const Bdd& f)
+{
+    return wrap(roots_[f.root_].edge ^ 1);
+}
+
+Bdd BddManager::apply(NodeStore::Kind op, const Bdd& f, const Bdd& g)
+{
+    const edge_t a = roots_[f.root_].edge;
+    const edge_t b = roots_[g.root_].edge;
+    switch (op) {
+        case NodeStore::Kind::AND:
+            return wrap(ite(a, b, FALSE));
+        case NodeStore::Kind::OR:
+            return wrap(ite(a, TRUE, b));
+        case NodeStore::Kind::IMP:
+            return wrap(ite(a, b, TRUE));
+        case NodeStore::Kind::IFF:
+            return wrap(ite(a, b, b ^ 1));
+        default:
+            return Bdd();
+    }
+}
+
+Bdd BddManager::restrict(const Bdd& f, std::string_view name, bool value)
+{
+    auto var = find_var(name);
+    if (!var) {
+        return f;
+    }
+    std::unordered_map<edge_t, edge_t> done;
+    return wrap(restrict(roots_[f.root_].edge, levels_[*var], value, done));
+}
+
+double BddManager::sat_count(const Bdd& f) const
+{
+    // fraction of all assignments that reach TRUE, computed per node in topological order
+    const edge_t root = roots_[f.root_].edge;
+    std::vector<double> fraction(root / 2 + 1);
+    auto of = [&fraction](edge_t e) { return (e & 1) ? 1.0 - fraction[e >> 1] : fraction[e >> 1]; };
+    fraction[0] = 1.0;
+    for (size_t i = 1; i < fraction.size(); ++i) {
+        fraction[i] = (of(nodes_[i].high) + of(nodes_[i].low)) / 2;
+    }
+    return std::ldexp(of(root), num_vars());
+}
+
+std::optional<bool> BddManager::evaluate(const Bdd& f, std::span<const bool> values) const
+{
+    if (values.size() != num_vars()) {
+        return std::nullopt;
+    }
+    edge_t e = roots_[f.root_].edge;
+    while ((e >> 1) != 0) {
+        const Node& n = nodes_[e >> 1];
+        e = (values[n.var] ? n.high : n.low) ^ (e & 1);
+    }
+    return e == TRUE;
+}
+
+size_t BddManager::node_count(const Bdd& f) const
+{
+    std::vector<bool> seen(nodes_.size(), false);
+    std::vector<uint32_t> stack{roots_[f.root_].edge >> 1};
+    seen[stack.back()] = true;
+    size_t count = 0;
+    while (!stack.empty()) {
+        const uint32_t i = stack.back();
+        stack.pop_back();
+        ++count;
+        if (i == 0) {
+            continue;
+        }
+        for (edge_t child : {nodes_[i].high, nodes_[i].low}) {
+            if (!seen[child >> 1]) {
+                seen[child >> 1] = true;
+                stack.push_back(child >> 1);
+            }
+        }
+    }
+    return count;
+}
+
+std::optional<uint32_t> BddManager::find_var(std::string_view name) const
+{
+    if (auto it = var_ids_.find(name); it != var_ids_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+void BddManager::collect_garbage()
+{
+    // mark from the referenced roots, children before parents makes the sweep a single pass down
+    std::vector<bool> live(nodes_.size(), false);
+    live[0] = true;
+    for (const auto& root : roots_) {
+        if (root.refs > 0) {
+            live[root.edge >> 1] = true;
+        }
+    }
+    for (size_t i = nodes_.size(); i-- > 1; ) {
+        if (live[i]) {
+            live[nodes_[i].high >> 1] = true;
+            live[nodes_[i].low >> 1] = true;
+        }
+    }
+
+    // compact in place, which keeps the topological order
+    std::vector<uint32_t> moved(nodes_.size());
+    auto remap = [&moved](edge_t e) { return (moved[e >> 1] << 1) | (e & 1); };
+    size_t j = 0;
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        if (live[i]) {
+            moved[i] = j;
+            nodes_[j++] = {nodes_[i].var, remap(nodes_[i].high), remap(nodes_[i].low)};
+        }
+    }
+    nodes_.resize(j);
+    for (auto& root : roots_) {
+        if (root.refs > 0) {
+            root.edge = remap(root.edge);
+        }
+    }
+
+    rehash(std::bit_ceil(std::max<size_t>(4 * nodes_.size(), 64)));
+    std::ranges::fill(cache_, CacheEntry{});
+    gc_threshold_ = std::max(MIN_GC_THRESHOLD, 2 * nodes_.size());
+}
+
+bool BddManager::reorder(std::span<const uint32_t> order)
+{
+    if (order.size() != num_vars()) {
+        return false;
+    }
+    std::vector<uint32_t> levels(num_vars(), TERMINAL);
+    for (uint32_t level = 0; level < order.size(); ++level) {
+        if (order[level] >= num_vars() || levels[order[level]] != TERMINAL) {
+            return false;
+        }
+        levels[order[level]] = level;
+    }
+
+    // rebuild every live node bottom up as ite(var, high, low) under the new order
+    collect_garbage();
+    std::vector<Node> old = std::move(nodes_);
+    nodes_.assign(1, old[0]);
+    rehash(table_.size());
+    std::ranges::fill(cache_, CacheEntry{});
+    levels_ = std::move(levels);
+    order_.assign(order.begin(), order.end());
+
+    std::vector<edge_t> rebuilt(old.size());
+    auto remap = [&rebuilt](edge_t e) { return rebuilt[e >> 1] ^ (e & 1); };
+    rebuilt[0] = TRUE;
+    for (size_t i = 1; i < old.size(); ++i) {
+        rebuilt[i] = ite(make(old[i].var, TRUE, FALSE), remap(old[i].high), remap(old[i].low));
+    }
+    for (auto& root : roots_) {
+        if (root.refs > 0) {
+            root.edge = remap(root.edge);
+        }
+    }
+
+    collect_garbage();
+    return true;
+}
+
+void BddManager::sift()
+{
+    collect_garbage();
+
+    // the most frequent variables first, they have the most to gain
+    std::vector<size_t> uses(num_vars(), 0);
+    for (size_t i = 1; i < nodes_.size(); ++i) {
+        ++uses[nodes_[i].var];
+    }
+    std::vector<uint32_t> vars(order_);
+    std::ranges::stable_sort(vars, [&uses](uint32_t a, uint32_t b) { return uses[a] > uses[b]; });
+
+    for (uint32_t var : vars) {
+        std::vector<uint32_t> best = order_;
+        size_t best_size = nodes_.size();
+
+        std::vector<uint32_t> rest = order_;
+        rest.erase(std::ranges::find(rest, var));
+        for (size_t level = 0; level <= rest.size(); ++level) {
+            std::vector<uint32_t> candidate = rest;
+            candidate.insert(candidate.begin() + level, var);
+            if (candidate == order_) {
+                continue;
+            }
+            reorder(candidate);
+            if (nodes_.size() < best_size) {
+                best_size = nodes_.size();
+                best = candidate;
+            }
+        }
+        reorder(best);
+    }
+}
+
+uint32_t BddManager::new_var(std::string_view name)
+{
+    uint32_t var = var_names_.size();
+    var_names_.emplace_back(name);
+    var_ids_.emplace(var_names_.back(), var);
+    levels_.push_back(order_.size());
+    order_.push_back(var);
+    return var;
+}
+
+uint32_t BddManager::edge_level(edge_t e) const
+{
+    const uint32_t var = nodes_[e >> 1].var;
+    return var == TERMINAL ? TERMINAL : levels_[var];
+}
+
+size_t BddManager::hash(const Node& node)
+{
+    return mix(((static_cast<uint64_t>(node.high) << 32) | node.low) ^ (node.var * 0x9e3779b97f4a7c15ull));
+}
+
+BddManager::edge_t BddManager::make(uint32_t var, edge_t high, edge_t low)
+{
+    if (high == low) {
+        return high;
+    }
+    // move a complement on the high edge to the returned edge
+    const edge_t complement = high & 1;
+    const Node node{var, high ^ complement, low ^ complement};
+
+    // keep the load factor at or below one half
+    if (2 * (nodes_.size() + 1) > table_.size()) {
+        rehash(2 * table_.size());
+    }
+
+    size_t mask = table_.size() - 1;
+    for (size_t i = hash(node) & mask; ; i = (i + 1) & mask) {
+        if (table_[i] == EMPTY) {
+            table_[i] = nodes_.size();
+            nodes_.push_back(node);
+            return (table_[i] << 1) | complement;
+        }
+        if (nodes_[table_[i]] == node) {
+            return (table_[i] << 1) | complement;
+        }
+    }
+}
+
+void BddManager::rehash(size_t capacity)
+{
+    table_.assign(capacity, EMPTY);
+    size_t mask = capacity - 1;
+    for (uint32_t id = 1; id < nodes_.size(); ++id) {
+        size_t i = hash(nodes_[id]) & mask;
+        while (table_[i] != EMPTY) {
+            i = (i + 1) & mask;
+        }
+        table_[i] = id;
+    }
+}
+
+BddManager::edge_t BddManager::ite(edge_t f, edge_t g, edge_t h)
+{
+    if (f == TRUE) return g;
+    if (f == FALSE) return h;
+
+    // operands equal to f or its complement are constants below f
+    if (g == f) g = TRUE;
+    else if (g == (f ^ 1)) g = FALSE;
+    if (h == f) h = FALSE;
+    else if (h == (f ^ 1)) h = TRUE;
+
+    if (g == h) return g;
+    if (g == TRUE && h == FALSE) return f;
+    if (g == FALSE && h == TRUE) return f ^ 1;
+
+    // normalize to a regular f and g, so equivalent calls share a cache entry
+    if (f & 1) {
+        f ^= 1;
+        std::swap(g, h);
+    }
+    edge_t complement = 0;
+    if (g & 1) {
+        g ^= 1;
+        h ^= 1;
+        complement = 1;
+    }
+
+    const size_t slot = mix((static_cast<uint64_t>(f) << 32 | g) ^ (h * 0x9e3779b97f4a7c15ull)) & (cache_.size() - 1);
+    if (const CacheEntry& entry = cache_[slot]; entry.f == f && entry.g == g && entry.h == h) {
+        return entry.result ^ complement;
+    }
+
+    const uint32_t top = std::min({edge_level(f), edge_level(g), edge_level(h)});
+    auto cofactors = [this, top](edge_t e) -> std::pair<edge_t, edge_t> {
+        if (edge_level(e) != top) {
+            return {e, e};
+        }
+        const Node& n = nodes_[e >> 1];
+        return {n.high ^ (e & 1), n.low ^ (e & 1)};
+    };
+    auto [f1, f0] = cofactors(f);
+    auto [g1, g0] = cofactors(g);
+    auto [h1, h0] = cofactors(h);
+
+    const edge_t high = ite(f1, g1, h1);
+    const edge_t low = ite(f0, g0, h0);
+    const edge_t result = make(order_[top], high, low);
+
+    cache_[slot] = {f, g, h, result};
+    return result ^ complement;
+}
+
+BddManager::edge_t BddManager::restrict(edge_t f, uint32_t level, bool value,
+                                        std::unordered_map<edge_t, edge_t>& done)
+{
+    if (edge_level(f) > level) {
+        return f;
+    }
+    const edge_t complement = f & 1;
+    f ^= complement;
+    if (auto it = done.find(f); it != done.end()) {
+        return it->second ^ complement;
+    }
+
+    const Node n = nodes_[f >> 1];
+    edge_t result;
+    if (levels_[n.var] == level) {
+        result = value ? n.high : n.low;
+    } else {
+        const edge_t high = restrict(n.high, level, value, done);
+        const edge_t low = restrict(n.low, level, value, done);
+        result = make(n.var, high, low);
+    }
+    done.emplace(f, result);
+    return result ^ complement;
+}
+
+Bdd BddManager::wrap(edge_t e)
+{
+    uint32_t root;
+    if (free_roots_.empty()) {
+        root = roots_.size();
+        roots_.push_back({e, 1});
+    } else {
+        root = free_roots_.back();
+        free_roots_.pop_back();
+        roots_[root] = {e, 1};
+    }
+
+    // intermediate edges only exist inside a single operation, so this is the safe point to collect
+    if (nodes_.size() >= gc_threshold_) {
+        collect_garbage();
+    }
+    return Bdd(this, root);
+}
+
+void BddManager::release(uint32_t root)
+{
+    if (--roots_[root].refs == 0) {
+        free_roots_.push_back(root);
+    }
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <random>
+
+namespace
+{
+
+// Random sentence over n symbols in a store, roughly size operators deep
+pimpl::NodeStore::node_id_t random_node(pimpl::NodeStore& store, std::mt19937& rng, int n, int size)
+{
+    using Kind = pimpl::NodeStore::Kind;
+    if (size <= 1) {
+        return store.make_symbol("v" + std::to_string(rng() % n));
+    }
+    switch (rng() % 5) {
+        case 0:
+            return store.make_not(random_node(store, rng, n, size - 1));
+        default: {
+            const Kind kind = static_cast<Kind>(static_cast<int>(Kind::AND) + rng() % 4);
+            const int left = 1 + rng() % (size - 1);
+            return store.make_binary(kind, random_node(store, rng, n, left), random_node(store, rng, n, size - left));
+        }
+    }
+}
+
+}   // namespace
+
+TEST_CASE("BddManager")
+{
+    using namespace pimpl;
+    using Kind = NodeStore::Kind;
+
+    BddManager manager;
+
+    SUBCASE("constants and variables") {
+        auto t = manager.constant(true);
+        auto f = manager.constant(false);
+        CHECK(t.is_true());
+        CHECK(f.is_false());
+        CHECK(manager.negate(t) == f);
+
+        auto a = manager.variable("a");
+        CHECK(manager.num_vars() == 1);
+        CHECK(manager.variable("a") == a);
+        CHECK(manager.node_count(a) == 2);
+        CHECK(manager.apply(Kind::OR, a, manager.negate(a)).is_true());
+        CHECK(manager.apply(Kind::AND, a, manager.negate(a)).is_false());
+        CHECK(manager.negate(manager.negate(a)) == a);
+        CHECK(manager.ite(a, t, f) == a);
+        CHECK(!Bdd().valid());
+    }
+
+    SUBCASE("equivalent sentences share a node") {
+        // a => b, ~a | b and ~(a & ~b)
+        NodeStore store;
+        auto a = store.make_symbol("a");
+        auto b = store.make_symbol("b");
+        auto imp = manager.build(store.sentence(store.make_binary(Kind::IMP, a, b)));
+        auto disj = manager.build(store.sentence(store.make_binary(Kind::OR, store.make_not(a), b)));
+        auto conj = manager.build(store.sentence(store.make_not(store.make_binary(Kind::AND, a, store.make_not(b)))));
+        REQUIRE(imp);
+        REQUIRE(disj);
+        REQUIRE(conj);
+        CHECK(*imp == *disj);
+        CHECK(*imp == *conj);
+        CHECK(!(*imp == manager.variable("b")));
+
+        CHECK(manager.build(Sentence()) == std::nullopt);
+    }
+
+    SUBCASE("static order follows the first occurrence") {
+        NodeStore store;
+        auto root = store.make_binary(Kind::OR, store.make_symbol("z"),
+                                      store.make_binary(Kind::AND, store.make_symbol("y"), store.make_symbol("z")));
+        REQUIRE(manager.build(store.sentence(root)));
+        CHECK(manager.var_name(manager.order()[0]) == "z");
+        CHECK(manager.var_name(manager.order()[1]) == "y");
+    }
+
+    SUBCASE("agrees with evaluate()") {
+        std::mt19937 rng(3);
+        for (int round = 0; round < 100; ++round) {
+            NodeStore store;
+            for (int i = 0; i < 6; ++i) {
+                store.intern("v" + std::to_string(i));
+            }
+            const Sentence sentence = store.sentence(random_node(store, rng, 6, 12));
+            auto bdd = manager.build(sentence);
+            REQUIRE(bdd);
+
+            int models = 0;
+            bool by_var[6];
+            for (int bits = 0; bits < (1 << 6); ++bits) {
+                std::unordered_map<std::string, bool> values;
+                for (const auto& name : sentence.symbol_names()) {
+                    values[name] = (bits >> (name[1] - '0')) & 1;
+                }
+                for (uint32_t var = 0; var < manager.num_vars(); ++var) {
+                    by_var[var] = (bits >> (manager.var_name(var)[1] - '0')) & 1;
+                }
+                bool expected = *sentence.evaluate(values);
+                models += expected;
+                CHECK(manager.evaluate(*bdd, std::span<const bool>(by_var, manager.num_vars())) == expected);
+            }
+            // symbols that aren't in the manager yet can take either value
+            CHECK(manager.sat_count(*bdd) * (1 << (6 - manager.num_vars())) == models);
+        }
+    }
+
+    SUBCASE("restrict") {
+        auto a = manager.variable("a");
+        auto b = manager.variable("b");
+        auto f = manager.apply(Kind::IFF, a, b);
+        CHECK(manager.restrict(f, "a", true) == b);
+        CHECK(manager.restrict(f, "a", false) == manager.negate(b));
+        CHECK(manager.restrict(f, "c", false) == f);
+        CHECK(manager.sat_count(f) == 2);
+    }
+
+    SUBCASE("garbage collection") {
+        auto a = manager.variable("a");
+        auto b = manager.variable("b");
+        auto keep = manager.apply(Kind::AND, a, b);
+        for (int i = 0; i < 100; ++i) {
+            auto c = manager.variable("c" + std::to_string(i));
+            manager.apply(Kind::OR, keep, c);
+        }
+        const size_t before = manager.size();
+        manager.collect_garbage();
+        CHECK(manager.size() < before);
+        CHECK(manager.size() == 4);
+        CHECK(manager.apply(Kind::AND, a, b) == keep);
+        CHECK(manager.node_count(keep) == 3);
+    }
+
+    SUBCASE("reordering keeps every function") {
+        // (x0 & y0) | (x1 & y1) | (x2 & y2) | (x3 & y3), exponential when all xs come first
+        Bdd f = manager.constant(false);
+        std::vector<Bdd> xs;
+        std::vector<Bdd> ys;
+        for (int i = 0; i < 4; ++i) {
+            xs.push_back(manager.variable("x" + std::to_string(i)));
+        }
+        for (int i = 0; i < 4; ++i) {
+            ys.push_back(manager.variable("y" + std::to_string(i)));
+        }
+        for (int i = 0; i < 4; ++i) {
+            f = manager.apply(Kind::OR, f, manager.apply(Kind::AND, xs[i], ys[i]));
+        }
+        auto g = manager.apply(Kind::IFF, xs[0], ys[3]);
+        const size_t bad = manager.node_count(f);
+
+        std::vector<bool> table;
+        bool values[8];
+        for (int bits = 0; bits < 256; ++bits) {
+            for (int v = 0; v < 8; ++v) {
+                values[v] = (bits >> v) & 1;
+            }
+            table.push_back(*manager.evaluate(f, values));
+            table.push_back(*manager.evaluate(g, values));
+        }
+
+        const uint32_t interleaved[] = {0, 4, 1, 5, 2, 6, 3, 7};
+        REQUIRE(manager.reorder(interleaved));
+        CHECK(manager.node_count(f) == 9);
+
+        REQUIRE(manager.reorder(std::vector<uint32_t>{0, 1, 2, 3, 4, 5, 6, 7}));
+        CHECK(manager.node_count(f) == bad);
+        manager.sift();
+        CHECK(manager.node_count(f) < bad);
+
+        for (int bits = 0; bits < 256; ++bits) {
+            for (int v = 0; v < 8; ++v) {
+                values[v] = (bits >> v) & 1;
+            }
+            CHECK(manager.evaluate(f, values) == table[2 * bits]);
+            CHECK(manager.evaluate(g, values) == table[2 * bits + 1]);
+        }
+        CHECK(manager.apply(Kind::OR, xs[3], manager.apply(Kind::AND, ys[3], xs[3])) == xs[3]);
+
+        CHECK(!manager.reorder(std::vector<uint32_t>{0, 1}));
+        CHECK(!manager.reorder(std::vector<uint32_t>{0, 0, 1, 2, 3, 4, 5, 6}));
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
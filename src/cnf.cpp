@@ -0,0 +1,225 @@
+#include "doctest/doctest.h"
+
+#include "pimpl/cnf.hpp"
+
+namespace pimpl
+{
+
+Cnf to_cnf(const NodeStore& store, NodeStore::node_id_t root, CnfEncoding encoding)
+{
+    using Kind = NodeStore::Kind;
+
+    Cnf cnf;
+    cnf.num_symbols = store.symbol_count();
+    cnf.num_vars = cnf.num_symbols;
+
+    // Polarity of every node reachable from the root, children always precede parents
+    // so a single downward sweep pushes each polarity to the children
+    std::vector<uint8_t> polarity(root + 1, 0);
+    polarity[root] = encoding == CnfEncoding::TSEITIN ? cnf::BOTH : cnf::POSITIVE;
+    for (NodeStore::node_id_t id = root + 1; id-- > 0; ) {
+        const uint8_t p = polarity[id];
+        if (p == 0) {
+            continue;
+        }
+        const uint8_t flipped = ((p & cnf::POSITIVE) ? cnf::NEGATIVE : 0)
+                              | ((p & cnf::NEGATIVE) ? cnf::POSITIVE : 0);
+        const auto& n = store[id];
+        switch (n.kind) {
+            case Kind::NOT:
+                polarity[n.left] |= flipped;
+                break;
+            case Kind::AND:
+            case Kind::OR:
+                polarity[n.left] |= p;
+                polarity[n.right] |= p;
+                break;
+            case Kind::IMP:
+                polarity[n.left] |= flipped;
+                polarity[n.right] |= p;
+                break;
+            case Kind::IFF:
+                polarity[n.left] |= cnf::BOTH;
+                polarity[n.right] |= cnf::BOTH;
+                break;
+            default:
+                break;
+        }
+    }
+
+    auto add_clause = [&cnf](std::initializer_list<lit_t> clause) { cnf.add_clause(clause); };
+
+    // Negations reuse their operand's literal with the sign flipped, constants share one variable
+    std::optional<lit_t> true_lit;
+    std::vector<lit_t> lits(root + 1, 0);
+    for (NodeStore::node_id_t id = 0; id <= root; ++id) {
+        if (polarity[id] == 0) {
+            continue;
+        }
+        const auto& n = store[id];
+        switch (n.kind) {
+            case Kind::SYMBOL:
+                lits[id] = make_lit(n.left);
+                break;
+            case Kind::BOOL:
+                if (!true_lit) {
+                    true_lit = make_lit(cnf.num_vars++);
+                    add_clause({*true_lit});
+                }
+                lits[id] = n.left ? *true_lit : lit_not(*true_lit);
+                break;
+            case Kind::NOT:
+                lits[id] = lit_not(lits[n.left]);
+                break;
+            default:
+                lits[id] = make_lit(cnf.num_vars++);
+                cnf::define(n.kind, lits[id], lits[n.left], lits[n.right], polarity[id], add_clause);
+                break;
+        }
+    }
+
+    add_clause({lits[root]});
+    return cnf;
+}
+
+std::optional<Cnf> to_cnf(const Sentence& sentence, CnfEncoding encoding, bool negate)
+{
+    NodeStore store;
+    auto root = store.add(sentence);
+    if (!root) {
+        return std::nullopt;
+    }
+    if (negate) {
+        root = store.make_not(*root);
+    }
+
+    return to_cnf(store, *root, encoding);
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+
+namespace
+{
+
+bool satisfied(const pimpl::Cnf& cnf, const std::vector<bool>& values)
+{
+    for (size_t i = 0; i < cnf.size(); ++i) {
+        bool any = false;
+        for (auto lit : cnf.clause(i)) {
+            any |= values[pimpl::lit_var(lit)] != pimpl::lit_negated(lit);
+        }
+        if (!any) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Number of assignments to the auxiliary variables that extend the symbol assignment to a model
+int extensions(const pimpl::Cnf& cnf, uint64_t symbol_bits)
+{
+    std::vector<bool> values(cnf.num_vars);
+    for (uint32_t v = 0; v < cnf.num_symbols; ++v) {
+        values[v] = (symbol_bits >> v) & 1;
+    }
+    const uint32_t aux = cnf.num_vars - cnf.num_symbols;
+    int count = 0;
+    for (uint64_t bits = 0; bits < (uint64_t(1) << aux); ++bits) {
+        for (uint32_t v = 0; v < aux; ++v) {
+            values[cnf.num_symbols + v] = (bits >> v) & 1;
+        }
+        count += satisfied(cnf, values);
+    }
+    return count;
+}
+
+}   // namespace
+
+TEST_CASE("to_cnf")
+{
+    using namespace pimpl;
+    using Kind = NodeStore::Kind;
+
+    NodeStore store;
+    auto a = store.make_symbol("a");
+    auto b = store.make_symbol("b");
+    auto c = store.make_symbol("c");
+
+    std::vector<NodeStore::node_id_t> roots = {
+        a,
+        store.make_not(a),
+        store.make_bool(false),
+        store.make_binary(Kind::AND, a, store.make_not(a)),
+        store.make_binary(Kind::OR, store.make_binary(Kind::AND, a, b), store.make_not(c)),
+        store.make_binary(Kind::IMP, store.make_binary(Kind::IFF, a, b), store.make_binary(Kind::IFF, b, c)),
+        store.make_not(store.make_binary(Kind::IFF, store.make_binary(Kind::IMP, a, store.make_bool(true)),
+                                         store.make_binary(Kind::OR, c, store.make_not(b)))),
+    };
+
+    for (auto root : roots) {
+        auto sentence = store.sentence(root);
+        auto pg = to_cnf(store, root, CnfEncoding::PLAISTED_GREENBAUM);
+        auto full = to_cnf(store, root, CnfEncoding::TSEITIN);
+        REQUIRE(pg.num_symbols == 3);
+        REQUIRE(full.num_symbols == 3);
+        CHECK(pg.size() <= full.size());
+
+        for (uint64_t bits = 0; bits < 8; ++bits) {
+            std::vector<bool> values = {(bits & 1) != 0, (bits & 2) != 0, (bits & 4) != 0};
+            std::unordered_map<std::string, bool> by_name;
+            for (const auto& name : sentence.symbol_names()) {
+                by_name[name] = values[*store.find_symbol(name)];
+            }
+            bool expected = *sentence.evaluate(by_name);
+            CHECK((extensions(pg, bits) > 0) == expected);
+            CHECK(extensions(full, bits) == (expected ? 1 : 0));
+        }
+    }
+}
+
+TEST_CASE("to_cnf(Sentence)")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+
+    CHECK(to_cnf(Sentence()) == std::nullopt);
+    CHECK(to_cnf(Sentence(std::make_shared<s_t>("a"), {})) == std::nullopt);
+
+    // b & ~a, variables follow the sentence's symbol ids
+    auto a = std::make_shared<s_t>("a");
+    auto b = std::make_shared<s_t>("b");
+    Sentence sentence(std::make_shared<s_t>(Sentence::And(b, std::make_shared<s_t>(Sentence::Not(a)))),
+                      {{"b", b}, {"a", a}});
+    auto cnf = to_cnf(sentence);
+    REQUIRE(cnf);
+    CHECK(cnf->num_symbols == 2);
+    CHECK(cnf->num_vars == 3);
+    CHECK(extensions(*cnf, 0b10) == 1);
+    CHECK(extensions(*cnf, 0b01) == 0);
+    CHECK(extensions(*cnf, 0b11) == 0);
+
+    // negated, every other assignment is a model
+    auto negated = to_cnf(sentence, CnfEncoding::TSEITIN, true);
+    REQUIRE(negated);
+    CHECK(extensions(*negated, 0b10) == 0);
+    CHECK(extensions(*negated, 0b01) == 1);
+    CHECK(extensions(*negated, 0b11) == 1);
+
+    SUBCASE("linear in the size of the input") {
+        // a chain of 100000 <=> stays linear, where distributing | over & would explode
+        NodeStore store;
+        auto root = store.make_symbol("x0");
+        for (int i = 1; i < 100000; ++i) {
+            root = store.make_binary(NodeStore::Kind::IFF, root, store.make_symbol("x" + std::to_string(i)));
+        }
+        auto big = to_cnf(store, root, CnfEncoding::TSEITIN);
+        CHECK(big.num_vars == 100000 + 99999);
+        CHECK(big.size() == 4 * 99999 + 1);
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
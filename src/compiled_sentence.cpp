@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <memory>
+#include <variant>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/compiled_sentence.hpp"
+#include "pimpl/stats.hpp"
+
+namespace pimpl
+{
+
+CompiledSentence::CompiledSentence(const Sentence& sentence)
+    : symbols_(sentence.symbol_names())
+{
+    if (sentence.data() == nullptr) {
+        program_.push_back({Op::INVALID, 0});
+        main_end_ = program_.size();
+        return;
+    }
+
+    // Count the parents of every node, visiting each distinct node once
+    std::unordered_map<const Sentence::sentence_t*, uint32_t> parents{{sentence.data().get(), 0}};
+    std::vector<const Sentence::sentence_t*> pending{sentence.data().get()};
+    while (!pending.empty()) {
+        const Sentence::sentence_t* s = pending.back();
+        pending.pop_back();
+        auto count = [&](const Sentence::sentence_ptr_t& child) {
+            if (child != nullptr && parents[child.get()]++ == 0) {
+                pending.push_back(child.get());
+            }
+        };
+        std::visit([&](const auto& node) {
+            if constexpr (requires { node.left; }) {
+                count(node.left);
+            }
+            if constexpr (requires { node.right; }) {
+                count(node.right);
+            }
+        }, *s);
+    }
+
+    // Subroutine of every shared operator, numbered in the order they are first called
+    std::unordered_map<const Sentence::sentence_t*, uint32_t> subroutines;
+    std::vector<const Sentence::sentence_t*> bodies;
+
+    // Code generation with an explicit stack of frames,
+    // stage counts how many operands of the node have been emitted so far
+    struct Frame
+    {
+        const Sentence::sentence_t* sentence;
+        int stage;
+        size_t patch;
+    };
+    std::vector<Frame> frames;
+
+    auto emit = [this](Op op, uint32_t arg = 0) {
+        program_.push_back({op, arg});
+        return program_.size() - 1;
+    };
+    auto push = [&](const Sentence::sentence_ptr_t& child) {
+        const Sentence::sentence_t* c = child.get();
+        if (c != nullptr && c->index() >= Sentence::INDEX_NOT && parents.at(c) > 1) {
+            auto [it, added] = subroutines.try_emplace(c, uint32_t(bodies.size()));
+            if (added) {
+                bodies.push_back(c);
+            }
+            emit(Op::CALL, it->second);
+        } else {
+            frames.push_back({c, 0, 0});
+        }
+    };
+
+    // Emit the code of one node, shared operators below it become calls
+    auto compile = [&](const Sentence::sentence_t* root) {
+        frames.push_back({root, 0, 0});
+        size_t depth = 0;
+        size_t deepest = 0;
+
+        while (!frames.empty()) {
+            size_t f = frames.size() - 1;
+            const Sentence::sentence_t* s = frames[f].sentence;
+            int stage = frames[f].stage++;
+
+            if (s == nullptr) {
+                emit(Op::INVALID);
+                frames.pop_back();
+                continue;
+            }
+
+            switch (s->index()) {
+                case Sentence::INDEX_SYMBOL:
+                    if (auto index = sentence.symbol_slot(std::get<Sentence::INDEX_SYMBOL>(*s))) {
+                        emit(Op::LOAD_SYMBOL, *index);
+                    } else {
+                        emit(Op::INVALID);
+                    }
+                    frames.pop_back();
+                    break;
+                case Sentence::INDEX_BOOL:
+                    emit(Op::LOAD_BOOL, std::get<Sentence::INDEX_BOOL>(*s));
+                    frames.pop_back();
+                    break;
+                case Sentence::INDEX_NOT:
+                    if (stage == 0) {
+                        push(std::get<Sentence::INDEX_NOT>(*s).right);
+                    } else {
+                        emit(Op::NOT);
+                        frames.pop_back();
+                    }
+                    break;
+                case Sentence::INDEX_AND:
+                case Sentence::INDEX_OR: {
+                    bool is_and = s->index() == Sentence::INDEX_AND;
+                    const auto& left = is_and ? std::get<Sentence::And>(*s).left : std::get<Sentence::Or>(*s).left;
+                    const auto& right = is_and ? std::get<Sentence::And>(*s).right : std::get<Sentence::Or>(*s).right;
+                    if (stage == 0) {
+                        push(left);
+                    } else if (stage == 1) {
+                        frames[f].patch = emit(is_and ? Op::JUMP_FALSE : Op::JUMP_TRUE);
+                        push(right);
+                    } else {
+                        program_[frames[f].patch].arg = program_.size();
+                        frames.pop_back();
+                    }
+                    break;
+                }
+                case Sentence::INDEX_IMP: {
+                    // same order as Sentence::evaluate(), a true right hand side decides the result
+                    const auto& imp = std::get<Sentence::Imp>(*s);
+                    if (stage == 0) {
+                        push(imp.right);
+                    } else if (stage == 1) {
+                        frames[f].patch = emit(Op::JUMP_TRUE);
+                        push(imp.left);
+                    } else {
+                        emit(Op::NOT);
+                        program_[frames[f].patch].arg = program_.size();
+                        frames.pop_back();
+                    }
+                    break;
+                }
+                case Sentence::INDEX_IFF: {
+                    const auto& iff = std::get<Sentence::Iff>(*s);
+                    if (stage == 0) {
+                        push(iff.left);
+                    } else if (stage == 1) {
+                        emit(Op::PUSH);
+                        deepest = std::max(deepest, ++depth);
+                        push(iff.right);
+                    } else {
+                        emit(Op::IFF);
+                        --depth;
+                        frames.pop_back();
+                    }
+                    break;
+                }
+                default:
+                    emit(Op::INVALID);
+                    frames.pop_back();
+                    break;
+            }
+        }
+        // a subroutine is active at most once at a time, so the stacks of all of them add up to a bound
+        max_stack_ += deepest;
+    };
+
+    compile(sentence.data().get());
+    main_end_ = program_.size();
+    for (uint32_t k = 0; k < bodies.size(); ++k) {
+        entries_.push_back(uint32_t(program_.size()));
+        compile(bodies[k]);
+        emit(Op::RETURN, k);
+    }
+}
+
+std::optional<uint32_t> CompiledSentence::slot(std::string_view symbol) const
+{
+    auto it = std::ranges::lower_bound(symbols_, symbol);
+    if (it == symbols_.end() || *it != symbol) {
+        return std::nullopt;
+    }
+    return it - symbols_.begin();
+}
+
+std::optional<bool> CompiledSentence::evaluate(std::span<const bool> values) const
+{
+    if (values.size() != symbols_.size() || program_.empty()) {
+        return std::nullopt;
+    }
+    PIMPL_STATS_TIMER(EVALUATE);
+
+    // Iff nesting is shallow in practice, only spill to the heap for unusual programs
+    constexpr size_t SMALL_STACK = 64;
+    bool small_stack[SMALL_STACK];
+    std::unique_ptr<bool[]> large_stack;
+    bool* stack = small_stack;
+    if (max_stack_ > SMALL_STACK) {
+        large_stack = std::make_unique<bool[]>(max_stack_);
+        stack = large_stack.get();
+    }
+
+    // Cached value of every subroutine (0 until it has run, then 1 + value) and the return addresses
+    std::unique_ptr<uint8_t[]> cache;
+    std::unique_ptr<size_t[]> returns;
+    if (!entries_.empty()) {
+        cache = std::make_unique<uint8_t[]>(entries_.size());
+        returns = std::make_unique<size_t[]>(entries_.size());
+    }
+    size_t rp = 0;
+
+    const Instruction* code = program_.data();
+    const size_t end = main_end_;
+    const bool* slots = values.data();
+    size_t sp = 0;
+    bool acc = false;
+    uint64_t executed = 0;
+    uint64_t jumps = 0;
+
+    for (size_t pc = 0; pc < end || rp != 0; ++executed) {
+        const Instruction in = code[pc++];
+        switch (in.op) {
+            case Op::LOAD_SYMBOL:
+                acc = slots[in.arg];
+                break;
+            case Op::LOAD_BOOL:
+                acc = in.arg != 0;
+                break;
+            case Op::INVALID:
+                PIMPL_STATS_ADD(NODES_VISITED, executed + 1);
+                return std::nullopt;
+            case Op::NOT:
+                acc = !acc;
+                break;
+            case Op::JUMP_FALSE:
+                if (!acc) pc = in.arg, ++jumps;
+                break;
+            case Op::JUMP_TRUE:
+                if (acc) pc = in.arg, ++jumps;
+                break;
+            case Op::PUSH:
+                stack[sp++] = acc;
+                break;
+            case Op::IFF:
+                acc = stack[--sp] == acc;
+                break;
+            case Op::CALL:
+                if (cache[in.arg] != 0) {
+                    acc = cache[in.arg] == 2;
+                } else {
+                    returns[rp++] = pc;
+                    pc = entries_[in.arg];
+                }
+                break;
+            case Op::RETURN:
+                cache[in.arg] = acc ? 2 : 1;
+                pc = returns[--rp];
+                break;
+        }
+    }
+
+    PIMPL_STATS_ADD(NODES_VISITED, executed);
+    PIMPL_STATS_ADD(SHORT_CIRCUITS, jumps);
+    return acc;
+}
+
+std::optional<bool> CompiledSentence::evaluate(
+    const std::unordered_map<std::string, bool>& symbol_values) const
+{
+    if (symbol_values.size() != symbols_.size()) {
+        return std::nullopt;
+    }
+
+    auto values = std::make_unique<bool[]>(symbols_.size());
+    for (size_t i = 0; i < symbols_.size(); ++i) {
+        auto it = symbol_values.find(symbols_[i]);
+        if (it == symbol_values.end()) {
+            return std::nullopt;
+        }
+        values[i] = it->second;
+    }
+
+    return evaluate(std::span<const bool>(values.get(), symbols_.size()));
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <random>
+
+#include "random_sentence.hpp"
+
+TEST_CASE("CompiledSentence")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+
+    auto sym = [](const char* name) { return std::make_shared<s_t>(name); };
+    auto lit = [](bool b) { return std::make_shared<s_t>(b); };
+
+    SUBCASE("empty sentence") {
+        CompiledSentence compiled{Sentence()};
+        CHECK(compiled.evaluate(std::unordered_map<std::string, bool>{}) == std::nullopt);
+    }
+
+    SUBCASE("constants") {
+        // (T => F) <=> ~(F | (T & F))
+        auto data = std::make_shared<s_t>(Sentence::Iff(
+            std::make_shared<s_t>(Sentence::Imp(lit(true), lit(false))),
+            std::make_shared<s_t>(Sentence::Not(std::make_shared<s_t>(Sentence::Or(
+                lit(false),
+                std::make_shared<s_t>(Sentence::And(lit(true), lit(false)))))))
+        ));
+        Sentence sentence(data, {});
+        CompiledSentence compiled(sentence);
+        CHECK(compiled.symbols().empty());
+        CHECK(compiled.evaluate(std::span<const bool>()) == sentence.truth());
+        CHECK(compiled.evaluate(std::span<const bool>()) == false);
+    }
+
+    SUBCASE("matches Sentence::evaluate on every assignment") {
+        // ((a & b) | ~c) => (b <=> (c <=> a))
+        auto a = sym("a");
+        auto b = sym("b");
+        auto c = sym("c");
+        auto data = std::make_shared<s_t>(Sentence::Imp(
+            std::make_shared<s_t>(Sentence::Or(
+                std::make_shared<s_t>(Sentence::And(a, b)),
+                std::make_shared<s_t>(Sentence::Not(c)))),
+            std::make_shared<s_t>(Sentence::Iff(b, std::make_shared<s_t>(Sentence::Iff(c, a))))
+        ));
+        Sentence sentence(data, {{"a", a}, {"b", b}, {"c", c}});
+        CompiledSentence compiled(sentence);
+        REQUIRE(compiled.symbols() == std::vector<std::string>{"a", "b", "c"});
+        CHECK(compiled.slot("b") == 1u);
+        CHECK(compiled.slot("d") == std::nullopt);
+
+        for (int row = 0; row < 8; ++row) {
+            bool values[3] = {(row & 1) != 0, (row & 2) != 0, (row & 4) != 0};
+            std::unordered_map<std::string, bool> by_name{
+                {"a", values[0]}, {"b", values[1]}, {"c", values[2]}};
+            auto expected = sentence.evaluate(by_name);
+            REQUIRE(expected);
+            CHECK(compiled.evaluate(values) == expected);
+            CHECK(compiled.evaluate(by_name) == expected);
+        }
+    }
+
+    SUBCASE("short-circuits past malformed operands") {
+        auto a = sym("a");
+        auto data = std::make_shared<s_t>(Sentence::And(
+            a, std::make_shared<s_t>(std::monostate())));
+        CompiledSentence compiled(Sentence(data, {{"a", a}}));
+        bool f[] = {false};
+        bool t[] = {true};
+        CHECK(compiled.evaluate(f) == false);
+        CHECK(compiled.evaluate(t) == std::nullopt);
+    }
+
+    SUBCASE("shared subterms are compiled once") {
+        // x_{i+1} = x_i & x_i, 2^64 leaves as a tree
+        constexpr int LEVELS = 64;
+        auto a = sym("a");
+        Sentence::sentence_ptr_t x = a;
+        for (int i = 0; i < LEVELS; ++i) {
+            x = std::make_shared<s_t>(Sentence::And(x, x));
+        }
+        CompiledSentence chain(Sentence(x, {{"a", a}}));
+        CHECK(chain.program().size() <= 5 * LEVELS);
+        bool f[] = {false};
+        bool t[] = {true};
+        CHECK(chain.evaluate(f) == false);
+        CHECK(chain.evaluate(t) == true);
+
+        // the cache is per evaluation and a shared node can be reached after being skipped
+        auto top = std::make_shared<s_t>(Sentence::Iff(x, std::make_shared<s_t>(Sentence::Not(x))));
+        CompiledSentence both(Sentence(std::make_shared<s_t>(Sentence::Or(
+            std::make_shared<s_t>(Sentence::And(lit(false), x)), top)), {{"a", a}}));
+        CHECK(both.program().size() <= 5 * LEVELS + 16);
+        CHECK(both.evaluate(f) == false);
+        CHECK(both.evaluate(t) == false);
+    }
+
+    SUBCASE("matches Sentence::evaluate on random DAGs") {
+        std::mt19937 rng(3);
+        constexpr size_t SYMBOLS = 5;
+        for (int trial = 0; trial < 50; ++trial) {
+            auto symbols = pimpl::test::random_symbols(SYMBOLS);
+            std::vector<Sentence::sentence_ptr_t> pool = symbols.leaves;
+            pool.push_back(std::make_shared<s_t>(std::monostate()));
+            const Sentence sentence(pimpl::test::grow_random(rng, pool, 30), symbols.table);
+            CompiledSentence compiled(sentence);
+            for (unsigned bits = 0; bits < (1u << SYMBOLS); ++bits) {
+                bool values[SYMBOLS];
+                for (size_t i = 0; i < SYMBOLS; ++i) {
+                    values[i] = bits & (1u << i);
+                }
+                CHECK(compiled.evaluate(values) == sentence.evaluate_ids(values));
+            }
+        }
+    }
+
+    SUBCASE("mismatched inputs") {
+        auto a = sym("a");
+        CompiledSentence compiled(Sentence(std::make_shared<s_t>(Sentence::Or(a, sym("b"))), {{"a", a}}));
+        bool t[] = {true};
+        bool tt[] = {true, true};
+        CHECK(compiled.evaluate(tt) == std::nullopt);
+        CHECK(compiled.evaluate(t) == true);
+        CHECK(compiled.evaluate(std::unordered_map<std::string, bool>{{"b", true}}) == std::nullopt);
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
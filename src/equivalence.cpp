@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <random>
+#include <utility>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/cnf.hpp"
+#include "pimpl/equivalence.hpp"
+#include "pimpl/node_store.hpp"
+#include "pimpl/solver.hpp"
+
+namespace pimpl
+{
+
+namespace
+{
+
+using Kind = NodeStore::Kind;
+using node_id_t = NodeStore::node_id_t;
+
+enum class Relation
+{
+    EQUIVALENT,
+    IMPLIES,
+};
+
+// Words per node simulated at once, and how many rounds before giving up to the solver
+constexpr size_t SIM_WORDS = 8;
+constexpr size_t SIM_ROUNDS = 4;
+// Up to this many symbols the rounds cover the whole truth table, so simulation is a proof
+constexpr size_t EXHAUSTIVE_SYMBOLS = std::bit_width(64 * SIM_WORDS * SIM_ROUNDS) - 1;
+
+// Bit patterns of the first six symbols within a word of the truth table
+constexpr uint64_t ROW_PATTERNS[6] = {
+    0xaaaaaaaaaaaaaaaaull,
+    0xccccccccccccccccull,
+    0xf0f0f0f0f0f0f0f0ull,
+    0xff00ff00ff00ff00ull,
+    0xffff0000ffff0000ull,
+    0xffffffff00000000ull,
+};
+
+// Rebuild every node with the operands of AND, OR and IFF in id order and without double negations
+// Returns the normalized id of each of the first n nodes, new nodes are appended to the store
+std::vector<node_id_t> normalize(NodeStore& store)
+{
+    const size_t n = store.size();
+    std::vector<node_id_t> normal(n);
+    for (node_id_t id = 0; id < n; ++id) {
+        const auto node = store[id];
+        switch (node.kind) {
+            case Kind::SYMBOL:
+            case Kind::BOOL:
+                normal[id] = id;
+                break;
+            case Kind::NOT: {
+                const node_id_t operand = normal[node.left];
+                normal[id] = store[operand].kind == Kind::NOT ? store[operand].left : store.make_not(operand);
+                break;
+            }
+            case Kind::IMP:
+                normal[id] = store.make_binary(node.kind, normal[node.left], normal[node.right]);
+                break;
+            default:
+                normal[id] = store.make_binary(node.kind, std::min(normal[node.left], normal[node.right]),
+                                               std::max(normal[node.left], normal[node.right]));
+                break;
+        }
+    }
+    return normal;
+}
+
+// Bit-parallel simulation of the first n nodes, SIM_WORDS words per node
+void simulate(const NodeStore& store, size_t n, const uint64_t* symbols, uint64_t* values)
+{
+    for (size_t i = 0; i < n; ++i) {
+        const auto& node = store[i];
+        uint64_t* out = values + i * SIM_WORDS;
+        const uint64_t* l = values + size_t(node.left) * SIM_WORDS;
+        const uint64_t* r = values + size_t(node.right) * SIM_WORDS;
+        for (size_t w = 0; w < SIM_WORDS; ++w) {
+            switch (node.kind) {
+                case Kind::SYMBOL: out[w] = symbols[size_t(node.left) * SIM_WORDS + w]; break;
+                case Kind::BOOL: out[w] = node.left ? ~0ull : 0ull; break;
+                case Kind::NOT: out[w] = ~l[w]; break;
+                case Kind::AND: out[w] = l[w] & r[w]; break;
+                case Kind::OR: out[w] = l[w] | r[w]; break;
+                case Kind::IMP: out[w] = ~l[w] | r[w]; break;
+                case Kind::IFF: out[w] = ~(l[w] ^ r[w]); break;
+            }
+        }
+    }
+}
+
+std::optional<EquivalenceResult> check(const Sentence& a, const Sentence& b, Relation relation,
+                                       EquivalenceStats* stats)
+{
+    if (a.data() == nullptr || b.data() == nullptr) {
+        return std::nullopt;
+    }
+
+    EquivalenceResult result;
+    std::ranges::set_union(a.symbol_names(), b.symbol_names(), std::back_inserter(result.symbols));
+
+    // interning the union first makes store symbol ids equal to indices into result.symbols
+    NodeStore store;
+    for (const auto& name : result.symbols) {
+        store.intern(name);
+    }
+    auto root_a = store.add(a);
+    auto root_b = store.add(b);
+    if (!root_a || !root_b) {
+        return std::nullopt;
+    }
+
+    EquivalenceStats local;
+    if (stats == nullptr) {
+        stats = &local;
+    }
+    *stats = {};
+
+    const auto normal = normalize(store);
+    const node_id_t ra = normal[*root_a];
+    const node_id_t rb = normal[*root_b];
+    const bool trivial = relation == Relation::IMPLIES
+        && ((store[ra].kind == Kind::BOOL && !store[ra].left) || (store[rb].kind == Kind::BOOL && store[rb].left));
+    if (ra == rb || trivial) {
+        stats->decided_by = EquivalenceStats::Stage::STRUCTURE;
+        result.holds = true;
+        return result;
+    }
+
+    // Simulation, exhaustive for few symbols and seeded for reproducible counterexamples otherwise
+    const size_t n_symbols = result.symbols.size();
+    const size_t n_nodes = std::max(ra, rb) + 1;
+    const bool exhaustive = n_symbols <= EXHAUSTIVE_SYMBOLS;
+    const size_t rounds = exhaustive ? std::max<size_t>(1, (size_t(1) << n_symbols) / (64 * SIM_WORDS)) : SIM_ROUNDS;
+    std::mt19937_64 rng(0x5eed);
+    std::vector<uint64_t> symbols(n_symbols * SIM_WORDS);
+    std::vector<uint64_t> values(n_nodes * SIM_WORDS);
+
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t s = 0; s < n_symbols; ++s) {
+            for (size_t w = 0; w < SIM_WORDS; ++w) {
+                const size_t word = round * SIM_WORDS + w;
+                if (!exhaustive) {
+                    symbols[s * SIM_WORDS + w] = rng();
+                } else if (s < 6) {
+                    symbols[s * SIM_WORDS + w] = ROW_PATTERNS[s];
+                } else {
+                    symbols[s * SIM_WORDS + w] = (word >> (s - 6)) & 1 ? ~0ull : 0ull;
+                }
+            }
+        }
+        simulate(store, n_nodes, symbols.data(), values.data());
+        stats->simulated_words += SIM_WORDS;
+
+        for (size_t w = 0; w < SIM_WORDS; ++w) {
+            const uint64_t va = values[ra * SIM_WORDS + w];
+            const uint64_t vb = values[rb * SIM_WORDS + w];
+            const uint64_t failing = relation == Relation::EQUIVALENT ? va ^ vb : va & ~vb;
+            if (failing != 0) {
+                const int bit = std::countr_zero(failing);
+                std::vector<bool> assignment(n_symbols);
+                for (size_t s = 0; s < n_symbols; ++s) {
+                    assignment[s] = (symbols[s * SIM_WORDS + w] >> bit) & 1;
+                }
+                stats->decided_by = EquivalenceStats::Stage::SIMULATION;
+                result.counterexample = std::move(assignment);
+                return result;
+            }
+        }
+    }
+    if (exhaustive) {
+        stats->decided_by = EquivalenceStats::Stage::SIMULATION;
+        result.holds = true;
+        return result;
+    }
+
+    // A model of the miter is an assignment under which the relation fails
+    const node_id_t miter = relation == Relation::EQUIVALENT
+        ? store.make_not(store.make_binary(Kind::IFF, ra, rb))
+        : store.make_binary(Kind::AND, ra, store.make_not(rb));
+    Solver solver(to_cnf(store, miter));
+    stats->decided_by = EquivalenceStats::Stage::SAT;
+    if (!solver.solve()) {
+        result.holds = true;
+        return result;
+    }
+    result.counterexample.emplace(solver.model().begin(), solver.model().begin() + n_symbols);
+    return result;
+}
+
+}   // namespace
+
+std::optional<EquivalenceResult> equivalent(const Sentence& a, const Sentence& b, EquivalenceStats* stats)
+{
+    return check(a, b, Relation::EQUIVALENT, stats);
+}
+
+std::optional<EquivalenceResult> implies(const Sentence& a, const Sentence& b, EquivalenceStats* stats)
+{
+    return check(a, b, Relation::IMPLIES, stats);
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <memory>
+
+#include "random_sentence.hpp"
+
+namespace
+{
+
+using s_t = pimpl::Sentence::sentence_t;
+using ptr_t = pimpl::Sentence::sentence_ptr_t;
+
+// Truth of sentence under an assignment to the symbols of an EquivalenceResult
+std::optional<bool> evaluate_over(const pimpl::Sentence& sentence, const std::vector<std::string>& symbols,
+                                  const std::vector<bool>& values)
+{
+    std::unordered_map<std::string, bool> assignment;
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        if (sentence.symbols().contains(symbols[i])) {
+            assignment.emplace(symbols[i], values[i]);
+        }
+    }
+    return sentence.evaluate(assignment);
+}
+
+}   // namespace
+
+TEST_CASE("equivalent and implies")
+{
+    using namespace pimpl;
+    using Stage = EquivalenceStats::Stage;
+
+    auto a = std::make_shared<s_t>("a");
+    auto b = std::make_shared<s_t>("b");
+    auto c = std::make_shared<s_t>("c");
+    auto make = [](ptr_t root, std::unordered_map<std::string, ptr_t> symbols) {
+        return Sentence(std::move(root), std::move(symbols));
+    };
+
+    SUBCASE("structure") {
+        EquivalenceStats stats;
+        // b & a == ~~(a & b), with different shared_ptrs throughout
+        auto lhs = make(std::make_shared<s_t>(Sentence::And(b, a)), {{"a", a}, {"b", b}});
+        auto rhs = make(std::make_shared<s_t>(Sentence::Not(std::make_shared<s_t>(Sentence::Not(
+                            std::make_shared<s_t>(Sentence::And(std::make_shared<s_t>("a"), std::make_shared<s_t>("b"))))))),
+                        {{"a", a}, {"b", b}});
+        auto result = equivalent(lhs, rhs, &stats);
+        REQUIRE(result);
+        CHECK(result->holds);
+        CHECK(!result->counterexample);
+        CHECK(stats.decided_by == Stage::STRUCTURE);
+        CHECK(stats.simulated_words == 0);
+    }
+
+    SUBCASE("counterexamples") {
+        // a | b vs a & b over the union {a, b}, and a vs b which don't share a symbol
+        EquivalenceStats stats;
+        auto disjunction = make(std::make_shared<s_t>(Sentence::Or(a, b)), {{"a", a}, {"b", b}});
+        auto conjunction = make(std::make_shared<s_t>(Sentence::And(a, b)), {{"a", a}, {"b", b}});
+        auto result = equivalent(disjunction, conjunction, &stats);
+        REQUIRE(result);
+        CHECK(!result->holds);
+        CHECK(result->symbols == std::vector<std::string>{"a", "b"});
+        REQUIRE(result->counterexample);
+        CHECK((*result->counterexample)[0] != (*result->counterexample)[1]);
+        CHECK(stats.decided_by == Stage::SIMULATION);
+
+        CHECK(implies(conjunction, disjunction)->holds);
+        result = implies(disjunction, conjunction);
+        REQUIRE(result->counterexample);
+        CHECK(evaluate_over(disjunction, result->symbols, *result->counterexample) == true);
+        CHECK(evaluate_over(conjunction, result->symbols, *result->counterexample) == false);
+
+        result = equivalent(make(a, {{"a", a}}), make(c, {{"c", c}}));
+        CHECK(result->symbols == std::vector<std::string>{"a", "c"});
+        CHECK(!result->holds);
+    }
+
+    SUBCASE("constants") {
+        auto contradiction = make(std::make_shared<s_t>(Sentence::And(a, std::make_shared<s_t>(Sentence::Not(a)))),
+                                  {{"a", a}});
+        auto falsum = make(std::make_shared<s_t>(false), {});
+        auto verum = make(std::make_shared<s_t>(true), {});
+        EquivalenceStats stats;
+        CHECK(implies(falsum, make(b, {{"b", b}}), &stats)->holds);
+        CHECK(stats.decided_by == Stage::STRUCTURE);
+        CHECK(implies(make(b, {{"b", b}}), verum)->holds);
+        CHECK(equivalent(contradiction, falsum)->holds);
+        CHECK(!equivalent(verum, falsum)->holds);
+    }
+
+    SUBCASE("malformed") {
+        auto sentence = make(a, {{"a", a}});
+        CHECK(!equivalent(sentence, Sentence()));
+        CHECK(!implies(Sentence(), sentence));
+        CHECK(!equivalent(sentence, make(a, {})));
+    }
+
+    SUBCASE("agrees with enumeration") {
+        std::mt19937 rng(23);
+        constexpr size_t SYMBOLS = 6;
+        auto symbols = test::random_symbols(SYMBOLS);
+
+        int equal = 0;
+        for (int trial = 0; trial < 300; ++trial) {
+            const int ops = 1 + int(rng() % 6);
+            std::vector<ptr_t> pool = symbols.leaves;
+            auto lhs = make(test::grow_random(rng, pool, ops), symbols.table);
+            pool = symbols.leaves;
+            auto rhs = make(test::grow_random(rng, pool, ops), symbols.table);
+
+            bool expect_equivalent = true;
+            bool expect_implies = true;
+            std::vector<bool> values(SYMBOLS);
+            for (unsigned bits = 0; bits < (1u << SYMBOLS); ++bits) {
+                for (size_t i = 0; i < SYMBOLS; ++i) {
+                    values[i] = bits & (1u << i);
+                }
+                const bool l = *evaluate_over(lhs, lhs.symbol_names(), values);
+                const bool r = *evaluate_over(rhs, rhs.symbol_names(), values);
+                expect_equivalent &= l == r;
+                expect_implies &= !l || r;
+            }
+            equal += expect_equivalent;
+
+            auto eq = equivalent(lhs, rhs);
+            auto imp = implies(lhs, rhs);
+            REQUIRE(eq);
+            REQUIRE(imp);
+            CHECK(eq->holds == expect_equivalent);
+            CHECK(imp->holds == expect_implies);
+            if (eq->counterexample) {
+                CHECK(evaluate_over(lhs, eq->symbols, *eq->counterexample)
+                      != evaluate_over(rhs, eq->symbols, *eq->counterexample));
+            }
+            if (imp->counterexample) {
+                CHECK(evaluate_over(lhs, imp->symbols, *imp->counterexample) == true);
+                CHECK(evaluate_over(rhs, imp->symbols, *imp->counterexample) == false);
+            }
+        }
+        CHECK(equal > 0);
+    }
+
+    SUBCASE("the solver decides wide sentences") {
+        // (x0 & y0) | ... | (x31 & y31) against its De Morgan dual ~((~x0 | ~y0) & ...)
+        std::unordered_map<std::string, ptr_t> symbols;
+        ptr_t lhs;
+        ptr_t dual;
+        for (int i = 0; i < 32; ++i) {
+            auto x = std::make_shared<s_t>("x" + std::to_string(i));
+            auto y = std::make_shared<s_t>("y" + std::to_string(i));
+            symbols.emplace("x" + std::to_string(i), x);
+            symbols.emplace("y" + std::to_string(i), y);
+            auto term = std::make_shared<s_t>(Sentence::And(x, y));
+            auto clause = std::make_shared<s_t>(Sentence::Or(std::make_shared<s_t>(Sentence::Not(x)),
+                                                             std::make_shared<s_t>(Sentence::Not(y))));
+            lhs = lhs ? std::make_shared<s_t>(Sentence::Or(lhs, term)) : term;
+            dual = dual ? std::make_shared<s_t>(Sentence::And(dual, clause)) : clause;
+        }
+        auto rhs = std::make_shared<s_t>(Sentence::Not(dual));
+
+        EquivalenceStats stats;
+        auto result = equivalent(make(lhs, symbols), make(rhs, symbols), &stats);
+        REQUIRE(result);
+        CHECK(result->holds);
+        CHECK(stats.decided_by == Stage::SAT);
+        CHECK(stats.simulated_words == SIM_WORDS * SIM_ROUNDS);
+
+        // x0 & y0 & ... & x31 & y31 is true in one of 2^64 assignments, so only the solver finds it
+        ptr_t all;
+        for (const auto& [_, leaf] : symbols) {
+            all = all ? std::make_shared<s_t>(Sentence::And(all, leaf)) : leaf;
+        }
+        auto falsum = make(std::make_shared<s_t>(false), {});
+        result = equivalent(make(all, symbols), falsum, &stats);
+        CHECK(!result->holds);
+        CHECK(stats.decided_by == Stage::SAT);
+        REQUIRE(result->counterexample);
+        CHECK(std::ranges::count(*result->counterexample, true) == 64);
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
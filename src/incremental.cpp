@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <functional>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/incremental.hpp"
+#include "pimpl/stats.hpp"
+
+namespace pimpl
+{
+
+using Kind = NodeStore::Kind;
+
+IncrementalEvaluator::IncrementalEvaluator(const Sentence& sentence)
+{
+    // store symbol i is sentence symbol i, so values can be passed through unchanged
+    auto root = store_.add(sentence);
+    if (!root) {
+        return;
+    }
+    root_ = *root;
+
+    // parent links in CSR form, counted first and then filled in
+    const size_t n = store_.size();
+    symbol_nodes_.assign(store_.symbol_count(), NodeStore::INVALID);
+    parent_offsets_.assign(n + 1, 0);
+    for (NodeStore::node_id_t id = 0; id < n; ++id) {
+        const auto& node = store_[id];
+        if (node.kind == Kind::SYMBOL) {
+            symbol_nodes_[node.left] = id;
+        } else if (node.kind == Kind::NOT) {
+            ++parent_offsets_[node.left + 1];
+        } else if (NodeStore::is_binary(node.kind)) {
+            ++parent_offsets_[node.left + 1];
+            // x & x lists its parent once
+            if (node.right != node.left) {
+                ++parent_offsets_[node.right + 1];
+            }
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        parent_offsets_[i + 1] += parent_offsets_[i];
+    }
+    parents_.resize(parent_offsets_[n]);
+    std::vector<uint32_t> fill(parent_offsets_.begin(), parent_offsets_.end() - 1);
+    for (NodeStore::node_id_t id = 0; id < n; ++id) {
+        const auto& node = store_[id];
+        if (node.kind == Kind::NOT || NodeStore::is_binary(node.kind)) {
+            parents_[fill[node.left]++] = id;
+        }
+        if (NodeStore::is_binary(node.kind) && node.right != node.left) {
+            parents_[fill[node.right]++] = id;
+        }
+    }
+    queued_.assign(n, false);
+}
+
+bool IncrementalEvaluator::compute(NodeStore::node_id_t id) const
+{
+    // a leaf keeps the value it was last set to
+    return store_[id].kind == Kind::SYMBOL ? values_[id] : node_value(store_[id], values_.data());
+}
+
+std::optional<bool> IncrementalEvaluator::reset(std::span<const bool> values)
+{
+    if (root_ == NodeStore::INVALID || values.size() != symbol_count()) {
+        return std::nullopt;
+    }
+    PIMPL_STATS_TIMER(EVALUATE);
+
+    values_.assign(store_.size(), 0);
+    evaluate_nodes(store_.nodes(), values, std::span(values_));
+    PIMPL_STATS_ADD(NODES_VISITED, store_.size());
+    last_recomputed_ = store_.size();
+    return value();
+}
+
+std::optional<bool> IncrementalEvaluator::set(uint32_t symbol, bool value)
+{
+    const std::pair<uint32_t, bool> change{symbol, value};
+    return update(std::span(&change, 1));
+}
+
+std::optional<bool> IncrementalEvaluator::update(std::span<const std::pair<uint32_t, bool>> changes)
+{
+    if (values_.empty()) {
+        return std::nullopt;
+    }
+    for (const auto& [symbol, _] : changes) {
+        if (symbol >= symbol_count()) {
+            return std::nullopt;
+        }
+    }
+    PIMPL_STATS_TIMER(EVALUATE);
+
+    const auto schedule_parents = [this](NodeStore::node_id_t id) {
+        for (uint32_t i = parent_offsets_[id]; i < parent_offsets_[id + 1]; ++i) {
+            const auto parent = parents_[i];
+            if (!queued_[parent]) {
+                queued_[parent] = true;
+                heap_.push_back(parent);
+                std::ranges::push_heap(heap_, std::greater<>());
+            }
+        }
+    };
+
+    size_t recomputed = 0;
+    for (const auto& [symbol, value] : changes) {
+        const auto leaf = symbol_nodes_[symbol];
+        if (leaf != NodeStore::INVALID && values_[leaf] != value) {
+            values_[leaf] = value;
+            schedule_parents(leaf);
+        }
+    }
+
+    // a node only pops once every queued node below it has been settled
+    while (!heap_.empty()) {
+        std::ranges::pop_heap(heap_, std::greater<>());
+        const auto id = heap_.back();
+        heap_.pop_back();
+        queued_[id] = false;
+        ++recomputed;
+
+        const bool value = compute(id);
+        if (value != bool(values_[id])) {
+            values_[id] = value;
+            schedule_parents(id);
+        }
+    }
+
+    PIMPL_STATS_ADD(NODES_VISITED, recomputed);
+    last_recomputed_ = recomputed;
+    return value();
+}
+
+std::optional<bool> IncrementalEvaluator::value() const
+{
+    if (values_.empty()) {
+        return std::nullopt;
+    }
+    return values_[root_] != 0;
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <memory>
+#include <random>
+
+#include "random_sentence.hpp"
+
+TEST_CASE("IncrementalEvaluator")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+    using ptr_t = Sentence::sentence_ptr_t;
+
+    SUBCASE("empty sentence") {
+        IncrementalEvaluator evaluator{Sentence()};
+        CHECK(evaluator.reset(std::span<const bool>()) == std::nullopt);
+        CHECK(evaluator.set(0, true) == std::nullopt);
+        CHECK(evaluator.value() == std::nullopt);
+    }
+
+    SUBCASE("matches Sentence::evaluate after every change") {
+        std::mt19937 rng(5);
+        constexpr size_t SYMBOLS = 8;
+        auto symbols = test::random_symbols(SYMBOLS);
+        std::vector<ptr_t> pool{std::make_shared<s_t>(true)};
+        pool.insert(pool.end(), symbols.leaves.begin(), symbols.leaves.end());
+        const Sentence sentence(test::grow_random(rng, pool, 200), symbols.table);
+
+        bool values[SYMBOLS] = {};
+        IncrementalEvaluator evaluator(sentence);
+        CHECK(evaluator.reset(values) == sentence.evaluate_ids(values));
+        for (int i = 0; i < 500; ++i) {
+            const uint32_t symbol = rng() % SYMBOLS;
+            values[symbol] = rng() % 2;
+            if (i % 5 == 0) {
+                const uint32_t other = rng() % SYMBOLS;
+                values[other] = !values[other];
+                const std::pair<uint32_t, bool> changes[] = {{symbol, values[symbol]}, {other, values[other]}};
+                REQUIRE(evaluator.update(changes) == sentence.evaluate_ids(values));
+            } else {
+                REQUIRE(evaluator.set(symbol, values[symbol]) == sentence.evaluate_ids(values));
+            }
+        }
+        CHECK(evaluator.set(SYMBOLS, true) == std::nullopt);
+    }
+
+    SUBCASE("work is proportional to the change") {
+        // a wide conjunction of independent clauses, one flip only touches its own path to the root
+        constexpr size_t CLAUSES = 1024;
+        std::unordered_map<std::string, ptr_t> symbols;
+        std::vector<ptr_t> level;
+        for (size_t i = 0; i < CLAUSES; ++i) {
+            const std::string a = "a" + std::to_string(i);
+            const std::string b = "b" + std::to_string(i);
+            auto sa = std::make_shared<s_t>(a);
+            auto sb = std::make_shared<s_t>(b);
+            symbols.emplace(a, sa);
+            symbols.emplace(b, sb);
+            level.push_back(std::make_shared<s_t>(Sentence::Or(sa, sb)));
+        }
+        while (level.size() > 1) {
+            std::vector<ptr_t> next;
+            for (size_t i = 0; i < level.size(); i += 2) {
+                next.push_back(std::make_shared<s_t>(Sentence::And(level[i], level[i + 1])));
+            }
+            level = std::move(next);
+        }
+        const Sentence sentence(level.front(), symbols);
+
+        std::unique_ptr<bool[]> values(new bool[2 * CLAUSES]);
+        std::fill_n(values.get(), 2 * CLAUSES, true);
+        IncrementalEvaluator evaluator(sentence);
+        REQUIRE(evaluator.reset(std::span(values.get(), 2 * CLAUSES)) == true);
+        const auto a0 = *sentence.symbol_id("a0");
+        const auto b0 = *sentence.symbol_id("b0");
+
+        // b0 still holds the clause up, nothing above it changes
+        CHECK(evaluator.set(a0, false) == true);
+        CHECK(evaluator.last_recomputed() == 1);
+        // now the whole path to the root flips, one node per level
+        CHECK(evaluator.set(b0, false) == false);
+        CHECK(evaluator.last_recomputed() == 11);
+        // setting a value it already has does nothing
+        CHECK(evaluator.set(b0, false) == false);
+        CHECK(evaluator.last_recomputed() == 0);
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
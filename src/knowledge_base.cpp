@@ -0,0 +1,247 @@
+#include <algorithm>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/knowledge_base.hpp"
+
+namespace pimpl
+{
+
+std::optional<KnowledgeBase::fact_id_t> KnowledgeBase::tell(const Sentence& sentence)
+{
+    auto root = add(sentence);
+    if (!root) {
+        return std::nullopt;
+    }
+
+    // selector => sentence, the fact only holds while its selector is assumed
+    const lit_t selector = make_lit(solver_.new_var());
+    solver_.add_clause({lit_not(selector), encode(*root)});
+
+    facts_.push_back(*root);
+    selectors_.push_back(selector);
+    active_.push_back(selector);
+    return facts_.size() - 1;
+}
+
+bool KnowledgeBase::retract(fact_id_t fact)
+{
+    if (fact >= selectors_.size()) {
+        return false;
+    }
+    auto it = std::ranges::find(active_, selectors_[fact]);
+    if (it == active_.end()) {
+        return false;
+    }
+    active_.erase(it);
+
+    // disable the guarded clause for good, clauses learned from it stay sound
+    solver_.add_clause({lit_not(selectors_[fact])});
+    return true;
+}
+
+std::optional<bool> KnowledgeBase::ask(const Sentence& query)
+{
+    auto root = add(query);
+    if (!root) {
+        return std::nullopt;
+    }
+
+    // entailed when the facts and the negated query have no model
+    std::vector<lit_t> assumptions(active_);
+    assumptions.push_back(lit_not(encode(*root)));
+    return !solver_.solve(assumptions);
+}
+
+bool KnowledgeBase::consistent()
+{
+    return solver_.solve(active_);
+}
+
+std::optional<NodeStore::node_id_t> KnowledgeBase::add(const Sentence& sentence)
+{
+    if (sentence.data() == nullptr) {
+        return std::nullopt;
+    }
+    return store_.add(*sentence.data());
+}
+
+lit_t KnowledgeBase::encode(NodeStore::node_id_t root)
+{
+    using Kind = NodeStore::Kind;
+
+    lits_.resize(store_.size(), NO_LIT);
+    if (lits_[root] != NO_LIT) {
+        return lits_[root];
+    }
+
+    // collect the nodes that were never encoded, older nodes are already in the solver
+    std::vector<NodeStore::node_id_t> fresh;
+    std::vector<NodeStore::node_id_t> stack{root};
+    auto visit = [this, &stack](NodeStore::node_id_t id) {
+        if (lits_[id] == NO_LIT) {
+            lits_[id] = QUEUED;
+            stack.push_back(id);
+        }
+    };
+    lits_[root] = QUEUED;
+    while (!stack.empty()) {
+        auto id = stack.back();
+        stack.pop_back();
+        fresh.push_back(id);
+
+        const auto& n = store_[id];
+        if (n.kind == Kind::NOT) {
+            visit(n.left);
+        } else if (NodeStore::is_binary(n.kind)) {
+            visit(n.left);
+            visit(n.right);
+        }
+    }
+
+    // children before parents, with both polarities since a node may be asked either way later
+    std::ranges::sort(fresh);
+    auto add_clause = [this](std::initializer_list<lit_t> clause) { solver_.add_clause(clause); };
+    for (auto id : fresh) {
+        const auto& n = store_[id];
+        switch (n.kind) {
+            case Kind::SYMBOL:
+                lits_[id] = make_lit(solver_.new_var());
+                break;
+            case Kind::BOOL:
+                if (!true_lit_) {
+                    true_lit_ = make_lit(solver_.new_var());
+                    solver_.add_clause({*true_lit_});
+                }
+                lits_[id] = n.left ? *true_lit_ : lit_not(*true_lit_);
+                break;
+            case Kind::NOT:
+                lits_[id] = lit_not(lits_[n.left]);
+                break;
+            default:
+                lits_[id] = make_lit(solver_.new_var());
+                cnf::define(n.kind, lits_[id], lits_[n.left], lits_[n.right], cnf::BOTH, add_clause);
+                break;
+        }
+    }
+
+    return lits_[root];
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+
+namespace
+{
+
+using s_t = pimpl::Sentence::sentence_t;
+
+// Every sentence gets its own symbol leaves, as if it had been parsed on its own line
+pimpl::Sentence symbol(const std::string& name)
+{
+    auto data = std::make_shared<s_t>(name);
+    return pimpl::Sentence(data, {{name, data}});
+}
+
+pimpl::Sentence imp(const std::string& a, const std::string& b)
+{
+    auto l = std::make_shared<s_t>(a);
+    auto r = std::make_shared<s_t>(b);
+    return pimpl::Sentence(std::make_shared<s_t>(pimpl::Sentence::Imp(l, r)), {{a, l}, {b, r}});
+}
+
+pimpl::Sentence negation(const std::string& name)
+{
+    auto data = std::make_shared<s_t>(name);
+    return pimpl::Sentence(std::make_shared<s_t>(pimpl::Sentence::Not(data)), {{name, data}});
+}
+
+}   // namespace
+
+TEST_CASE("KnowledgeBase")
+{
+    using namespace pimpl;
+
+    KnowledgeBase kb;
+    CHECK(kb.consistent());
+    CHECK(kb.tell(Sentence()) == std::nullopt);
+    CHECK(kb.ask(Sentence()) == std::nullopt);
+
+    auto rain = kb.tell(imp("rain", "wet"));
+    auto wet = kb.tell(imp("wet", "slippery"));
+    REQUIRE(rain);
+    REQUIRE(wet);
+    CHECK(kb.size() == 2);
+    CHECK(kb.store().symbol_count() == 3);
+
+    SUBCASE("entailment") {
+        CHECK(kb.ask(imp("rain", "slippery")) == true);
+        CHECK(kb.ask(symbol("slippery")) == false);
+        CHECK(kb.ask(negation("slippery")) == false);
+
+        auto fact = kb.tell(symbol("rain"));
+        REQUIRE(fact);
+        CHECK(kb.ask(symbol("slippery")) == true);
+        CHECK(kb.ask(negation("rain")) == false);
+        auto told = kb.fact(*fact);
+        REQUIRE(told);
+        CHECK(*told->data() == *symbol("rain").data());
+        CHECK(kb.fact(*fact + 1) == std::nullopt);
+        CHECK(kb.fact(UINT32_MAX) == std::nullopt);
+    }
+
+    SUBCASE("retract") {
+        auto fact = kb.tell(symbol("rain"));
+        REQUIRE(fact);
+        CHECK(kb.ask(symbol("slippery")) == true);
+
+        CHECK(kb.retract(*wet));
+        CHECK(!kb.retract(*wet));
+        CHECK(!kb.retract(1000));
+        CHECK(kb.size() == 2);
+        CHECK(kb.ask(symbol("wet")) == true);
+        CHECK(kb.ask(symbol("slippery")) == false);
+
+        CHECK(kb.retract(*fact));
+        CHECK(kb.ask(symbol("wet")) == false);
+    }
+
+    SUBCASE("inconsistent") {
+        auto yes = kb.tell(symbol("rain"));
+        auto no = kb.tell(negation("rain"));
+        REQUIRE(yes);
+        REQUIRE(no);
+        CHECK(!kb.consistent());
+        // anything follows from a contradiction
+        CHECK(kb.ask(negation("wet")) == true);
+
+        kb.retract(*no);
+        CHECK(kb.consistent());
+        CHECK(kb.ask(negation("wet")) == false);
+    }
+
+    SUBCASE("many queries") {
+        // a chain of 200 implications, asked about every pair
+        KnowledgeBase chain;
+        for (int i = 0; i < 199; ++i) {
+            chain.tell(imp("x" + std::to_string(i), "x" + std::to_string(i + 1)));
+        }
+        CHECK(chain.store().symbol_count() == 200);
+
+        int entailed = 0;
+        for (int i = 0; i < 200; i += 7) {
+            for (int j = 0; j < 200; j += 5) {
+                auto res = chain.ask(imp("x" + std::to_string(i), "x" + std::to_string(j)));
+                REQUIRE(res);
+                CHECK(*res == (i <= j));
+                entailed += *res;
+            }
+        }
+        CHECK(entailed > 0);
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
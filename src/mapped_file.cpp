@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/mapped_file.hpp"
+
+namespace pimpl
+{
+
+std::optional<MappedFile> MappedFile::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    // mmap() rejects empty mappings, an empty file is just an empty view
+    const size_t size = st.st_size;
+    if (size == 0) {
+        ::close(fd);
+        return MappedFile(nullptr, 0);
+    }
+
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return std::nullopt;
+    }
+    ::madvise(data, size, MADV_SEQUENTIAL);
+    return MappedFile(static_cast<const char*>(data), size);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+void MappedFile::release(size_t offset) const
+{
+    const size_t page = ::sysconf(_SC_PAGESIZE);
+    const size_t end = std::min(offset, size_) / page * page;
+    if (data_ != nullptr && end > 0) {
+        ::madvise(const_cast<char*>(data_), end, MADV_DONTNEED);
+    }
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+TEST_CASE("MappedFile")
+{
+    using namespace pimpl;
+
+    const auto path = std::filesystem::temp_directory_path() / "pimpl_mapped_file_test.txt";
+    std::string contents;
+    for (int i = 0; i < 10000; ++i) {
+        contents += "line " + std::to_string(i) + "\n";
+    }
+    std::ofstream(path, std::ios::binary) << contents;
+
+    auto file = MappedFile::open(path.string());
+    REQUIRE(file);
+    CHECK(file->size() == contents.size());
+    CHECK(file->text() == contents);
+
+    // released pages are read back in on the next access
+    file->release(file->size());
+    CHECK(file->text() == contents);
+
+    MappedFile moved = std::move(*file);
+    CHECK(moved.text() == contents);
+    CHECK(file->text().empty());
+
+    std::ofstream(path, std::ios::trunc);
+    auto empty = MappedFile::open(path.string());
+    REQUIRE(empty);
+    CHECK(empty->text().empty());
+
+    std::filesystem::remove(path);
+    CHECK(MappedFile::open(path.string()) == std::nullopt);
+    CHECK(MappedFile::open(std::filesystem::temp_directory_path().string()) == std::nullopt);
+}
+
+#endif  // PIMPL_ENABLE_TESTS
@@ -0,0 +1,751 @@
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <unordered_map>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/model_count.hpp"
+
+namespace pimpl
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// BigUint
+
+BigUint::BigUint(uint64_t value)
+{
+    while (value != 0) {
+        limbs_.push_back(uint32_t(value));
+        value >>= 32;
+    }
+}
+
+BigUint& BigUint::operator+=(const BigUint& other)
+{
+    if (limbs_.size() < other.limbs_.size()) {
+        limbs_.resize(other.limbs_.size(), 0);
+    }
+    uint64_t carry = 0;
+    for (size_t i = 0; i < limbs_.size(); ++i) {
+        carry += uint64_t(limbs_[i]) + (i < other.limbs_.size() ? other.limbs_[i] : 0);
+        limbs_[i] = uint32_t(carry);
+        carry >>= 32;
+        if (carry == 0 && i >= other.limbs_.size()) {
+            break;
+        }
+    }
+    if (carry != 0) {
+        limbs_.push_back(uint32_t(carry));
+    }
+    return *this;
+}
+
+BigUint& BigUint::operator*=(const BigUint& other)
+{
+    if (is_zero() || other.is_zero()) {
+        limbs_.clear();
+        return *this;
+    }
+    std::vector<uint32_t> product(limbs_.size() + other.limbs_.size(), 0);
+    for (size_t i = 0; i < limbs_.size(); ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < other.limbs_.size(); ++j) {
+            carry += uint64_t(limbs_[i]) * other.limbs_[j] + product[i + j];
+            product[i + j] = uint32_t(carry);
+            carry >>= 32;
+        }
+        product[i + other.limbs_.size()] = uint32_t(carry);
+    }
+    while (!product.empty() && product.back() == 0) {
+        product.pop_back();
+    }
+    limbs_ = std::move(product);
+    return *this;
+}
+
+std::strong_ordering BigUint::operator<=>(const BigUint& other) const
+{
+    if (limbs_.size() != other.limbs_.size()) {
+        return limbs_.size() <=> other.limbs_.size();
+    }
+    for (size_t i = limbs_.size(); i-- > 0; ) {
+        if (limbs_[i] != other.limbs_[i]) {
+            return limbs_[i] <=> other.limbs_[i];
+        }
+    }
+    return std::strong_ordering::equal;
+}
+
+std::optional<uint64_t> BigUint::to_u64() const
+{
+    if (limbs_.size() > 2) {
+        return std::nullopt;
+    }
+    uint64_t value = 0;
+    for (size_t i = limbs_.size(); i-- > 0; ) {
+        value = (value << 32) | limbs_[i];
+    }
+    return value;
+}
+
+double BigUint::to_double() const
+{
+    double value = 0;
+    for (size_t i = limbs_.size(); i-- > 0; ) {
+        value = value * 4294967296.0 + limbs_[i];
+    }
+    return value;
+}
+
+std::string BigUint::to_string() const
+{
+    if (is_zero()) {
+        return "0";
+    }
+
+    // peel off nine decimal digits at a time
+    std::vector<uint32_t> rest = limbs_;
+    std::vector<uint32_t> chunks;
+    while (!rest.empty()) {
+        uint64_t remainder = 0;
+        for (size_t i = rest.size(); i-- > 0; ) {
+            const uint64_t current = (remainder << 32) | rest[i];
+            rest[i] = uint32_t(current / 1000000000);
+            remainder = current % 1000000000;
+        }
+        chunks.push_back(uint32_t(remainder));
+        while (!rest.empty() && rest.back() == 0) {
+            rest.pop_back();
+        }
+    }
+
+    std::string out = std::to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i-- > 0; ) {
+        const std::string digits = std::to_string(chunks[i]);
+        out.append(9 - digits.size(), '0');
+        out += digits;
+    }
+    return out;
+}
+
+std::ostream& operator<<(std::ostream& out, const BigUint& value)
+{
+    return out << value.to_string();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Counting
+
+namespace
+{
+
+struct Unweighted
+{
+    BigUint weight(lit_t) const { return 1; }
+    BigUint both(uint32_t) const { return 2; }
+};
+
+struct Weighted
+{
+    std::span<const LiteralWeight> weights;
+
+    double weight(lit_t lit) const
+    {
+        const uint32_t var = lit_var(lit);
+        if (var >= weights.size()) {
+            return 1;
+        }
+        return lit_negated(lit) ? weights[var].if_false : weights[var].if_true;
+    }
+
+    double both(uint32_t var) const
+    {
+        return weight(make_lit(var)) + weight(make_lit(var, true));
+    }
+};
+
+bool is_zero(const BigUint& n) { return n.is_zero(); }
+bool is_zero(double n) { return n == 0; }
+
+// Branching priority of every variable from a greedy min-degree elimination of the primal graph
+// (variables are adjacent if they share a clause). Variables eliminated last sit at the top of
+// the elimination tree, branching on them first cuts the formula into independent components
+// early. Elimination stops once it has added fill_budget edges, the variables left over rank
+// above all others by degree.
+std::vector<uint32_t> branch_priority(const Cnf& cnf, size_t fill_budget = size_t(1) << 22)
+{
+    const uint32_t n = cnf.num_vars;
+    std::vector<std::vector<uint32_t>> adjacent(n);
+    for (size_t c = 0; c < cnf.size(); ++c) {
+        const auto clause = cnf.clause(c);
+        for (size_t i = 0; i < clause.size(); ++i) {
+            for (size_t j = i + 1; j < clause.size(); ++j) {
+                if (lit_var(clause[i]) != lit_var(clause[j])) {
+                    adjacent[lit_var(clause[i])].push_back(lit_var(clause[j]));
+                    adjacent[lit_var(clause[j])].push_back(lit_var(clause[i]));
+                }
+            }
+        }
+    }
+    for (auto& list : adjacent) {
+        std::ranges::sort(list);
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+
+    // lazy min-heap of (degree, variable), stale entries are skipped when they come up
+    std::vector<uint32_t> priority(n, 0);
+    std::vector<bool> eliminated(n, false);
+    std::vector<std::pair<uint32_t, uint32_t>> heap;
+    for (uint32_t v = 0; v < n; ++v) {
+        heap.emplace_back(adjacent[v].size(), v);
+    }
+    std::ranges::make_heap(heap, std::greater<>());
+
+    uint32_t position = 0;
+    size_t fill = 0;
+    std::vector<uint32_t> merged;
+    while (!heap.empty() && fill <= fill_budget) {
+        std::ranges::pop_heap(heap, std::greater<>());
+        const auto [degree, v] = heap.back();
+        heap.pop_back();
+        if (eliminated[v] || degree != adjacent[v].size()) {
+            continue;
+        }
+        eliminated[v] = true;
+        priority[v] = position++;
+
+        // the neighbours of v become a clique
+        for (auto u : adjacent[v]) {
+            std::erase(adjacent[u], v);
+            std::ranges::set_union(adjacent[u], adjacent[v], std::back_inserter(merged));
+            std::erase(merged, u);
+            fill += merged.size() - adjacent[u].size();
+            adjacent[u].swap(merged);
+            merged.clear();
+            heap.emplace_back(adjacent[u].size(), u);
+            std::ranges::push_heap(heap, std::greater<>());
+        }
+        adjacent[v].clear();
+    }
+    for (uint32_t v = 0; v < n; ++v) {
+        if (!eliminated[v]) {
+            priority[v] = n + adjacent[v].size();
+        }
+    }
+    return priority;
+}
+
+// DPLL over the clauses of a Cnf, Number is BigUint or double
+template <typename Number, typename Weights>
+class Counter
+{
+public:
+    Counter(const Cnf& cnf, Weights weights, ModelCountStats* stats)
+        : cnf_(cnf), weights_(weights), stats_(stats), assigns_(cnf.num_vars, 0),
+          occurs_(2 * size_t(cnf.num_vars)), var_stamp_(cnf.num_vars, 0), clause_stamp_(cnf.size(), 0),
+          var_label_(cnf.num_vars, 0), clause_label_(cnf.size(), 0),
+          priority_(branch_priority(cnf)), score_(cnf.num_vars, 0)
+    {
+        for (uint32_t c = 0; c < cnf.size(); ++c) {
+            for (auto lit : cnf.clause(c)) {
+                occurs_[lit].push_back(c);
+            }
+        }
+    }
+
+    Number count()
+    {
+        // unit clauses are the only ones propagation would never look at by itself
+        for (uint32_t c = 0; c < cnf_.size(); ++c) {
+            const auto clause = cnf_.clause(c);
+            if (clause.empty()) {
+                return Number(0);
+            }
+            if (clause.size() == 1 && (value(clause[0]) < 0 || (value(clause[0]) == 0 && !assign(clause[0])))) {
+                return Number(0);
+            }
+        }
+
+        // clauses the top level assignment satisfies never matter again
+        for (auto& clauses : occurs_) {
+            std::erase_if(clauses, [this](uint32_t c) { return satisfied(c); });
+        }
+
+        Component all;
+        for (uint32_t v = 0; v < cnf_.num_vars; ++v) {
+            all.vars.push_back(v);
+        }
+        for (uint32_t c = 0; c < cnf_.size(); ++c) {
+            all.clauses.push_back(c);
+        }
+        return residual(all, 0);
+    }
+
+private:
+    struct Component
+    {
+        std::vector<uint32_t> vars;     // sorted
+        std::vector<uint32_t> clauses;  // sorted, unsatisfied ones only
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const std::vector<uint32_t>& key) const
+        {
+            uint64_t h = 0xcbf29ce484222325;
+            for (auto x : key) {
+                h = (h ^ x) * 0x100000001b3;
+            }
+            return h;
+        }
+    };
+
+    static constexpr uint32_t NO_LABEL = UINT32_MAX;
+
+    // Stop caching new components past this many key words, about 256 MiB of keys
+    static constexpr size_t CACHE_WORDS = size_t(1) << 26;
+
+    // -1 false, 0 unassigned, 1 true
+    int8_t value(lit_t lit) const { return lit_negated(lit) ? -assigns_[lit_var(lit)] : assigns_[lit_var(lit)]; }
+
+    bool satisfied(uint32_t c) const
+    {
+        return std::ranges::any_of(cnf_.clause(c), [this](lit_t lit) { return value(lit) > 0; });
+    }
+
+    // Assign lit and everything it implies, false on a conflict (the trail still has to be undone)
+    bool assign(lit_t lit)
+    {
+        size_t head = trail_.size();
+        assigns_[lit_var(lit)] = lit_negated(lit) ? -1 : 1;
+        trail_.push_back(lit);
+
+        while (head < trail_.size()) {
+            const lit_t falsified = lit_not(trail_[head++]);
+            for (auto c : occurs_[falsified]) {
+                lit_t unit = 0;
+                size_t open = 0;
+                bool sat = false;
+                for (auto l : cnf_.clause(c)) {
+                    const int8_t v = value(l);
+                    if (v > 0) {
+                        sat = true;
+                        break;
+                    }
+                    if (v == 0) {
+                        unit = l;
+                        ++open;
+                    }
+                }
+                if (sat || open > 1) {
+                    continue;
+                }
+                if (open == 0) {
+                    return false;
+                }
+                assigns_[lit_var(unit)] = lit_negated(unit) ? -1 : 1;
+                trail_.push_back(unit);
+            }
+        }
+        return true;
+    }
+
+    void undo(size_t mark)
+    {
+        while (trail_.size() > mark) {
+            assigns_[lit_var(trail_.back())] = 0;
+            trail_.pop_back();
+        }
+    }
+
+    // Count what is left of a component after the assignments from trail_[mark] on:
+    // their weight, times every variable that no longer occurs, times each new component
+    Number residual(const Component& parent, size_t mark)
+    {
+        Number total(1);
+        for (size_t i = mark; i < trail_.size(); ++i) {
+            total *= weights_.weight(trail_[i]);
+        }
+
+        // flood fill the unassigned variables through the unsatisfied clauses, labelling
+        // every variable and clause with its component
+        std::vector<Component> components;
+        ++stamp_;
+        for (auto start : parent.vars) {
+            if (assigns_[start] != 0 || var_stamp_[start] == stamp_) {
+                continue;
+            }
+            const uint32_t label = components.size();
+            size_t clauses = 0;
+            var_stamp_[start] = stamp_;
+            var_label_[start] = label;
+            queue_.assign(1, start);
+            for (size_t i = 0; i < queue_.size(); ++i) {
+                const uint32_t var = queue_[i];
+                for (auto lit : {make_lit(var), make_lit(var, true)}) {
+                    for (auto c : occurs_[lit]) {
+                        if (clause_stamp_[c] == stamp_) {
+                            continue;
+                        }
+                        // satisfied clauses include ones from further up, outside the parent
+                        clause_stamp_[c] = stamp_;
+                        clause_label_[c] = NO_LABEL;
+                        if (satisfied(c)) {
+                            continue;
+                        }
+                        clause_label_[c] = label;
+                        ++clauses;
+                        for (auto l : cnf_.clause(c)) {
+                            if (assigns_[lit_var(l)] == 0 && var_stamp_[lit_var(l)] != stamp_) {
+                                var_stamp_[lit_var(l)] = stamp_;
+                                var_label_[lit_var(l)] = label;
+                                queue_.push_back(lit_var(l));
+                            }
+                        }
+                    }
+                }
+            }
+            if (clauses == 0) {
+                total *= weights_.both(start);
+                var_label_[start] = NO_LABEL;
+            } else {
+                components.emplace_back();
+            }
+        }
+
+        // the parent's lists are sorted, so splitting them in order keeps every key canonical
+        for (auto var : parent.vars) {
+            if (assigns_[var] == 0 && var_label_[var] != NO_LABEL) {
+                components[var_label_[var]].vars.push_back(var);
+            }
+        }
+        for (auto c : parent.clauses) {
+            if (clause_stamp_[c] == stamp_ && clause_label_[c] != NO_LABEL) {
+                components[clause_label_[c]].clauses.push_back(c);
+            }
+        }
+
+        for (const auto& component : components) {
+            if (is_zero(total)) {
+                break;
+            }
+            total *= count(component);
+        }
+        return total;
+    }
+
+    Number count(const Component& component)
+    {
+        if (stats_ != nullptr) {
+            ++stats_->components;
+        }
+
+        // every assigned literal of an unsatisfied clause is false, so the variables and the
+        // clause ids are enough to tell two residual clause sets apart
+        std::vector<uint32_t> key = component.vars;
+        key.push_back(UINT32_MAX);
+        key.insert(key.end(), component.clauses.begin(), component.clauses.end());
+        if (auto it = cache_.find(key); it != cache_.end()) {
+            if (stats_ != nullptr) {
+                ++stats_->cache_hits;
+            }
+            return it->second;
+        }
+
+        // branch on symbols before auxiliary variables, since fixing every symbol of a Tseitin
+        // encoding propagates the rest, then by elimination order and by occurrences
+        for (auto c : component.clauses) {
+            for (auto l : cnf_.clause(c)) {
+                score_[lit_var(l)] += assigns_[lit_var(l)] == 0;
+            }
+        }
+        uint32_t best = component.vars.front();
+        auto rank = [this](uint32_t var) { return std::tuple(var < cnf_.num_symbols, priority_[var], score_[var]); };
+        for (auto var : component.vars) {
+            if (rank(var) > rank(best)) {
+                best = var;
+            }
+        }
+        for (auto var : component.vars) {
+            score_[var] = 0;
+        }
+
+        Number total(0);
+        for (bool negated : {false, true}) {
+            if (stats_ != nullptr) {
+                ++stats_->decisions;
+            }
+            const size_t mark = trail_.size();
+            if (assign(make_lit(best, negated))) {
+                total += residual(component, mark);
+            }
+            undo(mark);
+        }
+
+        if (cache_words_ + key.size() <= CACHE_WORDS) {
+            cache_words_ += key.size();
+            cache_.emplace(std::move(key), total);
+        }
+        return total;
+    }
+
+    const Cnf& cnf_;
+    Weights weights_;
+    ModelCountStats* stats_;
+
+    std::vector<int8_t> assigns_;
+    std::vector<lit_t> trail_;
+    std::vector<std::vector<uint32_t>> occurs_;     // clauses of every literal
+    std::vector<uint32_t> var_stamp_;
+    std::vector<uint32_t> clause_stamp_;
+    uint32_t stamp_ = 0;
+    std::vector<uint32_t> var_label_;               // component of a variable, valid for the current stamp
+    std::vector<uint32_t> clause_label_;
+    std::vector<uint32_t> queue_;
+    std::vector<uint32_t> priority_;
+    std::vector<uint32_t> score_;
+
+    std::unordered_map<std::vector<uint32_t>, Number, KeyHash> cache_;
+    size_t cache_words_ = 0;
+};
+
+std::optional<Cnf> tseitin(const Sentence& sentence)
+{
+    return to_cnf(sentence, CnfEncoding::TSEITIN);
+}
+
+}   // namespace
+
+BigUint count_models(const Cnf& cnf, ModelCountStats* stats)
+{
+    return Counter<BigUint, Unweighted>(cnf, {}, stats).count();
+}
+
+double count_models(const Cnf& cnf, std::span<const LiteralWeight> weights, ModelCountStats* stats)
+{
+    return Counter<double, Weighted>(cnf, {weights}, stats).count();
+}
+
+std::optional<BigUint> count_models(const Sentence& sentence, ModelCountStats* stats)
+{
+    auto cnf = tseitin(sentence);
+    if (!cnf) {
+        return std::nullopt;
+    }
+    return count_models(*cnf, stats);
+}
+
+std::optional<double> count_models(const Sentence& sentence, std::span<const LiteralWeight> weights,
+                                   ModelCountStats* stats)
+{
+    if (weights.size() != sentence.symbol_names().size()) {
+        return std::nullopt;
+    }
+    auto cnf = tseitin(sentence);
+    if (!cnf) {
+        return std::nullopt;
+    }
+    return count_models(*cnf, weights, stats);
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <memory>
+#include <random>
+
+#include "random_sentence.hpp"
+
+TEST_CASE("BigUint")
+{
+    using pimpl::BigUint;
+
+    CHECK(BigUint().to_string() == "0");
+    CHECK(BigUint(1234567890123456789).to_string() == "1234567890123456789");
+    CHECK((BigUint(UINT64_MAX) + 1).to_u64() == std::nullopt);
+    CHECK((BigUint(UINT64_MAX) + 1).to_string() == "18446744073709551616");
+    CHECK(BigUint(UINT32_MAX) * BigUint(UINT32_MAX) == BigUint(18446744065119617025u));
+    CHECK(BigUint(5) * 0 == BigUint());
+    CHECK(BigUint(3) < BigUint(UINT64_MAX) + 1);
+
+    BigUint power = 1;
+    for (int i = 0; i < 100; ++i) {
+        power *= 3;
+    }
+    CHECK(power.to_string() == "515377520732011331036461129765621272702107522001");
+    CHECK(power.to_double() == doctest::Approx(5.153775207320113e47));
+}
+
+TEST_CASE("count_models")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+    using ptr_t = Sentence::sentence_ptr_t;
+
+    auto symbol = [](std::unordered_map<std::string, ptr_t>& symbols, const std::string& name) {
+        auto leaf = std::make_shared<s_t>(name);
+        symbols.emplace(name, leaf);
+        return leaf;
+    };
+
+    SUBCASE("small sentences") {
+        std::unordered_map<std::string, ptr_t> symbols;
+        auto a = symbol(symbols, "a");
+        auto b = symbol(symbols, "b");
+        symbol(symbols, "unused");
+        const Sentence sentence(std::make_shared<s_t>(Sentence::Or(a, b)), symbols);
+        CHECK(count_models(sentence) == BigUint(6));
+
+        const LiteralWeight half[] = {{0.5, 0.5}, {0.5, 0.5}, {0.5, 0.5}};
+        CHECK(count_models(sentence, half).value_or(-1) == doctest::Approx(0.75));
+        const LiteralWeight skewed[] = {{0.9, 0.1}, {0.2, 0.8}, {1, 1}};
+        CHECK(count_models(sentence, skewed).value_or(-1) == doctest::Approx(2 * (1 - 0.1 * 0.8)));
+        CHECK(count_models(sentence, std::span(half, 2)) == std::nullopt);
+
+        CHECK(count_models(Sentence(std::make_shared<s_t>(false), {})) == BigUint(0));
+        CHECK(count_models(Sentence(std::make_shared<s_t>(true), {})) == BigUint(1));
+        CHECK(count_models(Sentence()) == std::nullopt);
+    }
+
+    SUBCASE("agrees with enumeration") {
+        std::mt19937 rng(23);
+        for (int trial = 0; trial < 30; ++trial) {
+            constexpr size_t SYMBOLS = 8;
+            auto symbols = test::random_symbols(SYMBOLS);
+            std::vector<ptr_t> pool = symbols.leaves;
+            const Sentence sentence(test::grow_random(rng, pool, 25), symbols.table);
+
+            std::vector<LiteralWeight> weights(SYMBOLS);
+            for (auto& w : weights) {
+                w = {double(rng() % 10) / 10, double(rng() % 10) / 10};
+            }
+            uint64_t expected = 0;
+            double expected_weight = 0;
+            bool values[SYMBOLS];
+            for (unsigned bits = 0; bits < (1u << SYMBOLS); ++bits) {
+                double w = 1;
+                for (size_t i = 0; i < SYMBOLS; ++i) {
+                    values[i] = bits & (1u << i);
+                    w *= values[i] ? weights[i].if_true : weights[i].if_false;
+                }
+                if (sentence.evaluate_ids(values) == true) {
+                    ++expected;
+                    expected_weight += w;
+                }
+            }
+            CHECK(count_models(sentence) == BigUint(expected));
+            CHECK(count_models(sentence, weights).value_or(-1) == doctest::Approx(expected_weight));
+        }
+    }
+
+    SUBCASE("independent clauses split into components") {
+        // (a0 | b0) & (a1 | b1) & ... has 3^n models, far too many to enumerate
+        constexpr int CLAUSES = 100;
+        std::unordered_map<std::string, ptr_t> symbols;
+        ptr_t conjunction;
+        for (int i = 0; i < CLAUSES; ++i) {
+            auto clause = std::make_shared<s_t>(Sentence::Or(symbol(symbols, "a" + std::to_string(i)),
+                                                             symbol(symbols, "b" + std::to_string(i))));
+            conjunction = conjunction ? std::make_shared<s_t>(Sentence::And(conjunction, clause)) : clause;
+        }
+        ModelCountStats stats;
+        CHECK(count_models(Sentence(conjunction, symbols), &stats)->to_string()
+              == "515377520732011331036461129765621272702107522001");
+        CHECK(stats.decisions < 10 * CLAUSES);
+    }
+
+    SUBCASE("implication chain") {
+        // s0 => s1, s1 => s2, ... holds for the n + 1 assignments false...false true...true
+        constexpr int LENGTH = 300;
+        std::unordered_map<std::string, ptr_t> symbols;
+        std::vector<ptr_t> leaves;
+        for (int i = 0; i <= LENGTH; ++i) {
+            leaves.push_back(symbol(symbols, "s" + std::to_string(i)));
+        }
+        ptr_t conjunction;
+        for (int i = 0; i < LENGTH; ++i) {
+            auto imp = std::make_shared<s_t>(Sentence::Imp(leaves[i], leaves[i + 1]));
+            conjunction = conjunction ? std::make_shared<s_t>(Sentence::And(conjunction, imp)) : imp;
+        }
+        CHECK(count_models(Sentence(conjunction, symbols)) == BigUint(LENGTH + 2));
+    }
+
+    SUBCASE("cnf directly") {
+        Cnf cnf;
+        cnf.num_vars = 3;
+        cnf.num_symbols = 3;
+        cnf.add_clause({make_lit(0), make_lit(1)});
+        cnf.add_clause({make_lit(0, true)});
+        // x0 is false, so x1 is true and x2 is free
+        CHECK(count_models(cnf) == BigUint(2));
+
+        cnf.add_clause({});
+        CHECK(count_models(cnf) == BigUint(0));
+    }
+
+    SUBCASE("random cnf agrees with enumeration") {
+        // clauses satisfied higher up must not glue separate components back together
+        std::mt19937 rng(29);
+        for (int trial = 0; trial < 30; ++trial) {
+            constexpr uint32_t VARS = 12;
+            Cnf cnf;
+            cnf.num_vars = VARS;
+            cnf.num_symbols = VARS;
+            for (int i = 0; i < 18; ++i) {
+                const lit_t a = make_lit(rng() % VARS, rng() % 2);
+                const lit_t b = make_lit(rng() % VARS, rng() % 2);
+                if (rng() % 3 == 0) {
+                    cnf.add_clause({a, b});
+                } else {
+                    cnf.add_clause({a, b, make_lit(rng() % VARS, rng() % 2)});
+                }
+            }
+            uint64_t expected = 0;
+            for (uint32_t bits = 0; bits < (1u << VARS); ++bits) {
+                bool all = true;
+                for (size_t c = 0; c < cnf.size() && all; ++c) {
+                    all = std::ranges::any_of(cnf.clause(c), [bits](lit_t lit) {
+                        return bool(bits & (1u << lit_var(lit))) != lit_negated(lit);
+                    });
+                }
+                expected += all;
+            }
+            CHECK(count_models(cnf) == BigUint(expected));
+        }
+    }
+
+    SUBCASE("repeated subproblems come from the cache") {
+        // two halves over disjoint symbols joined by <=>, every assignment of one half that gives
+        // it the same value leaves the same clauses of the other half behind
+        std::unordered_map<std::string, ptr_t> symbols;
+        auto half = [&](const std::string& prefix) {
+            std::unordered_map<std::string, ptr_t> own;
+            ptr_t acc = symbol(own, prefix + "0");
+            for (int i = 1; i < 10; ++i) {
+                auto conj = std::make_shared<s_t>(Sentence::And(symbol(own, prefix + std::to_string(i)),
+                                                                symbol(own, prefix + "x" + std::to_string(i))));
+                acc = std::make_shared<s_t>(Sentence::Or(acc, conj));
+            }
+            symbols.insert(own.begin(), own.end());
+            return std::pair(acc, own);
+        };
+        const auto [left, own_left] = half("l");
+        const auto [right, own_right] = half("r");
+
+        // both halves have the same shape, so one count of each value serves for both
+        const BigUint models = *count_models(Sentence(left, own_left));
+        const BigUint counter_models = *count_models(Sentence(std::make_shared<s_t>(Sentence::Not(left)), own_left));
+        CHECK(models + counter_models == BigUint(uint64_t(1) << own_left.size()));
+
+        ModelCountStats stats;
+        const Sentence sentence(std::make_shared<s_t>(Sentence::Iff(left, right)), symbols);
+        CHECK(count_models(sentence, &stats) == models * models + counter_models * counter_models);
+        CHECK(stats.cache_hits > 0);
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
@@ -0,0 +1,210 @@
+#include "doctest/doctest.h"
+
+#include "pimpl/cnf.hpp"
+#include "pimpl/models.hpp"
+#include "pimpl/solver.hpp"
+
+namespace pimpl
+{
+
+namespace
+{
+
+// Owns the clauses, so the range doesn't depend on the sentence staying alive
+Generator<std::vector<bool>> enumerate(Cnf cnf)
+{
+    Solver solver(cnf);
+    if (!solver.solve()) {
+        co_return;
+    }
+
+    const uint32_t n = cnf.num_symbols;
+    std::vector<bool> model(solver.model().begin(), solver.model().begin() + n);
+    co_yield model;
+
+    // Depths whose flipped cube is still unexplored, increasing from the bottom.
+    // Exploring depth k only rewrites model[k + 1..n), so the prefix every entry below it
+    // refers to is still intact when its turn comes.
+    std::vector<uint32_t> flips;
+    std::vector<lit_t> assumptions;
+    for (uint32_t k = 0; k < n; ++k) {
+        flips.push_back(k);
+    }
+
+    while (!flips.empty()) {
+        const uint32_t k = flips.back();
+        flips.pop_back();
+        model[k] = !model[k];
+
+        assumptions.clear();
+        for (uint32_t i = 0; i <= k; ++i) {
+            assumptions.push_back(make_lit(i, !model[i]));
+        }
+        if (!solver.solve(assumptions)) {
+            continue;
+        }
+
+        for (uint32_t i = k + 1; i < n; ++i) {
+            model[i] = solver.model()[i];
+            flips.push_back(i);
+        }
+        co_yield model;
+    }
+}
+
+}   // namespace
+
+Generator<std::vector<bool>> models(const Sentence& sentence)
+{
+    auto cnf = to_cnf(sentence);
+    if (!cnf) {
+        return {};
+    }
+    return enumerate(std::move(*cnf));
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+#include "pimpl/model_count.hpp"
+#include "random_sentence.hpp"
+
+namespace
+{
+
+pimpl::Generator<int> count_to(int n)
+{
+    for (int i = 0; i < n; ++i) {
+        co_yield i;
+    }
+}
+
+pimpl::Generator<int> failing()
+{
+    co_yield 1;
+    throw std::runtime_error("failing");
+}
+
+}   // namespace
+
+TEST_CASE("Generator")
+{
+    using pimpl::Generator;
+
+    std::vector<int> seen;
+    for (int i : count_to(5)) {
+        seen.push_back(i);
+    }
+    CHECK(seen == std::vector<int>{0, 1, 2, 3, 4});
+
+    // nothing runs until it is asked for, and abandoning the range early is fine
+    seen.clear();
+    for (int i : count_to(1000000000) | std::views::take(3)) {
+        seen.push_back(i);
+    }
+    CHECK(seen == std::vector<int>{0, 1, 2});
+
+    Generator<int> empty;
+    CHECK(empty.begin() == empty.end());
+
+    auto moved = count_to(2);
+    auto target = std::move(moved);
+    CHECK(std::ranges::distance(target) == 2);
+
+    auto throws = failing();
+    auto it = throws.begin();
+    CHECK(*it == 1);
+    CHECK_THROWS(++it);
+}
+
+TEST_CASE("models")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+    using ptr_t = Sentence::sentence_ptr_t;
+
+    auto as_array = [](const std::vector<bool>& model) {
+        std::unique_ptr<bool[]> values(new bool[model.size()]);
+        std::ranges::copy(model, values.get());
+        return values;
+    };
+
+    SUBCASE("a | b") {
+        auto a = std::make_shared<s_t>("a");
+        auto b = std::make_shared<s_t>("b");
+        const Sentence sentence(std::make_shared<s_t>(Sentence::Or(a, b)), {{"a", a}, {"b", b}});
+        std::set<std::vector<bool>> seen;
+        for (const auto& model : models(sentence)) {
+            seen.insert(model);
+        }
+        CHECK(seen == std::set<std::vector<bool>>{{false, true}, {true, false}, {true, true}});
+    }
+
+    SUBCASE("nothing to enumerate") {
+        auto a = std::make_shared<s_t>("a");
+        const Sentence contradiction(std::make_shared<s_t>(Sentence::And(a, std::make_shared<s_t>(Sentence::Not(a)))),
+                                     {{"a", a}});
+        CHECK(std::ranges::distance(models(contradiction)) == 0);
+        CHECK(std::ranges::distance(models(Sentence())) == 0);
+        CHECK(std::ranges::distance(models(Sentence(std::make_shared<s_t>(true), {}))) == 1);
+    }
+
+    SUBCASE("agrees with enumeration and count_models") {
+        std::mt19937 rng(31);
+        for (int trial = 0; trial < 20; ++trial) {
+            constexpr size_t SYMBOLS = 7;
+            auto symbols = test::random_symbols(SYMBOLS);
+            std::vector<ptr_t> pool = symbols.leaves;
+            const Sentence sentence(test::grow_random(rng, pool, 20), symbols.table);
+
+            std::set<std::vector<bool>> expected;
+            for (unsigned bits = 0; bits < (1u << SYMBOLS); ++bits) {
+                std::vector<bool> model(SYMBOLS);
+                for (size_t i = 0; i < SYMBOLS; ++i) {
+                    model[i] = bits & (1u << i);
+                }
+                if (sentence.evaluate_ids(std::span<const bool>(as_array(model).get(), SYMBOLS)) == true) {
+                    expected.insert(model);
+                }
+            }
+
+            std::set<std::vector<bool>> seen;
+            size_t yielded = 0;
+            for (const auto& model : models(sentence)) {
+                seen.insert(model);
+                ++yielded;
+            }
+            CHECK(yielded == seen.size());
+            CHECK(seen == expected);
+            CHECK(count_models(sentence) == BigUint(yielded));
+        }
+    }
+
+    SUBCASE("the first few of very many") {
+        // a0 | a1 | ... | a99 has 2^100 - 1 models
+        std::unordered_map<std::string, ptr_t> symbols;
+        ptr_t disjunction;
+        for (int i = 0; i < 100; ++i) {
+            auto leaf = std::make_shared<s_t>("a" + std::to_string(i));
+            symbols.emplace("a" + std::to_string(i), leaf);
+            disjunction = disjunction ? std::make_shared<s_t>(Sentence::Or(disjunction, leaf)) : leaf;
+        }
+        const Sentence sentence(disjunction, symbols);
+
+        std::set<std::vector<bool>> seen;
+        for (const auto& model : models(sentence) | std::views::take(1000)) {
+            CHECK(sentence.evaluate_ids(std::span<const bool>(as_array(model).get(), model.size())) == true);
+            seen.insert(model);
+        }
+        CHECK(seen.size() == 1000);
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/node_store.hpp"
+#include "pimpl/stats.hpp"
+
+namespace pimpl
+{
+
+namespace
+{
+
+// Children of an operator node, left is nullptr for Not
+std::pair<const Sentence::sentence_ptr_t*, const Sentence::sentence_ptr_t*> children(
+    const Sentence::sentence_t& sentence)
+{
+    return std::visit(
+        [](const auto& s) -> std::pair<const Sentence::sentence_ptr_t*, const Sentence::sentence_ptr_t*> {
+            using T = std::decay_t<decltype(s)>;
+            if constexpr (std::is_same_v<T, Sentence::Not>) {
+                return {nullptr, &s.right};
+            } else if constexpr (requires { s.left; s.right; }) {
+                return {&s.left, &s.right};
+            } else {
+                return {nullptr, nullptr};
+            }
+        },
+        sentence);
+}
+
+}   // namespace
+
+NodeStore::node_id_t NodeStore::make_symbol(std::string_view name)
+{
+    return make({Kind::SYMBOL, intern(name), 0});
+}
+
+NodeStore::node_id_t NodeStore::make_bool(bool value)
+{
+    return make({Kind::BOOL, value, 0});
+}
+
+NodeStore::node_id_t NodeStore::make_not(node_id_t right)
+{
+    return make({Kind::NOT, right, 0});
+}
+
+NodeStore::node_id_t NodeStore::make_binary(Kind kind, node_id_t left, node_id_t right)
+{
+    return make({kind, left, right});
+}
+
+void NodeStore::reserve(size_t n)
+{
+    nodes_.reserve(n);
+    if (table_.size() < 2 * n) {
+        rehash(std::bit_ceil(2 * n));
+    }
+}
+
+NodeStore::symbol_id_t NodeStore::intern(std::string_view name)
+{
+    if (auto it = symbol_ids_.find(name); it != symbol_ids_.end()) {
+        return it->second;
+    }
+    symbol_id_t id = symbol_names_.size();
+    symbol_names_.emplace_back(name);
+    symbol_ids_.emplace(symbol_names_.back(), id);
+    global_ids_.push_back(SymbolTable::global().intern(name));
+    local_ids_.emplace(global_ids_.back(), id);
+    return id;
+}
+
+NodeStore::symbol_id_t NodeStore::local_symbol(Sentence::Symbol symbol)
+{
+    if (auto it = local_ids_.find(symbol.id); it != local_ids_.end()) {
+        return it->second;
+    }
+    return intern(symbol.name());
+}
+
+std::optional<NodeStore::symbol_id_t> NodeStore::find_symbol(std::string_view name) const
+{
+    if (auto it = symbol_ids_.find(name); it != symbol_ids_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+size_t NodeStore::hash(const Node& node)
+{
+    uint64_t h = (static_cast<uint64_t>(node.left) << 32) | node.right;
+    h ^= static_cast<uint64_t>(node.kind) * 0x9e3779b97f4a7c15ull;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+NodeStore::node_id_t NodeStore::make(Node node)
+{
+    // keep the load factor at or below one half
+    if (2 * (nodes_.size() + 1) > table_.size()) {
+        rehash(table_.empty() ? 64 : 2 * table_.size());
+    }
+
+    size_t mask = table_.size() - 1;
+    for (size_t i = hash(node) & mask; ; i = (i + 1) & mask) {
+        if (table_[i] == INVALID) {
+            node_id_t id = nodes_.size();
+            if (nodes_.size() == nodes_.capacity()) {
+                PIMPL_STATS_ADD(ALLOCATIONS, 1);
+                PIMPL_STATS_ADD(ALLOCATED_BYTES, std::max<size_t>(2 * nodes_.size(), 1) * sizeof(Node));
+            }
+            nodes_.push_back(node);
+            table_[i] = id;
+            PIMPL_STATS_ADD(NODES_BUILT, 1);
+            return id;
+        }
+        if (nodes_[table_[i]] == node) {
+            return table_[i];
+        }
+    }
+}
+
+void NodeStore::rehash(size_t capacity)
+{
+    PIMPL_STATS_ADD(ALLOCATIONS, 1);
+    PIMPL_STATS_ADD(ALLOCATED_BYTES, capacity * sizeof(node_id_t));
+    table_.assign(capacity, INVALID);
+    size_t mask = capacity - 1;
+    for (node_id_t id = 0; id < nodes_.size(); ++id) {
+        size_t i = hash(nodes_[id]) & mask;
+        while (table_[i] != INVALID) {
+            i = (i + 1) & mask;
+        }
+        table_[i] = id;
+    }
+}
+
+std::optional<NodeStore::node_id_t> NodeStore::add(const Sentence::sentence_t& sentence)
+{
+    return add_tree(sentence, nullptr);
+}
+
+std::optional<NodeStore::node_id_t> NodeStore::add(const Sentence& sentence)
+{
+    if (sentence.data() == nullptr) {
+        return std::nullopt;
+    }
+    return add_tree(*sentence.data(), &sentence);
+}
+
+std::optional<NodeStore::node_id_t> NodeStore::add_tree(const Sentence::sentence_t& sentence, const Sentence* owner)
+{
+    PIMPL_STATS_TIMER(BUILD);
+
+    // Post-order walk with an explicit stack, memoized on the address of each node
+    // so subterms shared through shared_ptr are only visited once.
+    // Nodes are only made once the whole tree has been checked, so a malformed sentence
+    // leaves the store (nodes and symbols) as it was.
+    std::unordered_map<const Sentence::sentence_t*, node_id_t> added;
+    std::vector<const Sentence::sentence_t*> order;
+    std::vector<std::pair<const Sentence::sentence_t*, bool>> stack{{&sentence, false}};
+
+    while (!stack.empty()) {
+        auto [s, expanded] = stack.back();
+        if (added.contains(s)) {
+            stack.pop_back();
+            continue;
+        }
+
+        auto [left, right] = children(*s);
+        if (!expanded) {
+            if (s->index() == Sentence::INDEX_MONOSTATE) {
+                return std::nullopt;
+            }
+            if (owner != nullptr && s->index() == Sentence::INDEX_SYMBOL
+                && !owner->symbol_slot(std::get<Sentence::INDEX_SYMBOL>(*s))) {
+                return std::nullopt;
+            }
+            stack.back().second = true;
+            for (auto child : {right, left}) {
+                if (child == nullptr) {
+                    continue;
+                }
+                if (*child == nullptr) {
+                    return std::nullopt;
+                }
+                stack.emplace_back(child->get(), false);
+            }
+            continue;
+        }
+        stack.pop_back();
+        order.push_back(s);
+        added.emplace(s, INVALID);
+    }
+
+    if (owner != nullptr) {
+        for (const auto& name : owner->symbol_names()) {
+            intern(name);
+        }
+    }
+    for (const auto* s : order) {
+        auto [left, right] = children(*s);
+        node_id_t id = INVALID;
+        switch (s->index()) {
+            case Sentence::INDEX_SYMBOL:
+                id = make({Kind::SYMBOL, local_symbol(std::get<Sentence::INDEX_SYMBOL>(*s)), 0});
+                break;
+            case Sentence::INDEX_BOOL:
+                id = make_bool(std::get<Sentence::INDEX_BOOL>(*s));
+                break;
+            case Sentence::INDEX_NOT:
+                id = make_not(added.at(right->get()));
+                break;
+            case Sentence::INDEX_AND:
+                id = make_binary(Kind::AND, added.at(left->get()), added.at(right->get()));
+                break;
+            case Sentence::INDEX_OR:
+                id = make_binary(Kind::OR, added.at(left->get()), added.at(right->get()));
+                break;
+            case Sentence::INDEX_IMP:
+                id = make_binary(Kind::IMP, added.at(left->get()), added.at(right->get()));
+                break;
+            case Sentence::INDEX_IFF:
+                id = make_binary(Kind::IFF, added.at(left->get()), added.at(right->get()));
+                break;
+        }
+        added[s] = id;
+    }
+
+    return added.at(&sentence);
+}
+
+Sentence NodeStore::sentence(node_id_t root) const
+{
+    std::unordered_map<std::string, Sentence::sentence_ptr_t> symbols;
+    if (root >= nodes_.size()) {
+        return Sentence();
+    }
+
+    // Children always precede their parents, so one downward sweep marks every reachable node
+    std::vector<bool> reachable(root + 1, false);
+    reachable[root] = true;
+    for (node_id_t id = root + 1; id-- > 0; ) {
+        if (!reachable[id]) {
+            continue;
+        }
+        const Node& n = nodes_[id];
+        if (n.kind == Kind::NOT) {
+            reachable[n.left] = true;
+        } else if (is_binary(n.kind)) {
+            reachable[n.left] = true;
+            reachable[n.right] = true;
+        }
+    }
+
+    PIMPL_STATS_TIMER(BUILD);
+    std::vector<Sentence::sentence_ptr_t> built(root + 1);
+    uint64_t count = 0;
+    for (node_id_t id = 0; id <= root; ++id) {
+        if (!reachable[id]) {
+            continue;
+        }
+        const Node& n = nodes_[id];
+        ++count;
+        switch (n.kind) {
+            case Kind::SYMBOL:
+                built[id] = std::make_shared<Sentence::sentence_t>(Sentence::Symbol(global_ids_[n.left]));
+                symbols.emplace(symbol_names_[n.left], built[id]);
+                break;
+            case Kind::BOOL:
+                built[id] = std::make_shared<Sentence::sentence_t>(n.left != 0);
+                break;
+            case Kind::NOT:
+                built[id] = std::make_shared<Sentence::sentence_t>(Sentence::Not(built[n.left]));
+                break;
+            case Kind::AND:
+                built[id] = std::make_shared<Sentence::sentence_t>(
+                    Sentence::And(built[n.left], built[n.right]));
+                break;
+            case Kind::OR:
+                built[id] = std::make_shared<Sentence::sentence_t>(
+                    Sentence::Or(built[n.left], built[n.right]));
+                break;
+            case Kind::IMP:
+                built[id] = std::make_shared<Sentence::sentence_t>(
+                    Sentence::Imp(built[n.left], built[n.right]));
+                break;
+            case Kind::IFF:
+                built[id] = std::make_shared<Sentence::sentence_t>(
+                    Sentence::Iff(built[n.left], built[n.right]));
+                break;
+        }
+    }
+
+    PIMPL_STATS_ADD(NODES_BUILT, count);
+    PIMPL_STATS_ADD(ALLOCATIONS, count);
+    PIMPL_STATS_ADD(ALLOCATED_BYTES, count * sizeof(Sentence::sentence_t));
+    return Sentence(built[root], symbols);
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+
+TEST_CASE("NodeStore hash-consing")
+{
+    using namespace pimpl;
+    using Kind = NodeStore::Kind;
+
+    NodeStore store;
+
+    SUBCASE("leaves") {
+        auto a = store.make_symbol("a");
+        CHECK(store.make_symbol("a") == a);
+        CHECK(store.make_symbol("b") != a);
+        CHECK(store.make_bool(true) == store.make_bool(true));
+        CHECK(store.make_bool(true) != store.make_bool(false));
+        CHECK(store.size() == 4);
+        CHECK(store.symbol_count() == 2);
+        CHECK(store.find_symbol("a") == store[a].left);
+        CHECK(store.find_symbol("c") == std::nullopt);
+        CHECK(store.symbol_name(store[a].left) == "a");
+        CHECK(store.global_symbol(store[a].left) == SymbolTable::global().intern("a"));
+    }
+
+    SUBCASE("operators") {
+        auto a = store.make_symbol("a");
+        auto b = store.make_symbol("b");
+        auto ab = store.make_binary(Kind::AND, a, b);
+        CHECK(store.make_binary(Kind::AND, a, b) == ab);
+        CHECK(store.make_binary(Kind::AND, b, a) != ab);
+        CHECK(store.make_binary(Kind::OR, a, b) != ab);
+        CHECK(store.make_not(ab) == store.make_not(ab));
+        CHECK(store.size() == 6);
+    }
+
+    SUBCASE("children precede parents") {
+        auto x = store.make_binary(Kind::IMP, store.make_symbol("p"), store.make_not(store.make_symbol("q")));
+        for (NodeStore::node_id_t id = 0; id < store.size(); ++id) {
+            if (store[id].kind == Kind::NOT) {
+                CHECK(store[id].left < id);
+            } else if (NodeStore::is_binary(store[id].kind)) {
+                CHECK(store[id].left < id);
+                CHECK(store[id].right < id);
+            }
+        }
+        CHECK(x == store.size() - 1);
+    }
+
+    SUBCASE("rehash keeps every node") {
+        std::vector<NodeStore::node_id_t> ids;
+        for (int i = 0; i < 1000; ++i) {
+            ids.push_back(store.make_symbol("s" + std::to_string(i)));
+        }
+        for (int i = 0; i < 1000; ++i) {
+            CHECK(store.make_symbol("s" + std::to_string(i)) == ids[i]);
+        }
+        CHECK(store.size() == 1000);
+    }
+}
+
+TEST_CASE("NodeStore round trip")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+
+    NodeStore store;
+
+    SUBCASE("monostate") {
+        CHECK(store.add(s_t(std::monostate())) == std::nullopt);
+        CHECK(store.add(s_t(Sentence::Not(nullptr))) == std::nullopt);
+    }
+
+    SUBCASE("repeated subterms are stored once") {
+        // (a & b) | (a & b)
+        auto data = std::make_shared<s_t>(Sentence::Or(
+            std::make_shared<s_t>(Sentence::And(std::make_shared<s_t>("a"), std::make_shared<s_t>("b"))),
+            std::make_shared<s_t>(Sentence::And(std::make_shared<s_t>("a"), std::make_shared<s_t>("b")))
+        ));
+        auto root = store.add(*data);
+        REQUIRE(root);
+        CHECK(store.size() == 4);
+        CHECK(store[*root].left == store[*root].right);
+
+        auto sentence = store.sentence(*root);
+        REQUIRE(sentence.data() != nullptr);
+        CHECK(*sentence.data() == *data);
+        CHECK(sentence.symbols().size() == 2);
+        CHECK(sentence.evaluate(std::unordered_map<std::string, bool>{{"a", true}, {"b", true}}) == true);
+        CHECK(sentence.evaluate(std::unordered_map<std::string, bool>{{"a", true}, {"b", false}}) == false);
+    }
+
+    SUBCASE("repeated symbols share one leaf") {
+        auto data = std::make_shared<s_t>(Sentence::Iff(
+            std::make_shared<s_t>("a"),
+            std::make_shared<s_t>(Sentence::Not(std::make_shared<s_t>("a")))
+        ));
+        auto sentence = store.sentence(*store.add(*data));
+        CHECK(sentence.evaluate(std::unordered_map<std::string, bool>{{"a", true}}) == false);
+        CHECK(sentence.evaluate(std::unordered_map<std::string, bool>{{"a", false}}) == false);
+    }
+
+    SUBCASE("out of range") {
+        CHECK(store.sentence(NodeStore::INVALID).data() == nullptr);
+    }
+
+    SUBCASE("sentence symbols keep their ids") {
+        auto b = std::make_shared<s_t>("b");
+        auto a = std::make_shared<s_t>("a");
+        auto c = std::make_shared<s_t>("c");
+        REQUIRE(store.add(Sentence(std::make_shared<s_t>(Sentence::Or(b, a)), {{"b", b}, {"a", a}, {"c", c}})));
+        CHECK(store.symbol_count() == 3);
+        CHECK(store.find_symbol("a") == 0u);
+        CHECK(store.find_symbol("b") == 1u);
+        CHECK(store.find_symbol("c") == 2u);
+
+        CHECK(store.add(Sentence()) == std::nullopt);
+        // d is used but not listed
+        auto d = std::make_shared<s_t>("d");
+        CHECK(store.add(Sentence(std::make_shared<s_t>(Sentence::And(a, d)), {{"a", a}})) == std::nullopt);
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
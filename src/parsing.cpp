@@ -1,5 +1,3 @@
-#include <unordered_map>
-
 #include "doctest/doctest.h"
 
 #include "pimpl/parsing.hpp"
@@ -7,72 +5,133 @@
 namespace pimpl::ast
 {
 
-inline Sentence::sentence_ptr_t sentenceBuilder(
-    const abstract_ptr ast_ptr,
-    std::unordered_map<std::string, Sentence::sentence_ptr_t>& symbol_map)
+namespace
 {
-    if (!ast_ptr) {
-        return std::make_shared<Sentence::sentence_t>(std::monostate());
-    }
 
-    if (auto ast_symbol = std::dynamic_pointer_cast<AbstractSymbol>(ast_ptr)) {
-        auto symbol = std::make_shared<Sentence::sentence_t>(ast_symbol->name);
-        symbol_map.insert({ast_symbol->name, symbol});
-        return symbol;
+// Move a child onto the stack if this is its last reference, otherwise just drop it
+void release(abstract_ptr& child, std::vector<abstract_ptr>& stack)
+{
+    if (child.use_count() == 1) {
+        stack.push_back(std::move(child));
+    } else {
+        child.reset();
     }
+}
 
-    if (auto ast_bool = std::dynamic_pointer_cast<AbstractBool>(ast_ptr)) {
-        return std::make_shared<Sentence::sentence_t>(ast_bool->value);
+// Tear down the subtrees of a dying node one node at a time instead of through nested destructors
+void release(abstract_ptr* left, abstract_ptr& right)
+{
+    std::vector<abstract_ptr> stack;
+    if (left != nullptr) {
+        release(*left, stack);
     }
-
-    if (auto ast_unary = std::dynamic_pointer_cast<AbstractUnary>(ast_ptr)) {
-        return std::make_shared<Sentence::sentence_t>(
-            Sentence::Not(sentenceBuilder(ast_unary->right, symbol_map)));
+    release(right, stack);
+
+    while (!stack.empty()) {
+        abstract_ptr node = std::move(stack.back());
+        stack.pop_back();
+        if (auto unary = dynamic_cast<AbstractUnary*>(node.get())) {
+            release(unary->right, stack);
+        } else if (auto binary = dynamic_cast<AbstractBinary*>(node.get())) {
+            release(binary->left, stack);
+            release(binary->right, stack);
+        }
     }
+}
+
+}   // namespace
+
+AbstractUnary::~AbstractUnary()
+{
+    release(nullptr, right);
+}
+
+AbstractBinary::~AbstractBinary()
+{
+    release(&left, right);
+}
+
+// Post-order walk with an explicit stack, so the depth of the AST doesn't matter
+inline NodeStore::node_id_t sentenceBuilder(const abstract_ptr& ast_ptr, NodeStore& store)
+{
+    PIMPL_STATS_TIMER(BUILD);
+    std::vector<std::pair<const AbstractBase*, bool>> stack{{ast_ptr.get(), false}};
+    std::vector<NodeStore::node_id_t> built;
+
+    while (!stack.empty()) {
+        auto [ast, expanded] = stack.back();
 
-    if (auto ast_binary = std::dynamic_pointer_cast<AbstractBinary>(ast_ptr)) {
-        Sentence::sentence_ptr_t sentence_ptr;
-        switch (ast_binary->op) {
-            case AbstractBinary::AND:
-                sentence_ptr = std::make_shared<Sentence::sentence_t>(Sentence::And(
-                    sentenceBuilder(ast_binary->left, symbol_map),
-                    sentenceBuilder(ast_binary->right, symbol_map)));
-                break;
-            case AbstractBinary::OR:
-                sentence_ptr = std::make_shared<Sentence::sentence_t>(Sentence::Or(
-                    sentenceBuilder(ast_binary->left, symbol_map),
-                    sentenceBuilder(ast_binary->right, symbol_map)));
-                break;
-            case AbstractBinary::IMP:
-                sentence_ptr = std::make_shared<Sentence::sentence_t>(Sentence::Imp(
-                    sentenceBuilder(ast_binary->left, symbol_map),
-                    sentenceBuilder(ast_binary->right, symbol_map)));
-                break;
-            case AbstractBinary::IFF:
-                sentence_ptr = std::make_shared<Sentence::sentence_t>(Sentence::Iff(
-                    sentenceBuilder(ast_binary->left, symbol_map),
-                    sentenceBuilder(ast_binary->right, symbol_map)));
-                break;
+        if (ast == nullptr) {
+            return NodeStore::INVALID;
+        }
+
+        auto ast_unary = dynamic_cast<const AbstractUnary*>(ast);
+        auto ast_binary = dynamic_cast<const AbstractBinary*>(ast);
+        if (!expanded && (ast_unary || ast_binary)) {
+            stack.back().second = true;
+            if (ast_unary) {
+                stack.emplace_back(ast_unary->right.get(), false);
+            } else {
+                stack.emplace_back(ast_binary->right.get(), false);
+                stack.emplace_back(ast_binary->left.get(), false);
+            }
+            continue;
+        }
+        stack.pop_back();
+
+        if (auto ast_symbol = dynamic_cast<const AbstractSymbol*>(ast)) {
+            built.push_back(store.make_symbol(ast_symbol->name));
+        } else if (auto ast_bool = dynamic_cast<const AbstractBool*>(ast)) {
+            built.push_back(store.make_bool(ast_bool->value));
+        } else if (ast_unary) {
+            built.back() = store.make_not(built.back());
+        } else if (ast_binary) {
+            auto right = built.back();
+            built.pop_back();
+            auto left = built.back();
+            switch (ast_binary->op) {
+                case AbstractBinary::AND:
+                    built.back() = store.make_binary(NodeStore::Kind::AND, left, right);
+                    break;
+                case AbstractBinary::OR:
+                    built.back() = store.make_binary(NodeStore::Kind::OR, left, right);
+                    break;
+                case AbstractBinary::IMP:
+                    built.back() = store.make_binary(NodeStore::Kind::IMP, left, right);
+                    break;
+                case AbstractBinary::IFF:
+                    built.back() = store.make_binary(NodeStore::Kind::IFF, left, right);
+                    break;
+            }
+        } else {
+            // _should_ never hit this
+            return NodeStore::INVALID;
         }
-        return sentence_ptr;
     }
 
-    // _should_ never hit this
-    return nullptr;
+    return built.back();
 }
 
-Sentence toSentence(abstract_ptr ast_ptr)
+NodeStore::node_id_t toNodes(abstract_ptr ast_ptr, NodeStore& store)
 {
-    Sentence::sentence_ptr_t sentence_ptr;
-
-    std::unordered_map<std::string, Sentence::sentence_ptr_t> symbol_map;
+    return sentenceBuilder(ast_ptr, store);
+}
 
-    if (ast_ptr == nullptr) {
-        return Sentence(sentence_ptr, symbol_map);
+std::optional<RuleSet> toRuleSet(const std::vector<abstract_ptr>& ast_ptrs)
+{
+    RuleSet rules;
+    for (const auto& ast_ptr : ast_ptrs) {
+        if (!rules.add(sentenceBuilder(ast_ptr, rules.store()))) {
+            return std::nullopt;
+        }
     }
+    return rules;
+}
 
-    sentence_ptr = sentenceBuilder(ast_ptr, symbol_map);
-    return Sentence(sentence_ptr, symbol_map);
+Sentence toSentence(abstract_ptr ast_ptr)
+{
+    NodeStore store;
+    return store.sentence(sentenceBuilder(ast_ptr, store));
 }
 
 }   // namespace pimpl::ast
@@ -80,6 +139,7 @@ Sentence toSentence(abstract_ptr ast_ptr)
 ////////////////////////////////////////////////////////////////////////////////
 
 #ifdef PIMPL_ENABLE_TESTS
+#include <array>
 #include <typeinfo>
 
 #include "doctest/doctest.h"
@@ -250,153 +310,218 @@ TEST_CASE("Manual verification of AST structure")
     //NOLINTEND(clang-diagnostic-potentially-evaluated-expression)
 }
 
-// TODO: add checks for symbol_map in subcases
 TEST_CASE("sentenceBuilder")
 {
     using namespace pimpl;
+    using Kind = NodeStore::Kind;
 
     ast::abstract_ptr ast_ptr = nullptr;
-    std::unordered_map<std::string, Sentence::sentence_ptr_t> symbol_map;
-    Sentence::sentence_ptr_t sentence_ptr = nullptr;
-    Sentence::sentence_ptr_t left_ptr = nullptr;
-    Sentence::sentence_ptr_t right_ptr = nullptr;
-    std::string str;
-    
-    SUBCASE("monostate") {
-        sentence_ptr = sentenceBuilder(ast_ptr, symbol_map);
-        REQUIRE(sentence_ptr->index() == Sentence::INDEX_MONOSTATE);
-        REQUIRE(std::holds_alternative<std::monostate>(*sentence_ptr));
-        REQUIRE(std::get<Sentence::INDEX_MONOSTATE>(*sentence_ptr) == std::monostate());
-        REQUIRE(symbol_map.empty());
+    NodeStore store;
+    NodeStore::node_id_t id = NodeStore::INVALID;
+
+    SUBCASE("nullptr") {
+        id = sentenceBuilder(ast_ptr, store);
+        REQUIRE(id == NodeStore::INVALID);
+        REQUIRE(store.size() == 0);
     }
 
     SUBCASE("Symbol") {
         ast_ptr = parse_first("FOO");
-        sentence_ptr = sentenceBuilder(ast_ptr, symbol_map);
-        REQUIRE(sentence_ptr->index() == Sentence::INDEX_SYMBOL);
-        REQUIRE(std::holds_alternative<std::string>(*sentence_ptr));
-        REQUIRE_NOTHROW(str = std::get<Sentence::INDEX_SYMBOL>(*sentence_ptr));
-        REQUIRE(str == "FOO");
-
-        REQUIRE(symbol_map.size() == 1);
-        REQUIRE(symbol_map.contains(str));
-        REQUIRE(symbol_map.at(str) == sentence_ptr);
+        id = sentenceBuilder(ast_ptr, store);
+        REQUIRE(store[id].kind == Kind::SYMBOL);
+        REQUIRE(store.symbol_name(store[id].left) == "FOO");
+        REQUIRE(store.symbol_count() == 1);
     }
 
     SUBCASE("Bool") {
         ast_ptr = parse_first("T");
-        sentence_ptr = sentenceBuilder(ast_ptr, symbol_map);
-        REQUIRE(sentence_ptr->index() == Sentence::INDEX_BOOL);
-        REQUIRE(std::holds_alternative<bool>(*sentence_ptr));
-        REQUIRE(std::get<Sentence::INDEX_BOOL>(*sentence_ptr) == true);
+        id = sentenceBuilder(ast_ptr, store);
+        REQUIRE(store[id].kind == Kind::BOOL);
+        REQUIRE(store[id].left == true);
 
         ast_ptr = parse_first("F");
-        sentence_ptr = sentenceBuilder(ast_ptr, symbol_map);
-        REQUIRE(sentence_ptr->index() == Sentence::INDEX_BOOL);
-        REQUIRE(std::holds_alternative<bool>(*sentence_ptr));
-        REQUIRE(std::get<Sentence::INDEX_BOOL>(*sentence_ptr) == false);
+        id = sentenceBuilder(ast_ptr, store);
+        REQUIRE(store[id].kind == Kind::BOOL);
+        REQUIRE(store[id].left == false);
 
-        CHECK(symbol_map.empty());
+        CHECK(store.symbol_count() == 0);
     }
 
     SUBCASE("Not") {
         ast_ptr = parse_first("~L33t");
-        sentence_ptr = sentenceBuilder(ast_ptr, symbol_map);
-        REQUIRE(sentence_ptr->index() == Sentence::INDEX_NOT);
-        REQUIRE(std::holds_alternative<Sentence::Not>(*sentence_ptr));
-        REQUIRE_NOTHROW(right_ptr = std::get<Sentence::INDEX_NOT>(*sentence_ptr).right);
-
-        REQUIRE(right_ptr->index() == Sentence::INDEX_SYMBOL);
-        REQUIRE_NOTHROW(str = std::get<Sentence::INDEX_SYMBOL>(*right_ptr));
-        REQUIRE(str == "L33t");
-
-        REQUIRE(symbol_map.size() == 1);
-        REQUIRE(symbol_map.contains(str));
-        REQUIRE(symbol_map.at(str) == right_ptr);
+        id = sentenceBuilder(ast_ptr, store);
+        REQUIRE(store[id].kind == Kind::NOT);
+
+        auto right = store[store[id].left];
+        REQUIRE(right.kind == Kind::SYMBOL);
+        REQUIRE(store.symbol_name(right.left) == "L33t");
+        REQUIRE(store.symbol_count() == 1);
     }
 
     SUBCASE("And") {
         ast_ptr = parse_first("a & b");
-        sentence_ptr = sentenceBuilder(ast_ptr, symbol_map);
-        REQUIRE(sentence_ptr->index() == Sentence::INDEX_AND);
-        REQUIRE(std::holds_alternative<Sentence::And>(*sentence_ptr));
-        REQUIRE_NOTHROW(left_ptr = std::get<Sentence::INDEX_AND>(*sentence_ptr).left);
-        REQUIRE_NOTHROW(right_ptr = std::get<Sentence::INDEX_AND>(*sentence_ptr).right);
-
-        REQUIRE(left_ptr->index() == Sentence::INDEX_SYMBOL);
-        REQUIRE_NOTHROW(str = std::get<Sentence::INDEX_SYMBOL>(*left_ptr));
-        REQUIRE(str == "a");
-
-        REQUIRE(symbol_map.contains(str));
-        REQUIRE(symbol_map.at(str) == left_ptr);
-
-        REQUIRE(right_ptr->index() == Sentence::INDEX_SYMBOL);
-        REQUIRE_NOTHROW(str = std::get<Sentence::INDEX_SYMBOL>(*right_ptr));
-        REQUIRE(str == "b");
-
-        REQUIRE(symbol_map.contains(str));
-        REQUIRE(symbol_map.at(str) == right_ptr);
-        REQUIRE(symbol_map.size() == 2);
+        id = sentenceBuilder(ast_ptr, store);
+        REQUIRE(store[id].kind == Kind::AND);
+
+        auto left = store[store[id].left];
+        REQUIRE(left.kind == Kind::SYMBOL);
+        REQUIRE(store.symbol_name(left.left) == "a");
+
+        auto right = store[store[id].right];
+        REQUIRE(right.kind == Kind::SYMBOL);
+        REQUIRE(store.symbol_name(right.left) == "b");
+        REQUIRE(store.symbol_count() == 2);
     }
 
     SUBCASE("Or") {
         ast_ptr = parse_first("T | F");
-        sentence_ptr = sentenceBuilder(ast_ptr, symbol_map);
-        REQUIRE(sentence_ptr->index() == Sentence::INDEX_OR);
-        REQUIRE(std::holds_alternative<Sentence::Or>(*sentence_ptr));
-        REQUIRE_NOTHROW(left_ptr = std::get<Sentence::INDEX_OR>(*sentence_ptr).left);
-        REQUIRE_NOTHROW(right_ptr = std::get<Sentence::INDEX_OR>(*sentence_ptr).right);
-
-        REQUIRE(left_ptr->index() == Sentence::INDEX_BOOL);
-        REQUIRE(std::get<Sentence::INDEX_BOOL>(*left_ptr) == true);
-
-        REQUIRE(right_ptr->index() == Sentence::INDEX_BOOL);
-        REQUIRE(std::get<Sentence::INDEX_BOOL>(*right_ptr) == false);
-
-        REQUIRE(symbol_map.empty());
+        id = sentenceBuilder(ast_ptr, store);
+        REQUIRE(store[id].kind == Kind::OR);
+        REQUIRE(store[store[id].left].kind == Kind::BOOL);
+        REQUIRE(store[store[id].left].left == true);
+        REQUIRE(store[store[id].right].kind == Kind::BOOL);
+        REQUIRE(store[store[id].right].left == false);
+        REQUIRE(store.symbol_count() == 0);
     }
 
     SUBCASE("Imp") {
         ast_ptr = parse_first("c => T");
-        sentence_ptr = sentenceBuilder(ast_ptr, symbol_map);
-        REQUIRE(sentence_ptr->index() == Sentence::INDEX_IMP);
-        REQUIRE(std::holds_alternative<Sentence::Imp>(*sentence_ptr));
-        REQUIRE_NOTHROW(left_ptr = std::get<Sentence::INDEX_IMP>(*sentence_ptr).left);
-        REQUIRE_NOTHROW(right_ptr = std::get<Sentence::INDEX_IMP>(*sentence_ptr).right);
-
-        REQUIRE(left_ptr->index() == Sentence::INDEX_SYMBOL);
-        REQUIRE_NOTHROW(str = std::get<Sentence::INDEX_SYMBOL>(*left_ptr));
-        REQUIRE(str == "c");
-
-        REQUIRE(symbol_map.contains(str));
-        REQUIRE(symbol_map.at(str) == left_ptr);
-        REQUIRE(symbol_map.size() == 1);
-
-        REQUIRE(right_ptr->index() == Sentence::INDEX_BOOL);
-        REQUIRE(std::get<Sentence::INDEX_BOOL>(*right_ptr) == true);
+        id = sentenceBuilder(ast_ptr, store);
+        REQUIRE(store[id].kind == Kind::IMP);
+        REQUIRE(store[store[id].left].kind == Kind::SYMBOL);
+        REQUIRE(store.symbol_name(store[store[id].left].left) == "c");
+        REQUIRE(store[store[id].right].kind == Kind::BOOL);
+        REQUIRE(store[store[id].right].left == true);
     }
 
     SUBCASE("Iff") {
         ast_ptr = parse_first("F <=> d");
-        sentence_ptr = sentenceBuilder(ast_ptr, symbol_map);
-        REQUIRE(sentence_ptr->index() == Sentence::INDEX_IFF);
-        REQUIRE(std::holds_alternative<Sentence::Iff>(*sentence_ptr));
-        REQUIRE_NOTHROW(left_ptr = std::get<Sentence::INDEX_IFF>(*sentence_ptr).left);
-        REQUIRE_NOTHROW(right_ptr = std::get<Sentence::INDEX_IFF>(*sentence_ptr).right);
-
-        REQUIRE(left_ptr->index() == Sentence::INDEX_BOOL);
-        REQUIRE(std::get<Sentence::INDEX_BOOL>(*left_ptr) == false);
-
-        REQUIRE(right_ptr->index() == Sentence::INDEX_SYMBOL);
-        REQUIRE_NOTHROW(str = std::get<Sentence::INDEX_SYMBOL>(*right_ptr));
-        REQUIRE(str == "d");
-
-        REQUIRE(symbol_map.contains(str));
-        REQUIRE(symbol_map.at(str) == right_ptr);
-        REQUIRE(symbol_map.size() == 1);
+        id = sentenceBuilder(ast_ptr, store);
+        REQUIRE(store[id].kind == Kind::IFF);
+        REQUIRE(store[store[id].left].kind == Kind::BOOL);
+        REQUIRE(store[store[id].left].left == false);
+        REQUIRE(store[store[id].right].kind == Kind::SYMBOL);
+        REQUIRE(store.symbol_name(store[store[id].right].left) == "d");
+    }
+
+    SUBCASE("repeated subterms are shared") {
+        ast_ptr = parse_first("(a & b) | ~(a & b)");
+        id = sentenceBuilder(ast_ptr, store);
+        REQUIRE(store[id].kind == Kind::OR);
+        REQUIRE(store[store[id].right].kind == Kind::NOT);
+        CHECK(store[store[id].right].left == store[id].left);
+        CHECK(store.size() == 5);
+    }
+}
+
+TEST_CASE("direct Sentence callbacks")
+{
+    using namespace pimpl;
+
+    auto direct = [](const char* str) {
+        std::unordered_map<std::string, Sentence::sentence_ptr_t> symbols;
+        grammar::SentenceState state{&symbols};
+        auto input = lexy::zstring_input<lexy::utf8_encoding>(str);
+        auto result = lexy::parse<grammar::GrammarSentenceLine>(input, state, lexy::noop);
+        INFO(str);
+        REQUIRE(result.is_success());
+        return Sentence(result.value(), std::move(symbols));
+    };
+
+    // same trees as the AST route
+    for (const char* str : {"foo", "T", "~bar", "a & b", "T | F", "c => T", "F <=> d",
+                            "~(a & b) | c => d <=> ~~e", "((x))"}) {
+        INFO(str);
+        auto sentence = direct(str);
+        auto expected = ast::toSentence(parse_first(str));
+        CHECK(*sentence.data() == *expected.data());
+        CHECK(sentence.symbol_names() == expected.symbol_names());
     }
+
+    // every occurrence of a symbol is the same leaf
+    auto sentence = direct("a & (b | ~a)");
+    REQUIRE(sentence.symbols().size() == 2);
+    const auto& and_ = std::get<Sentence::And>(*sentence.data());
+    const auto& or_ = std::get<Sentence::Or>(*and_.right);
+    CHECK(and_.left == sentence.symbols().at("a"));
+    CHECK(std::get<Sentence::Not>(*or_.right).right == and_.left);
+
+    auto input = lexy::zstring_input<lexy::utf8_encoding>("a &");
+    std::unordered_map<std::string, Sentence::sentence_ptr_t> symbols;
+    grammar::SentenceState state{&symbols};
+    CHECK(!lexy::parse<grammar::GrammarSentenceLine>(input, state, lexy::noop).is_success());
 }
 
-// TODO: add basic toSentence test(s)
+TEST_CASE("toSentence")
+{
+    using namespace pimpl;
+
+    CHECK(ast::toSentence(nullptr).data() == nullptr);
+
+    auto sentence = ast::toSentence(parse_first("a & ~a"));
+    CHECK(sentence.symbols().size() == 1);
+    CHECK(sentence.evaluate(std::unordered_map<std::string, bool>{{"a", true}}) == false);
+    CHECK(sentence.evaluate(std::unordered_map<std::string, bool>{{"a", false}}) == false);
+}
+
+TEST_CASE("toRuleSet")
+{
+    using namespace pimpl;
+
+    auto rules = ast::toRuleSet(parse_str("(a & b) | c\n(a & b) => c\n~(a & b)\n"));
+    REQUIRE(rules);
+    REQUIRE(rules->size() == 3);
+    // a, b, a & b, c and the three roots
+    CHECK(rules->node_count() == 7);
+    CHECK(rules->evaluate({{"a", true}, {"b", true}, {"c", false}}) == std::vector<bool>{true, false, false});
+    REQUIRE(rules->rule(2));
+    CHECK(*rules->rule(2)->data() == *ast::toSentence(parse_first("~(a & b)")).data());
+
+    CHECK(ast::toRuleSet({}).value().size() == 0);
+    CHECK(!ast::toRuleSet({parse_first("a"), nullptr}));
+}
+
+TEST_CASE("deep input")
+{
+    using namespace pimpl;
+
+    // a left-deep chain far past any native recursion limit
+    std::string chain = "a0";
+    for (int i = 1; i < 100000; ++i) {
+        chain += " & a" + std::to_string(i % 100);
+    }
+    auto sentence = ast::toSentence(parse_first(chain.c_str()));
+    REQUIRE(sentence.data() != nullptr);
+    CHECK(sentence.symbol_names().size() == 100);
+    std::array<bool, 100> values;
+    values.fill(true);
+    CHECK(sentence.evaluate_ids(values) == true);
+    values[42] = false;
+    CHECK(sentence.evaluate_ids(values) == false);
+
+    std::unordered_map<std::string, Sentence::sentence_ptr_t> symbols;
+    grammar::SentenceState state{&symbols};
+    auto input = lexy::string_input<lexy::utf8_encoding>(chain.data(), chain.size());
+    auto result = lexy::parse<grammar::GrammarSentenceLine>(input, state, lexy::noop);
+    REQUIRE(result.is_success());
+    CHECK(*result.value() == *sentence.data());
+
+    // parentheses recurse inside lexy and are only bounded by MAX_NESTING
+    auto nested = [](size_t depth) {
+        return std::string(depth, '(') + "a" + std::string(depth, ')');
+    };
+    CHECK(lexy::match<grammar::GrammarLine>(lexy::zstring_input<lexy::utf8_encoding>(nested(300).c_str())));
+    CHECK(!lexy::match<grammar::GrammarLine>(
+        lexy::zstring_input<lexy::utf8_encoding>(nested(grammar::MAX_NESTING + 1).c_str())));
+
+    // so does every ~ of a prefix chain, up to the same bound
+    auto negations = [](size_t depth) {
+        return std::string(depth, '~') + "a";
+    };
+    auto negated = ast::toSentence(parse_first(negations(1000).c_str()));
+    REQUIRE(negated.data() != nullptr);
+    CHECK(negated.evaluate(std::unordered_map<std::string, bool>{{"a", false}}) == false);
+    CHECK(!lexy::match<grammar::GrammarLine>(lexy::zstring_input<lexy::utf8_encoding>(negations(100000).c_str())));
+}
 
 #endif  // PIMPL_ENABLE_TESTS
@@ -0,0 +1,173 @@
+#include <memory>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/rule_set.hpp"
+#include "pimpl/stats.hpp"
+
+namespace pimpl
+{
+
+std::optional<RuleSet::rule_id_t> RuleSet::add(const Sentence& sentence)
+{
+    auto root = store_.add(sentence);
+    if (!root) {
+        return std::nullopt;
+    }
+    return add(*root);
+}
+
+std::optional<RuleSet::rule_id_t> RuleSet::add(NodeStore::node_id_t root)
+{
+    if (root >= store_.size()) {
+        return std::nullopt;
+    }
+    roots_.push_back(root);
+    return rule_id_t(roots_.size() - 1);
+}
+
+bool RuleSet::evaluate(std::span<const bool> values, std::span<bool> results) const
+{
+    if (values.size() != store_.symbol_count() || results.size() != roots_.size()) {
+        return false;
+    }
+
+    PIMPL_STATS_TIMER(EVALUATE);
+    std::vector<uint8_t> node_values(store_.size());
+    evaluate_nodes(store_.nodes(), values, std::span(node_values));
+    PIMPL_STATS_ADD(NODES_VISITED, store_.size());
+
+    for (size_t i = 0; i < roots_.size(); ++i) {
+        results[i] = node_values[roots_[i]];
+    }
+    return true;
+}
+
+std::optional<std::vector<bool>> RuleSet::evaluate(const std::unordered_map<std::string, bool>& symbol_values) const
+{
+    std::unique_ptr<bool[]> values(new bool[store_.symbol_count()]);
+    for (uint32_t id = 0; id < store_.symbol_count(); ++id) {
+        auto it = symbol_values.find(store_.symbol_name(id));
+        if (it == symbol_values.end()) {
+            return std::nullopt;
+        }
+        values[id] = it->second;
+    }
+
+    std::unique_ptr<bool[]> results(new bool[roots_.size()]);
+    evaluate(std::span<const bool>(values.get(), store_.symbol_count()), std::span<bool>(results.get(), roots_.size()));
+    return std::vector<bool>(results.get(), results.get() + roots_.size());
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <random>
+
+#include "random_sentence.hpp"
+
+TEST_CASE("RuleSet")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+    using ptr_t = Sentence::sentence_ptr_t;
+
+    SUBCASE("shared subformulas are stored once") {
+        // (a & b) | c, (a & b) => d and ~(a & b), each built from its own leaves
+        auto rule = [](auto make_root, std::vector<const char*> names) {
+            std::unordered_map<std::string, ptr_t> symbols;
+            for (const char* name : names) {
+                symbols.emplace(name, std::make_shared<s_t>(name));
+            }
+            auto ab = std::make_shared<s_t>(Sentence::And(symbols.at("a"), symbols.at("b")));
+            return Sentence(make_root(ab, symbols), symbols);
+        };
+        RuleSet rules;
+        CHECK(rules.add(rule([](ptr_t ab, auto& s) { return std::make_shared<s_t>(Sentence::Or(ab, s.at("c"))); },
+                             {"a", "b", "c"})) == 0u);
+        CHECK(rules.add(rule([](ptr_t ab, auto& s) { return std::make_shared<s_t>(Sentence::Imp(ab, s.at("d"))); },
+                             {"a", "b", "d"})) == 1u);
+        CHECK(rules.add(rule([](ptr_t ab, auto&) { return std::make_shared<s_t>(Sentence::Not(ab)); },
+                             {"a", "b"})) == 2u);
+        REQUIRE(rules.size() == 3);
+
+        // a, b, a & b, c, d, and one root each
+        CHECK(rules.node_count() == 8);
+        CHECK(rules.symbol_count() == 4);
+        CHECK(rules.symbol_id("d") == 3u);
+        CHECK(rules.symbol_id("e") == std::nullopt);
+
+        auto results = rules.evaluate({{"a", true}, {"b", true}, {"c", false}, {"d", false}});
+        CHECK(results == std::vector<bool>{true, false, false});
+        CHECK(rules.evaluate({{"a", true}, {"b", true}}) == std::nullopt);
+
+        CHECK(rules.rule(3) == std::nullopt);
+        CHECK(rules.root(3) == std::nullopt);
+        REQUIRE(rules.root(2));
+        CHECK(rules.store()[*rules.root(2)].kind == NodeStore::Kind::NOT);
+        REQUIRE(rules.rule(2));
+        CHECK(*rules.rule(2)->data() == *rule([](ptr_t ab, auto&) { return std::make_shared<s_t>(Sentence::Not(ab)); },
+                                             {"a", "b"}).data());
+    }
+
+    SUBCASE("malformed and mismatched input") {
+        RuleSet rules;
+        CHECK(rules.add(Sentence()) == std::nullopt);
+        CHECK(rules.add(Sentence(std::make_shared<s_t>(std::monostate()), {})) == std::nullopt);
+        CHECK(rules.add(NodeStore::INVALID) == std::nullopt);
+
+        // a malformed right side leaves nothing of the well-formed left side behind
+        auto p = std::make_shared<s_t>("p");
+        auto q = std::make_shared<s_t>("q");
+        auto left = std::make_shared<s_t>(Sentence::And(p, std::make_shared<s_t>(Sentence::Not(q))));
+        CHECK(rules.add(Sentence(std::make_shared<s_t>(Sentence::Or(left, std::make_shared<s_t>(std::monostate()))),
+                                 {{"p", p}, {"q", q}})) == std::nullopt);
+        CHECK(rules.node_count() == 0);
+        CHECK(rules.symbol_count() == 0);
+
+        // q is in the tree but not in the symbol table
+        CHECK(rules.add(Sentence(left, {{"p", p}})) == std::nullopt);
+        CHECK(rules.node_count() == 0);
+        CHECK(rules.symbol_count() == 0);
+
+        auto leaf = rules.store().make_symbol("x");
+        CHECK(rules.add(rules.store().make_not(leaf)) == 0u);
+        bool values[2] = {true, true};
+        bool results[1];
+        CHECK(!rules.evaluate(std::span<const bool>(values, 2), std::span<bool>(results, 1)));
+        CHECK(rules.evaluate(std::span<const bool>(values, 1), std::span<bool>(results, 1)));
+        CHECK(!results[0]);
+    }
+
+    SUBCASE("agrees with evaluating every rule on its own") {
+        std::mt19937 rng(17);
+        constexpr size_t SYMBOLS = 8;
+        auto symbols = test::random_symbols(SYMBOLS);
+        std::vector<ptr_t> pool = symbols.leaves;
+
+        // every rule builds on earlier subformulas, so they overlap heavily
+        RuleSet rules;
+        std::vector<Sentence> sentences;
+        for (int i = 0; i < 200; ++i) {
+            sentences.emplace_back(test::grow_random(rng, pool, 1), symbols.table);
+            REQUIRE(rules.add(sentences.back()));
+        }
+        CHECK(rules.node_count() <= pool.size());
+
+        for (int trial = 0; trial < 50; ++trial) {
+            std::unordered_map<std::string, bool> assignment;
+            for (size_t i = 0; i < SYMBOLS; ++i) {
+                assignment.emplace("s" + std::to_string(i), rng() & 1);
+            }
+            auto results = rules.evaluate(assignment);
+            REQUIRE(results);
+            for (size_t i = 0; i < sentences.size(); ++i) {
+                CHECK((*results)[i] == sentences[i].evaluate(assignment));
+            }
+        }
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
@@ -1,41 +1,583 @@
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <unordered_set>
 
 #include "doctest/doctest.h"
 
+#include "pimpl/cnf.hpp"
+#include "pimpl/compiled_sentence.hpp"
 #include "pimpl/sentence.hpp"
+#include "pimpl/solver.hpp"
+#include "pimpl/stats.hpp"
+#include "pimpl/thread_pool.hpp"
 
 namespace pimpl
 {
 
-std::optional<bool> Sentence::evaluate(std::unordered_map<std::string, bool> symbol_values)
+namespace
+{
+
+// splitmix64 finalizer, spreads every input bit over the whole word
+uint64_t mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+enum class Query
+{
+    MALFORMED,
+    NO_MODEL,
+    MODEL,
+};
+
+// Solve the sentence, or its negation, and keep the symbol part of the model
+Query find_model(const Sentence& sentence, bool negate, std::vector<bool>& model)
+{
+    auto cnf = to_cnf(sentence, CnfEncoding::PLAISTED_GREENBAUM, negate);
+    if (!cnf) {
+        return Query::MALFORMED;
+    }
+
+    Solver solver(*cnf);
+    if (!solver.solve()) {
+        return Query::NO_MODEL;
+    }
+    model.assign(solver.model().begin(), solver.model().begin() + cnf->num_symbols);
+    return Query::MODEL;
+}
+
+}   // namespace
+
+Sentence::Sentence(sentence_ptr_t d, std::unordered_map<std::string, sentence_ptr_t> v)
+    : data_(d), symbols_(v)
+{
+    symbol_names_.reserve(symbols_.size());
+    for (const auto& [name, _] : symbols_) {
+        symbol_names_.push_back(name);
+    }
+    std::ranges::sort(symbol_names_);
+
+    symbol_ids_.reserve(symbol_names_.size());
+    slots_.reserve(symbol_names_.size());
+    for (const auto& name : symbol_names_) {
+        slots_.emplace_back(SymbolTable::global().intern(name), symbol_ids_.size());
+        symbol_ids_.push_back(slots_.back().first);
+    }
+    std::ranges::sort(slots_);
+}
+
+std::optional<uint32_t> Sentence::symbol_id(std::string_view name) const
+{
+    auto it = std::ranges::lower_bound(symbol_names_, name);
+    if (it == symbol_names_.end() || *it != name) {
+        return std::nullopt;
+    }
+    return it - symbol_names_.begin();
+}
+
+std::optional<uint32_t> Sentence::symbol_slot(Symbol symbol) const
+{
+    auto it = std::ranges::lower_bound(slots_, symbol.id, {}, &std::pair<SymbolTable::symbol_id_t, uint32_t>::first);
+    if (it == slots_.end() || it->first != symbol.id) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<bool> Sentence::evaluate(const std::unordered_map<std::string, bool>& symbol_values) const
 {
     if (symbols_.size() != symbol_values.size()) {
         return std::nullopt;
     }
 
-    // substitute the provided bools into each symbol
+    // lay the values out by symbol id
+    auto values = std::make_unique<bool[]>(symbol_names_.size());
     for (const auto& [key, val] : symbol_values) {
-        if (!symbols_.contains(key)) {
+        auto id = symbol_id(key);
+        if (!id) {
             return std::nullopt;
         }
-        *symbols_.at(key) = val;
+        values[*id] = val;
+    }
+
+    return evaluate_ids(std::span<const bool>(values.get(), symbol_names_.size()));
+}
+
+std::optional<bool> Sentence::evaluate_ids(std::span<const bool> symbol_values) const
+{
+    if (data_ == nullptr || symbol_values.size() != symbol_names_.size()) {
+        return std::nullopt;
+    }
+    PIMPL_STATS_TIMER(EVALUATE);
+    return evaluate_tree(symbol_values);
+}
+
+bool Sentence::evaluate_batch(std::span<const bool> assignments, std::span<bool> results,
+                              ThreadPool* pool) const
+{
+    const size_t width = symbol_names_.size();
+    if (data_ == nullptr || assignments.size() != results.size() * width) {
+        return false;
+    }
+
+    // one compile for the whole batch, then every row is a run of the flat program
+    const CompiledSentence compiled(*this);
+    std::atomic<bool> ok = true;
+
+    auto rows = [&](size_t begin, size_t end) {
+        bool chunk_ok = true;
+        for (size_t row = begin; row < end; ++row) {
+            auto res = compiled.evaluate(assignments.subspan(row * width, width));
+            chunk_ok &= res.has_value();
+            results[row] = res.value_or(false);
+        }
+        if (!chunk_ok) {
+            ok = false;
+        }
+    };
+
+    constexpr size_t GRAIN = 4096;
+    if (pool != nullptr) {
+        pool->parallel_for(results.size(), GRAIN, rows);
+    } else {
+        rows(0, results.size());
+    }
+
+    return ok;
+}
+
+std::optional<bool> Sentence::truth() const
+{
+    if (data_ == nullptr) {
+        return std::nullopt;
+    }
+    PIMPL_STATS_TIMER(EVALUATE);
+    return evaluate_tree({});
+}
+
+std::optional<bool> Sentence::evaluate_tree(std::span<const bool> values) const
+{
+    // stage counts the operands of the node that have been evaluated so far,
+    // an Iff also keeps the value of its left side in it
+    struct Frame
+    {
+        const sentence_t* sentence;
+        int stage;
+    };
+    std::vector<Frame> stack{{data_.get(), 0}};
+    std::optional<bool> acc;
+    uint64_t visited = 0;
+    uint64_t short_circuits = 0;
+
+    auto negate = [](bool b) { return !b; };
+
+    while (!stack.empty()) {
+        const auto [s, stage] = stack.back();
+        const sentence_ptr_t* next = nullptr;
+        stack.back().stage++;
+        visited += stage == 0;
+
+        if (s == nullptr) {
+            acc = std::nullopt;
+            stack.pop_back();
+            continue;
+        }
+
+        switch (s->index()) {
+            case INDEX_SYMBOL:
+                acc = std::nullopt;
+                if (!values.empty()) {
+                    acc = symbol_slot(std::get<Symbol>(*s)).transform([values](uint32_t id) { return values[id]; });
+                }
+                break;
+            case INDEX_BOOL:
+                acc = std::get<bool>(*s);
+                break;
+            case INDEX_NOT:
+                if (stage == 0) {
+                    next = &std::get<Not>(*s).right;
+                } else {
+                    acc = acc.transform(negate);
+                }
+                break;
+            case INDEX_AND:
+                // a false or failed left side decides the result
+                if (stage == 0) {
+                    next = &std::get<And>(*s).left;
+                } else if (stage == 1 && acc == true) {
+                    next = &std::get<And>(*s).right;
+                } else if (stage == 1) {
+                    short_circuits += acc.has_value();
+                }
+                break;
+            case INDEX_OR:
+                if (stage == 0) {
+                    next = &std::get<Or>(*s).left;
+                } else if (stage == 1 && acc == false) {
+                    next = &std::get<Or>(*s).right;
+                } else if (stage == 1) {
+                    short_circuits += acc.has_value();
+                }
+                break;
+            case INDEX_IMP:
+                // the right side goes first, if it is true the left side doesn't matter
+                if (stage == 0) {
+                    next = &std::get<Imp>(*s).right;
+                } else if (stage == 1 && acc == false) {
+                    next = &std::get<Imp>(*s).left;
+                } else if (stage == 1) {
+                    short_circuits += acc.has_value();
+                } else if (stage == 2) {
+                    acc = acc.transform(negate);
+                }
+                break;
+            case INDEX_IFF:
+                if (stage == 0) {
+                    next = &std::get<Iff>(*s).left;
+                } else if (stage == 1 && acc) {
+                    stack.back().stage = 2 + *acc;
+                    next = &std::get<Iff>(*s).right;
+                } else if (stage >= 2) {
+                    const bool left = stage == 3;
+                    acc = acc.transform([left](bool right) { return left == right; });
+                }
+                break;
+            default:
+                acc = std::nullopt;
+                break;
+        }
+
+        if (next != nullptr) {
+            stack.push_back({next->get(), 0});
+        } else {
+            stack.pop_back();
+        }
     }
 
-    // evaluate the sentence
-    auto res = truth();
+    PIMPL_STATS_ADD(NODES_VISITED, visited);
+    PIMPL_STATS_ADD(SHORT_CIRCUITS, short_circuits);
+    return acc;
+}
+
+bool Sentence::equal(const sentence_ptr_t& lhs, const sentence_ptr_t& rhs)
+{
+    std::vector<std::pair<const sentence_t*, const sentence_t*>> stack{{lhs.get(), rhs.get()}};
+    uint64_t visited = 0;
+    bool same = true;
 
-    // reset the sentence
-    std::ranges::for_each(symbols_, [](const auto& s) { *s.second = s.first; });
+    while (same && !stack.empty()) {
+        auto [a, b] = stack.back();
+        stack.pop_back();
+        ++visited;
 
-    return res;
+        // shared subtrees are equal without looking inside
+        if (a == b) {
+            continue;
+        }
+        if (a == nullptr || b == nullptr || a->index() != b->index()) {
+            same = false;
+            break;
+        }
+        // differently shaped operator nodes are unequal without looking inside
+        if (a->index() >= INDEX_NOT && (tree_hash(*a) != tree_hash(*b) || tree_size(*a) != tree_size(*b))) {
+            same = false;
+            break;
+        }
+
+        switch (a->index()) {
+            case INDEX_SYMBOL:
+                same = std::get<Symbol>(*a) == std::get<Symbol>(*b);
+                break;
+            case INDEX_BOOL:
+                same = std::get<bool>(*a) == std::get<bool>(*b);
+                break;
+            case INDEX_NOT:
+                stack.emplace_back(std::get<Not>(*a).right.get(), std::get<Not>(*b).right.get());
+                break;
+            default:
+                std::visit([&stack, b](const auto& x) {
+                    using T = std::decay_t<decltype(x)>;
+                    if constexpr (requires { x.left; x.right; }) {
+                        const auto& y = std::get<T>(*b);
+                        stack.emplace_back(x.right.get(), y.right.get());
+                        stack.emplace_back(x.left.get(), y.left.get());
+                    }
+                }, *a);
+                break;
+        }
+    }
+
+    PIMPL_STATS_ADD(NODES_VISITED, visited);
+    return same;
+}
+
+bool Sentence::operator==(const Sentence& rhs) const
+{
+    return equal(data_, rhs.data_) && symbol_names_ == rhs.symbol_names_;
+}
+
+size_t Sentence::tree_hash(const sentence_t& sentence)
+{
+    switch (sentence.index()) {
+        case INDEX_SYMBOL:
+            return mix(mix(INDEX_SYMBOL) ^ std::get<Symbol>(sentence).id);
+        case INDEX_BOOL:
+            return mix(mix(INDEX_BOOL) ^ std::get<bool>(sentence));
+        default:
+            return std::visit([](const auto& x) -> size_t {
+                if constexpr (requires { x.hash; }) {
+                    return x.hash;
+                } else {
+                    return mix(INDEX_MONOSTATE);
+                }
+            }, sentence);
+    }
 }
 
-std::optional<bool> Sentence::truth()
+uint64_t Sentence::tree_size(const sentence_t& sentence)
+{
+    return std::visit([](const auto& x) -> uint64_t {
+        if constexpr (requires { x.size; }) {
+            return x.size;
+        } else {
+            return 1;
+        }
+    }, sentence);
+}
+
+size_t Sentence::combine_hash(size_t index, const sentence_ptr_t* left, const sentence_ptr_t& right)
+{
+    uint64_t h = mix(index);
+    if (left != nullptr) {
+        h = mix(h ^ (*left ? tree_hash(**left) : 0));
+    }
+    return mix(h + (right ? tree_hash(*right) : 0));
+}
+
+uint64_t Sentence::combine_size(const sentence_ptr_t* left, const sentence_ptr_t& right)
+{
+    // a tree with shared subtrees can count more nodes than fit, saturate instead of wrapping
+    uint64_t size = 1;
+    for (const sentence_ptr_t* child : {left, &right}) {
+        if (child != nullptr && *child) {
+            const uint64_t n = tree_size(**child);
+            size = n > UINT64_MAX - size ? UINT64_MAX : size + n;
+        }
+    }
+    return size;
+}
+
+void Sentence::release(sentence_ptr_t* left, sentence_ptr_t& right)
+{
+    // Only nodes that are about to die with children of their own go on the stack,
+    // the usual leaf or shared child is dropped right away without allocating
+    std::vector<sentence_ptr_t> stack;
+    auto take = [&stack](sentence_ptr_t& child) {
+        if (child.use_count() == 1 && child->index() >= INDEX_NOT) {
+            stack.push_back(std::move(child));
+        } else {
+            child.reset();
+        }
+    };
+
+    if (left != nullptr) {
+        take(*left);
+    }
+    take(right);
+
+    while (!stack.empty()) {
+        sentence_ptr_t node = std::move(stack.back());
+        stack.pop_back();
+        std::visit([&take](auto& s) {
+            if constexpr (requires { s.left; }) {
+                take(s.left);
+            }
+            if constexpr (requires { s.right; }) {
+                take(s.right);
+            }
+        }, *node);
+        // node has no children left, so destroying it here doesn't recurse
+    }
+}
+
+std::optional<std::vector<bool>> Sentence::satisfiable() const
+{
+    std::vector<bool> model;
+    if (find_model(*this, false, model) != Query::MODEL) {
+        return std::nullopt;
+    }
+    return model;
+}
+
+std::optional<bool> Sentence::valid() const
+{
+    std::vector<bool> model;
+    switch (find_model(*this, true, model)) {
+        case Query::MALFORMED:
+            return std::nullopt;
+        case Query::NO_MODEL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::optional<std::vector<bool>> Sentence::counterexample() const
+{
+    std::vector<bool> model;
+    if (find_model(*this, true, model) != Query::MODEL) {
+        return std::nullopt;
+    }
+    return model;
+}
+
+std::optional<Sentence> Sentence::partial_evaluate(const std::unordered_map<std::string, bool>& known) const
 {
     if (data_ == nullptr) {
         return std::nullopt;
     }
-    return std::visit(TruthVisitor{}, *data_);
+
+    std::vector<std::optional<bool>> values(symbol_names_.size());
+    for (const auto& [name, value] : known) {
+        if (auto id = symbol_id(name)) {
+            values[*id] = value;
+        }
+    }
+
+    const auto t = std::make_shared<sentence_t>(true);
+    const auto f = std::make_shared<sentence_t>(false);
+    auto constant = [](const sentence_ptr_t& s) -> std::optional<bool> {
+        if (s->index() == INDEX_BOOL) {
+            return std::get<bool>(*s);
+        }
+        return std::nullopt;
+    };
+    auto negate = [&](const sentence_ptr_t& s) -> sentence_ptr_t {
+        if (auto c = constant(s)) {
+            return *c ? f : t;
+        }
+        if (s->index() == INDEX_NOT) {
+            return std::get<Not>(*s).right;
+        }
+        return std::make_shared<sentence_t>(Not(s));
+    };
+
+    // Residual of every node by address, so a shared subtree is reduced once and stays shared.
+    // A node is pushed again once its children are done, expanded marks the second visit.
+    std::unordered_map<const sentence_t*, sentence_ptr_t> done;
+    std::vector<std::pair<const sentence_ptr_t*, bool>> stack{{&data_, false}};
+
+    while (!stack.empty()) {
+        const auto [ptr, expanded] = stack.back();
+        const sentence_t* s = ptr->get();
+        if (s == nullptr || s->index() == INDEX_MONOSTATE) {
+            return std::nullopt;
+        }
+        if (done.contains(s)) {
+            stack.pop_back();
+            continue;
+        }
+
+        if (!expanded && s->index() >= INDEX_NOT) {
+            stack.back().second = true;
+            std::visit([&stack](const auto& n) {
+                if constexpr (requires { n.left; }) {
+                    stack.emplace_back(&n.left, false);
+                }
+                if constexpr (requires { n.right; }) {
+                    stack.emplace_back(&n.right, false);
+                }
+            }, *s);
+            continue;
+        }
+        stack.pop_back();
+
+        sentence_ptr_t result = *ptr;
+        switch (s->index()) {
+            case INDEX_SYMBOL: {
+                auto id = symbol_slot(std::get<Symbol>(*s));
+                if (!id) {
+                    return std::nullopt;
+                }
+                if (values[*id]) {
+                    result = *values[*id] ? t : f;
+                }
+                break;
+            }
+            case INDEX_NOT: {
+                const auto& right = done.at(std::get<Not>(*s).right.get());
+                if (right != std::get<Not>(*s).right) {
+                    result = negate(right);
+                }
+                break;
+            }
+            default:
+                std::visit([&](const auto& n) {
+                    using T = std::decay_t<decltype(n)>;
+                    if constexpr (requires { n.left; n.right; }) {
+                        const auto& l = done.at(n.left.get());
+                        const auto& r = done.at(n.right.get());
+                        const auto cl = constant(l);
+                        const auto cr = constant(r);
+                        if constexpr (std::is_same_v<T, And>) {
+                            if (cl == false || cr == false) result = f;
+                            else if (cl == true) result = r;
+                            else if (cr == true) result = l;
+                        } else if constexpr (std::is_same_v<T, Or>) {
+                            if (cl == true || cr == true) result = t;
+                            else if (cl == false) result = r;
+                            else if (cr == false) result = l;
+                        } else if constexpr (std::is_same_v<T, Imp>) {
+                            if (cl == false || cr == true) result = t;
+                            else if (cl == true) result = r;
+                            else if (cr == false) result = negate(l);
+                        } else {
+                            if (cl) result = *cl ? r : negate(r);
+                            else if (cr) result = *cr ? l : negate(l);
+                        }
+                        // neither side is decided, rebuild only if something below changed
+                        if (result == *ptr && (l != n.left || r != n.right)) {
+                            result = std::make_shared<sentence_t>(T(l, r));
+                        }
+                    }
+                }, *s);
+                break;
+        }
+        done.emplace(s, std::move(result));
+    }
+    PIMPL_STATS_ADD(NODES_VISITED, done.size());
+
+    // collect the symbols that survived
+    const auto root = done.at(data_.get());
+    std::unordered_map<std::string, sentence_ptr_t> symbols;
+    std::vector<const sentence_t*> walk{root.get()};
+    std::unordered_set<const sentence_t*> seen;
+    while (!walk.empty()) {
+        const sentence_t* s = walk.back();
+        walk.pop_back();
+        if (!seen.insert(s).second) {
+            continue;
+        }
+        std::visit([&](const auto& n) {
+            using T = std::decay_t<decltype(n)>;
+            if constexpr (std::is_same_v<T, Symbol>) {
+                const auto& name = symbol_names_[*symbol_slot(n)];
+                symbols.emplace(name, symbols_.at(name));
+            }
+            if constexpr (requires { n.left; }) {
+                walk.push_back(n.left.get());
+            }
+            if constexpr (requires { n.right; }) {
+                walk.push_back(n.right.get());
+            }
+        }, *s);
+    }
+
+    return Sentence(root, std::move(symbols));
 }
 
 }   // namespace pimpl
@@ -338,4 +880,403 @@ TEST_CASE("evaluate()")
         symbol_values.insert({"bar", true});
         REQUIRE(sentence.evaluate(symbol_values) == true);
     }
+
+    SUBCASE("repeated symbol") {
+        auto foo = std::make_shared<s_t>("foo");
+        data = std::make_shared<s_t>(Sentence::Or(
+            std::make_shared<s_t>(Sentence::Not(std::make_shared<s_t>("foo"))),
+            foo
+        ));
+        symbols.insert({"foo", foo});
+        Sentence sentence(data, symbols);
+        symbol_values.insert({"foo", false});
+        REQUIRE(sentence.evaluate(symbol_values) == true);
+        symbol_values["foo"] = true;
+        REQUIRE(sentence.evaluate(symbol_values) == true);
+    }
+
+    SUBCASE("does not modify the sentence") {
+        data = std::make_shared<s_t>(Sentence::And(
+            std::make_shared<s_t>("foo"),
+            std::make_shared<s_t>("bar")
+        ));
+        symbols.insert({"foo", std::get<Sentence::And>(*data).left});
+        symbols.insert({"bar", std::get<Sentence::And>(*data).right});
+        auto copy = *data;
+        const Sentence sentence(data, symbols);
+        symbol_values.insert({"foo", true});
+        symbol_values.insert({"bar", false});
+        REQUIRE(sentence.evaluate(symbol_values) == false);
+        REQUIRE(*data == copy);
+    }
+}
+
+TEST_CASE("evaluate_batch()")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+
+    // (a | b) <=> ~c
+    auto a = std::make_shared<s_t>("a");
+    auto b = std::make_shared<s_t>("b");
+    auto c = std::make_shared<s_t>("c");
+    auto data = std::make_shared<s_t>(Sentence::Iff(
+        std::make_shared<s_t>(Sentence::Or(a, b)),
+        std::make_shared<s_t>(Sentence::Not(c))
+    ));
+    const Sentence sentence(data, {{"a", a}, {"b", b}, {"c", c}});
+
+    const size_t rows = 10000;
+    std::unique_ptr<bool[]> assignments(new bool[rows * 3]);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < 3; ++col) {
+            assignments[row * 3 + col] = (row * 7 + col * 13) % 5 < 2;
+        }
+    }
+    std::span<const bool> matrix(assignments.get(), rows * 3);
+
+    std::unique_ptr<bool[]> expected(new bool[rows]);
+    for (size_t row = 0; row < rows; ++row) {
+        expected[row] = sentence.evaluate_ids(matrix.subspan(row * 3, 3)).value();
+    }
+
+    SUBCASE("single thread") {
+        std::unique_ptr<bool[]> results(new bool[rows]);
+        REQUIRE(sentence.evaluate_batch(matrix, std::span<bool>(results.get(), rows)));
+        CHECK(std::equal(results.get(), results.get() + rows, expected.get()));
+    }
+
+    SUBCASE("thread pool") {
+        ThreadPool pool(4);
+        std::unique_ptr<bool[]> results(new bool[rows]);
+        REQUIRE(sentence.evaluate_batch(matrix, std::span<bool>(results.get(), rows), &pool));
+        CHECK(std::equal(results.get(), results.get() + rows, expected.get()));
+    }
+
+    SUBCASE("mismatched sizes") {
+        std::unique_ptr<bool[]> results(new bool[rows]);
+        CHECK(!sentence.evaluate_batch(matrix.first(rows * 3 - 1), std::span<bool>(results.get(), rows)));
+        CHECK(!Sentence().evaluate_batch({}, {}));
+    }
+}
+
+TEST_CASE("evaluate() by symbol id")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+
+    auto b = std::make_shared<s_t>("b");
+    auto a = std::make_shared<s_t>("a");
+    auto data = std::make_shared<s_t>(Sentence::Imp(a, b));
+    const Sentence sentence(data, {{"b", b}, {"a", a}});
+
+    REQUIRE(sentence.symbol_names() == std::vector<std::string>{"a", "b"});
+    CHECK(sentence.symbol_id("a") == 0u);
+    CHECK(sentence.symbol_id("b") == 1u);
+    CHECK(sentence.symbol_id("c") == std::nullopt);
+
+    const bool tf[] = {true, false};
+    const bool ft[] = {false, true};
+    CHECK(sentence.evaluate_ids(tf) == false);
+    CHECK(sentence.evaluate_ids(ft) == true);
+    CHECK(sentence.evaluate_ids(std::span<const bool>(tf, 1)) == std::nullopt);
+    CHECK(Sentence().evaluate_ids(std::span<const bool>()) == std::nullopt);
+
+    // an empty brace list is still an empty map
+    CHECK(Sentence(std::make_shared<s_t>(true), {}).evaluate({}) == true);
+    CHECK(sentence.evaluate({}) == std::nullopt);
+}
+
+TEST_CASE("deep sentences")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+
+    constexpr int DEPTH = 200000;
+    auto a = std::make_shared<s_t>("a");
+    auto b = std::make_shared<s_t>("b");
+
+    // (((a & b) & b) & b)... and ~~~...a, both far deeper than the native stack allows
+    auto chain = [&](bool flip) {
+        auto data = a;
+        for (int i = 0; i < DEPTH; ++i) {
+            data = std::make_shared<s_t>(Sentence::And(data, flip && i == DEPTH / 2 ? a : b));
+        }
+        return Sentence(data, {{"a", a}, {"b", b}});
+    };
+    auto nots = a;
+    for (int i = 0; i < DEPTH; ++i) {
+        nots = std::make_shared<s_t>(Sentence::Not(nots));
+    }
+
+    const Sentence sentence = chain(false);
+    CHECK(sentence.evaluate(std::unordered_map<std::string, bool>{{"a", true}, {"b", true}}) == true);
+    CHECK(sentence.evaluate(std::unordered_map<std::string, bool>{{"a", false}, {"b", true}}) == false);
+    CHECK(Sentence(nots, {{"a", a}}).evaluate(std::unordered_map<std::string, bool>{{"a", true}}) == true);
+
+    CHECK(*sentence.data() == *chain(false).data());
+    CHECK(!(*sentence.data() == *chain(true).data()));
+
+    // shared subtrees survive the teardown of one of their parents
+    auto shared = std::get<Sentence::And>(*sentence.data()).left;
+    { Sentence copy = chain(false); }
+    nots.reset();
+    CHECK(std::holds_alternative<Sentence::And>(*shared));
+}
+
+TEST_CASE("structural hash and equality")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+    using ptr_t = Sentence::sentence_ptr_t;
+
+    // a & ~b, built twice from separate leaves
+    auto build = [](const char* left, const char* right) {
+        auto l = std::make_shared<s_t>(left);
+        auto r = std::make_shared<s_t>(right);
+        return Sentence(std::make_shared<s_t>(Sentence::And(l, std::make_shared<s_t>(Sentence::Not(r)))),
+                        {{left, l}, {right, r}});
+    };
+    const Sentence x = build("a", "b");
+    const Sentence y = build("a", "b");
+    const Sentence swapped = build("b", "a");
+
+    CHECK(x.data() != y.data());
+    CHECK(x == y);
+    CHECK(x.hash() == y.hash());
+    CHECK(std::hash<Sentence>{}(x) == x.hash());
+    CHECK(Sentence::tree_size(*x.data()) == 4);
+    CHECK(!(x == swapped));
+    CHECK(x.hash() != swapped.hash());
+    CHECK(Sentence() == Sentence());
+    CHECK(!(x == Sentence()));
+
+    // operands are ordered, and leaves and constants hash apart
+    auto a = std::make_shared<s_t>("a");
+    auto b = std::make_shared<s_t>("b");
+    CHECK(Sentence::tree_hash(s_t(Sentence::Or(a, b))) != Sentence::tree_hash(s_t(Sentence::Or(b, a))));
+    CHECK(Sentence::tree_hash(s_t(Sentence::Or(a, b))) != Sentence::tree_hash(s_t(Sentence::And(a, b))));
+    CHECK(Sentence::tree_hash(s_t(true)) != Sentence::tree_hash(s_t(false)));
+    CHECK(Sentence::tree_hash(s_t("a")) == Sentence::tree_hash(*a));
+
+    std::unordered_set<Sentence> unique{x, y, swapped, build("a", "b")};
+    CHECK(unique.size() == 2);
+
+    // x_{i+1} = x_i & x_i is a tree of 2^(i+1) - 1 nodes, whose size saturates,
+    // and which an unshared copy with another leaf tells apart at the root
+    auto doubling = [](const char* leaf) {
+        ptr_t data = std::make_shared<s_t>(leaf);
+        for (int i = 0; i < 100; ++i) {
+            data = std::make_shared<s_t>(Sentence::And(data, data));
+        }
+        return data;
+    };
+    auto deep_a = doubling("a");
+    auto deep_b = doubling("b");
+    CHECK(Sentence::tree_size(*deep_a) == UINT64_MAX);
+    CHECK(*deep_a == *deep_a);
+    CHECK(!(*deep_a == *deep_b));
+}
+
+TEST_CASE("interned symbol leaves")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+
+    auto b = std::make_shared<s_t>("b");
+    auto a = std::make_shared<s_t>(Sentence::Symbol("a"));
+    const auto& leaf = std::get<Sentence::INDEX_SYMBOL>(*a);
+    CHECK(leaf == Sentence::Symbol(std::string("a")));
+    CHECK(leaf.name() == "a");
+    CHECK(SymbolTable::global().find("a") == leaf.id);
+
+    // sentence ids follow names, global ids follow first use
+    const Sentence sentence(std::make_shared<s_t>(Sentence::And(a, b)), {{"a", a}, {"b", b}});
+    const auto id_a = SymbolTable::global().intern("a");
+    const auto id_b = SymbolTable::global().intern("b");
+    CHECK(sentence.symbol_ids() == std::vector<SymbolTable::symbol_id_t>{id_a, id_b});
+    CHECK(sentence.symbol_slot(Sentence::Symbol(id_b)) == 1u);
+    CHECK(sentence.symbol_slot(Sentence::Symbol("interned symbol leaves c")) == std::nullopt);
+
+    // a leaf whose name is missing from the symbol map can't be evaluated
+    auto c = std::make_shared<s_t>("c");
+    const Sentence missing(std::make_shared<s_t>(Sentence::Or(a, c)), {{"a", a}});
+    const bool f[] = {false};
+    CHECK(missing.evaluate_ids(f) == std::nullopt);
+}
+
+TEST_CASE("satisfiable() / valid()")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+
+    auto a = std::make_shared<s_t>("a");
+    auto b = std::make_shared<s_t>("b");
+    auto not_a = std::make_shared<s_t>(Sentence::Not(a));
+
+    auto check_model = [](const Sentence& sentence, const std::optional<std::vector<bool>>& model, bool expected) {
+        REQUIRE(model);
+        REQUIRE(model->size() == sentence.symbol_names().size());
+        const std::unique_ptr<bool[]> values(new bool[model->size()]);
+        std::ranges::copy(*model, values.get());
+        CHECK(sentence.evaluate_ids(std::span<const bool>(values.get(), model->size())) == expected);
+    };
+
+    SUBCASE("contingent") {
+        // a => b
+        const Sentence sentence(std::make_shared<s_t>(Sentence::Imp(a, b)), {{"a", a}, {"b", b}});
+        check_model(sentence, sentence.satisfiable(), true);
+        check_model(sentence, sentence.counterexample(), false);
+        CHECK(sentence.valid() == false);
+    }
+
+    SUBCASE("contradiction") {
+        const Sentence sentence(std::make_shared<s_t>(Sentence::And(a, not_a)), {{"a", a}});
+        CHECK(sentence.satisfiable() == std::nullopt);
+        check_model(sentence, sentence.counterexample(), false);
+        CHECK(sentence.valid() == false);
+    }
+
+    SUBCASE("tautology") {
+        const Sentence sentence(std::make_shared<s_t>(Sentence::Or(a, not_a)), {{"a", a}});
+        check_model(sentence, sentence.satisfiable(), true);
+        CHECK(sentence.counterexample() == std::nullopt);
+        CHECK(sentence.valid() == true);
+    }
+
+    SUBCASE("constants") {
+        const Sentence t(std::make_shared<s_t>(true), {});
+        const Sentence f(std::make_shared<s_t>(false), {});
+        CHECK(t.satisfiable() == std::vector<bool>{});
+        CHECK(t.valid() == true);
+        CHECK(f.satisfiable() == std::nullopt);
+        CHECK(f.valid() == false);
+    }
+
+    SUBCASE("malformed") {
+        CHECK(Sentence().satisfiable() == std::nullopt);
+        CHECK(Sentence().valid() == std::nullopt);
+        const Sentence missing(std::make_shared<s_t>(Sentence::And(a, b)), {{"a", a}});
+        CHECK(missing.valid() == std::nullopt);
+    }
+
+    SUBCASE("200 symbols") {
+        // x0 => x1 => ... => x199 is valid, the chain with ~x199 appended is not
+        std::unordered_map<std::string, Sentence::sentence_ptr_t> symbols;
+        Sentence::sentence_ptr_t chain = std::make_shared<s_t>(true);
+        Sentence::sentence_ptr_t prev;
+        for (int i = 0; i < 200; ++i) {
+            auto x = std::make_shared<s_t>("x" + std::to_string(i));
+            symbols.insert({"x" + std::to_string(i), x});
+            if (prev) {
+                chain = std::make_shared<s_t>(Sentence::And(chain, std::make_shared<s_t>(Sentence::Imp(prev, x))));
+            }
+            prev = x;
+        }
+        auto first = symbols.at("x0");
+        const Sentence valid(std::make_shared<s_t>(Sentence::Imp(std::make_shared<s_t>(Sentence::And(chain, first)), prev)),
+                             symbols);
+        CHECK(valid.valid() == true);
+
+        const Sentence contingent(std::make_shared<s_t>(Sentence::Imp(chain, prev)), symbols);
+        CHECK(contingent.valid() == false);
+        check_model(contingent, contingent.counterexample(), false);
+    }
+}
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <random>
+
+#include "random_sentence.hpp"
+
+TEST_CASE("partial_evaluate()")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+    using map_t = std::unordered_map<std::string, bool>;
+
+    auto a = std::make_shared<s_t>("a");
+    auto b = std::make_shared<s_t>("b");
+    auto c = std::make_shared<s_t>("c");
+    auto a_and_b = std::make_shared<s_t>(Sentence::And(a, b));
+    // (a & b) | c
+    const Sentence sentence(std::make_shared<s_t>(Sentence::Or(a_and_b, c)), {{"a", a}, {"b", b}, {"c", c}});
+
+    SUBCASE("nothing known shares the whole tree") {
+        auto residual = sentence.partial_evaluate({});
+        REQUIRE(residual);
+        CHECK(residual->data() == sentence.data());
+        CHECK(residual->symbol_names() == sentence.symbol_names());
+    }
+
+    SUBCASE("a false leaves c") {
+        auto residual = sentence.partial_evaluate({{"a", false}});
+        REQUIRE(residual);
+        CHECK(residual->data() == c);
+        CHECK(residual->symbol_names() == std::vector<std::string>{"c"});
+    }
+
+    SUBCASE("a true leaves b | c") {
+        auto residual = sentence.partial_evaluate({{"a", true}, {"unrelated", true}});
+        REQUIRE(residual);
+        REQUIRE(std::holds_alternative<Sentence::Or>(*residual->data()));
+        CHECK(std::get<Sentence::Or>(*residual->data()).left == b);
+        CHECK(std::get<Sentence::Or>(*residual->data()).right == c);
+        CHECK(residual->evaluate(map_t{{"b", false}, {"c", false}}) == false);
+    }
+
+    SUBCASE("c true decides the sentence") {
+        auto residual = sentence.partial_evaluate({{"c", true}});
+        REQUIRE(residual);
+        CHECK(residual->truth() == true);
+        CHECK(residual->symbol_names().empty());
+    }
+
+    SUBCASE("malformed") {
+        CHECK(Sentence().partial_evaluate({}) == std::nullopt);
+        const Sentence missing(a_and_b, {{"a", a}});
+        CHECK(missing.partial_evaluate({{"a", true}}) == std::nullopt);
+    }
+
+    SUBCASE("agrees with evaluate() on every completion") {
+        std::mt19937 rng(17);
+        constexpr size_t SYMBOLS = 6;
+        auto symbols = test::random_symbols(SYMBOLS);
+        std::vector<Sentence::sentence_ptr_t> pool{std::make_shared<s_t>(false)};
+        pool.insert(pool.end(), symbols.leaves.begin(), symbols.leaves.end());
+        const Sentence random(test::grow_random(rng, pool, 40), symbols.table);
+
+        for (int trial = 0; trial < 50; ++trial) {
+            const unsigned known_mask = rng() % (1u << SYMBOLS);
+            const unsigned known_bits = rng() % (1u << SYMBOLS);
+            map_t known;
+            for (size_t i = 0; i < SYMBOLS; ++i) {
+                if (known_mask & (1u << i)) {
+                    known["s" + std::to_string(i)] = known_bits & (1u << i);
+                }
+            }
+            auto residual = random.partial_evaluate(known);
+            REQUIRE(residual);
+
+            for (unsigned bits = 0; bits < (1u << SYMBOLS); ++bits) {
+                if ((bits & known_mask) != (known_bits & known_mask)) {
+                    continue;
+                }
+                map_t full;
+                map_t rest;
+                for (size_t i = 0; i < SYMBOLS; ++i) {
+                    full["s" + std::to_string(i)] = bits & (1u << i);
+                }
+                for (const auto& name : residual->symbol_names()) {
+                    CHECK(!known.contains(name));
+                    rest[name] = full[name];
+                }
+                const auto expected = random.evaluate(full);
+                CHECK(expected.has_value());
+                CHECK(residual->evaluate(rest) == expected);
+            }
+        }
+    }
 }
+
+#endif  // PIMPL_ENABLE_TESTS
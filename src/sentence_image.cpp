@@ -0,0 +1,552 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/sentence_image.hpp"
+
+namespace pimpl
+{
+
+namespace
+{
+
+constexpr char MAGIC[8] = {'P', 'I', 'M', 'P', 'L', 'S', 'E', 'N'};
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t node_count;
+    uint32_t symbol_count;
+    uint32_t root_count;
+    uint32_t padding;
+    uint64_t nodes_offset;
+    uint64_t names_offset;
+    uint64_t roots_offset;
+    uint64_t size;
+};
+
+static_assert(sizeof(Header) == 64);
+static_assert(sizeof(SentenceImage::BinaryNode) == 12);
+
+size_t align8(size_t n)
+{
+    return (n + 7) & ~size_t(7);
+}
+
+template <typename T>
+void put(std::vector<char>& out, size_t offset, const T* data, size_t count)
+{
+    // empty sections may come from empty vectors, whose data() can be nullptr
+    if (count != 0) {
+        std::memcpy(out.data() + offset, data, count * sizeof(T));
+    }
+}
+
+}   // namespace
+
+std::optional<std::vector<char>> SentenceImage::serialize(const NodeStore& store,
+                                                          std::span<const NodeStore::node_id_t> roots)
+{
+    using Kind = NodeStore::Kind;
+
+    // keep the nodes reachable from any root, renumbered in their original (topological) order
+    NodeStore::node_id_t top = 0;
+    for (auto root : roots) {
+        if (root >= store.size()) {
+            return std::nullopt;
+        }
+        top = std::max(top, root + 1);
+    }
+    std::vector<bool> reachable(top, false);
+    for (auto root : roots) {
+        reachable[root] = true;
+    }
+    for (NodeStore::node_id_t id = top; id-- > 0; ) {
+        if (!reachable[id]) {
+            continue;
+        }
+        const auto& n = store[id];
+        if (n.kind == Kind::NOT) {
+            reachable[n.left] = true;
+        } else if (NodeStore::is_binary(n.kind)) {
+            reachable[n.left] = true;
+            reachable[n.right] = true;
+        }
+    }
+
+    std::vector<NodeStore::node_id_t> renumber(top, NodeStore::INVALID);
+    std::vector<BinaryNode> nodes;
+    for (NodeStore::node_id_t id = 0; id < top; ++id) {
+        if (!reachable[id]) {
+            continue;
+        }
+        const auto& n = store[id];
+        BinaryNode node{uint8_t(n.kind), {}, n.left, n.right};
+        if (n.kind == Kind::NOT || NodeStore::is_binary(n.kind)) {
+            node.left = renumber[n.left];
+        }
+        if (NodeStore::is_binary(n.kind)) {
+            node.right = renumber[n.right];
+        }
+        renumber[id] = nodes.size();
+        nodes.push_back(node);
+    }
+
+    std::vector<uint32_t> name_offsets{0};
+    std::string names;
+    for (NodeStore::symbol_id_t s = 0; s < store.symbol_count(); ++s) {
+        names += store.symbol_name(s);
+        name_offsets.push_back(names.size());
+    }
+
+    std::vector<uint32_t> root_ids;
+    for (auto root : roots) {
+        root_ids.push_back(renumber[root]);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.node_count = nodes.size();
+    header.symbol_count = store.symbol_count();
+    header.root_count = root_ids.size();
+    header.nodes_offset = sizeof(Header);
+    header.names_offset = align8(header.nodes_offset + nodes.size() * sizeof(BinaryNode));
+    header.roots_offset = align8(header.names_offset + name_offsets.size() * sizeof(uint32_t) + names.size());
+    header.size = align8(header.roots_offset + root_ids.size() * sizeof(uint32_t));
+
+    std::vector<char> out(header.size, 0);
+    put(out, 0, &header, 1);
+    put(out, header.nodes_offset, nodes.data(), nodes.size());
+    put(out, header.names_offset, name_offsets.data(), name_offsets.size());
+    put(out, header.names_offset + name_offsets.size() * sizeof(uint32_t), names.data(), names.size());
+    put(out, header.roots_offset, root_ids.data(), root_ids.size());
+    return out;
+}
+
+std::optional<std::vector<char>> SentenceImage::serialize(std::span<const Sentence> sentences)
+{
+    std::vector<std::string> names;
+    for (const auto& sentence : sentences) {
+        names.insert(names.end(), sentence.symbol_names().begin(), sentence.symbol_names().end());
+    }
+    std::ranges::sort(names);
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    NodeStore store;
+    for (const auto& name : names) {
+        store.intern(name);
+    }
+    std::vector<NodeStore::node_id_t> roots;
+    for (const auto& sentence : sentences) {
+        auto root = store.add(sentence);
+        if (!root) {
+            return std::nullopt;
+        }
+        roots.push_back(*root);
+    }
+
+    return serialize(store, roots);
+}
+
+bool SentenceImage::write(const std::string& path, std::span<const char> image)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(image.data(), image.size());
+    return bool(file);
+}
+
+std::optional<SentenceImage> SentenceImage::open(const std::string& path)
+{
+    auto file = MappedFile::open(path);
+    if (!file) {
+        return std::nullopt;
+    }
+    auto image = view(std::span(file->text().data(), file->size()));
+    if (image) {
+        // the mapping doesn't move with the MappedFile, so the spans stay valid
+        image->file_ = std::move(file);
+    }
+    return image;
+}
+
+std::optional<SentenceImage> SentenceImage::view(std::span<const char> bytes)
+{
+    Header header;
+    if (bytes.size() < sizeof(Header) || reinterpret_cast<uintptr_t>(bytes.data()) % 8 != 0) {
+        return std::nullopt;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || header.byte_order != BYTE_ORDER_MARK || header.size != bytes.size()) {
+        return std::nullopt;
+    }
+
+    // every section has to lie inside the image, in order
+    // The header is untrusted, so offsets are bounded by the size before any arithmetic on them
+    // and counts are compared by division, which can't wrap around
+    const uint64_t size = bytes.size();
+    auto fits = [size](uint64_t offset, uint64_t count, uint64_t elem_size) {
+        return offset <= size && count <= (size - offset) / elem_size;
+    };
+    if (header.nodes_offset != sizeof(Header) || header.names_offset % 8 != 0 || header.roots_offset % 8 != 0
+        || !fits(header.nodes_offset, header.node_count, sizeof(BinaryNode))
+        || !fits(header.names_offset, uint64_t(header.symbol_count) + 1, sizeof(uint32_t))
+        || !fits(header.roots_offset, header.root_count, sizeof(uint32_t))) {
+        return std::nullopt;
+    }
+    const uint64_t nodes_end = header.nodes_offset + uint64_t(header.node_count) * sizeof(BinaryNode);
+    const uint64_t offsets_end = header.names_offset + (uint64_t(header.symbol_count) + 1) * sizeof(uint32_t);
+    if (nodes_end > header.names_offset || offsets_end > header.roots_offset) {
+        return std::nullopt;
+    }
+
+    SentenceImage image;
+    image.nodes_ = {reinterpret_cast<const BinaryNode*>(bytes.data() + header.nodes_offset), header.node_count};
+    image.name_offsets_ = {reinterpret_cast<const uint32_t*>(bytes.data() + header.names_offset),
+                           header.symbol_count + size_t(1)};
+    image.names_ = bytes.data() + offsets_end;
+    image.roots_ = {reinterpret_cast<const uint32_t*>(bytes.data() + header.roots_offset), header.root_count};
+
+    for (size_t i = 0; i < header.symbol_count; ++i) {
+        if (image.name_offsets_[i] > image.name_offsets_[i + 1]) {
+            return std::nullopt;
+        }
+    }
+    if (image.name_offsets_[0] != 0 || image.name_offsets_.back() > header.roots_offset - offsets_end) {
+        return std::nullopt;
+    }
+
+    using Kind = NodeStore::Kind;
+    for (uint32_t id = 0; id < header.node_count; ++id) {
+        const auto& n = image.nodes_[id];
+        bool ok = false;
+        switch (Kind(n.kind)) {
+            case Kind::SYMBOL:
+                ok = n.left < header.symbol_count;
+                break;
+            case Kind::BOOL:
+                ok = n.left <= 1;
+                break;
+            case Kind::NOT:
+                ok = n.left < id;
+                break;
+            case Kind::AND:
+            case Kind::OR:
+            case Kind::IMP:
+            case Kind::IFF:
+                ok = n.left < id && n.right < id;
+                break;
+        }
+        if (!ok) {
+            return std::nullopt;
+        }
+    }
+    for (auto root : image.roots_) {
+        if (root >= header.node_count) {
+            return std::nullopt;
+        }
+    }
+
+    return image;
+}
+
+std::string_view SentenceImage::symbol_name(uint32_t id) const
+{
+    return {names_ + name_offsets_[id], names_ + name_offsets_[id + 1]};
+}
+
+std::optional<uint32_t> SentenceImage::find_symbol(std::string_view name) const
+{
+    for (uint32_t id = 0; id < symbol_count(); ++id) {
+        if (symbol_name(id) == name) {
+            return id;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<bool> SentenceImage::evaluate(size_t root, std::span<const bool> values) const
+{
+    using Kind = NodeStore::Kind;
+    if (root >= roots_.size() || values.size() != symbol_count()) {
+        return std::nullopt;
+    }
+
+    // stage counts the operands of the node evaluated so far, an Iff keeps its left value in it
+    struct Frame
+    {
+        uint32_t id;
+        int stage;
+    };
+    std::vector<Frame> stack{{roots_[root], 0}};
+    bool acc = false;
+
+    while (!stack.empty()) {
+        const auto [id, stage] = stack.back();
+        const auto& n = nodes_[id];
+        uint32_t next = NodeStore::INVALID;
+        stack.back().stage++;
+
+        switch (Kind(n.kind)) {
+            case Kind::SYMBOL:
+                acc = values[n.left];
+                break;
+            case Kind::BOOL:
+                acc = n.left != 0;
+                break;
+            case Kind::NOT:
+                if (stage == 0) {
+                    next = n.left;
+                } else {
+                    acc = !acc;
+                }
+                break;
+            case Kind::AND:
+                if (stage == 0 || (stage == 1 && acc)) {
+                    next = stage == 0 ? n.left : n.right;
+                }
+                break;
+            case Kind::OR:
+                if (stage == 0 || (stage == 1 && !acc)) {
+                    next = stage == 0 ? n.left : n.right;
+                }
+                break;
+            case Kind::IMP:
+                // the right side goes first, if it is true the left side doesn't matter
+                if (stage == 0 || (stage == 1 && !acc)) {
+                    next = stage == 0 ? n.right : n.left;
+                } else if (stage == 2) {
+                    acc = !acc;
+                }
+                break;
+            case Kind::IFF:
+                if (stage == 0) {
+                    next = n.left;
+                } else if (stage == 1) {
+                    stack.back().stage = 2 + acc;
+                    next = n.right;
+                } else {
+                    acc = acc == (stage == 3);
+                }
+                break;
+        }
+
+        if (next != NodeStore::INVALID) {
+            stack.push_back({next, 0});
+        } else {
+            stack.pop_back();
+        }
+    }
+
+    return acc;
+}
+
+bool SentenceImage::evaluate_all(std::span<const bool> values, std::span<bool> results) const
+{
+    if (values.size() != symbol_count() || results.size() != roots_.size()) {
+        return false;
+    }
+
+    std::vector<uint8_t> node_values(nodes_.size());
+    evaluate_nodes(nodes_, values, std::span(node_values));
+
+    for (size_t i = 0; i < roots_.size(); ++i) {
+        results[i] = node_values[roots_[i]];
+    }
+    return true;
+}
+
+Sentence SentenceImage::sentence(size_t root) const
+{
+    if (root >= roots_.size()) {
+        return Sentence();
+    }
+
+    // copy only the nodes reachable from this root, in image order so operands come first
+    const uint32_t top = roots_[root];
+    std::vector<bool> reachable(top + 1, false);
+    reachable[top] = true;
+    for (uint32_t id = top + 1; id-- > 0; ) {
+        if (!reachable[id]) {
+            continue;
+        }
+        const auto& n = nodes_[id];
+        if (NodeStore::Kind(n.kind) == NodeStore::Kind::NOT) {
+            reachable[n.left] = true;
+        } else if (NodeStore::is_binary(NodeStore::Kind(n.kind))) {
+            reachable[n.left] = true;
+            reachable[n.right] = true;
+        }
+    }
+
+    NodeStore store;
+    std::vector<NodeStore::node_id_t> renumber(top + 1, NodeStore::INVALID);
+    for (uint32_t id = 0; id <= top; ++id) {
+        if (!reachable[id]) {
+            continue;
+        }
+        const auto& n = nodes_[id];
+        switch (NodeStore::Kind(n.kind)) {
+            case NodeStore::Kind::SYMBOL:
+                renumber[id] = store.make_symbol(symbol_name(n.left));
+                break;
+            case NodeStore::Kind::BOOL:
+                renumber[id] = store.make_bool(n.left);
+                break;
+            case NodeStore::Kind::NOT:
+                renumber[id] = store.make_not(renumber[n.left]);
+                break;
+            default:
+                renumber[id] = store.make_binary(NodeStore::Kind(n.kind), renumber[n.left], renumber[n.right]);
+                break;
+        }
+    }
+    return store.sentence(renumber[top]);
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <filesystem>
+#include <random>
+
+#include "random_sentence.hpp"
+
+TEST_CASE("SentenceImage")
+{
+    using namespace pimpl;
+
+    using s_t = Sentence::sentence_t;
+
+    std::mt19937 rng(11);
+    auto symbols = test::random_symbols(4);
+    std::vector<Sentence> sentences;
+    for (int i = 0; i < 20; ++i) {
+        std::vector<Sentence::sentence_ptr_t> pool{std::make_shared<s_t>(true), std::make_shared<s_t>(false)};
+        pool.insert(pool.end(), symbols.leaves.begin(), symbols.leaves.end());
+        sentences.push_back(Sentence(test::grow_random(rng, pool, 20), symbols.table));
+    }
+
+    auto bytes = SentenceImage::serialize(sentences);
+    REQUIRE(bytes);
+    const auto path = std::filesystem::temp_directory_path() / "pimpl_sentence_image_test.bin";
+    REQUIRE(SentenceImage::write(path.string(), *bytes));
+    auto image = SentenceImage::open(path.string());
+    std::filesystem::remove(path);
+    REQUIRE(image);
+
+    SUBCASE("symbols") {
+        REQUIRE(image->symbol_count() == 4);
+        CHECK(image->symbol_name(0) == "s0");
+        CHECK(image->symbol_name(3) == "s3");
+        CHECK(image->find_symbol("s2") == 2u);
+        CHECK(image->find_symbol("e") == std::nullopt);
+    }
+
+    SUBCASE("evaluate") {
+        REQUIRE(image->root_count() == sentences.size());
+        std::vector<bool> all(sentences.size());
+        for (int bits = 0; bits < 16; ++bits) {
+            // image symbols are in name order, so are every sentence's
+            const bool values[] = {bool(bits & 1), bool(bits & 2), bool(bits & 4), bool(bits & 8)};
+            std::unique_ptr<bool[]> results(new bool[sentences.size()]);
+            REQUIRE(image->evaluate_all(values, std::span(results.get(), sentences.size())));
+            for (size_t i = 0; i < sentences.size(); ++i) {
+                CHECK(image->evaluate(i, values) == sentences[i].evaluate_ids(values));
+                CHECK(results[i] == sentences[i].evaluate_ids(values));
+            }
+        }
+        const bool short_values[] = {true};
+        CHECK(image->evaluate(0, short_values) == std::nullopt);
+        CHECK(image->evaluate(sentences.size(), std::span<const bool>()) == std::nullopt);
+    }
+
+    SUBCASE("round trip") {
+        for (size_t i = 0; i < sentences.size(); ++i) {
+            auto sentence = image->sentence(i);
+            CHECK(*sentence.data() == *sentences[i].data());
+        }
+        CHECK(image->sentence(sentences.size()).data() == nullptr);
+
+        // an early root only brings back the nodes under it
+        NodeStore store;
+        const NodeStore::node_id_t a = store.make_symbol("a");
+        const NodeStore::node_id_t big = store.make_binary(NodeStore::Kind::AND, store.make_symbol("b"),
+                                                           store.make_not(a));
+        const NodeStore::node_id_t roots[] = {a, big};
+        auto small_bytes = SentenceImage::serialize(store, roots);
+        REQUIRE(small_bytes);
+        auto small = SentenceImage::view(*small_bytes);
+        REQUIRE(small);
+        auto first = small->sentence(0);
+        CHECK(*first.data() == s_t("a"));
+        CHECK(first.symbol_names() == std::vector<std::string>{"a"});
+
+        const NodeStore::node_id_t outside[] = {a, NodeStore::node_id_t(store.size())};
+        CHECK(SentenceImage::serialize(store, outside) == std::nullopt);
+    }
+
+    SUBCASE("shared nodes are stored once") {
+        const std::vector<Sentence> twice{sentences[0], sentences[0]};
+        auto one = SentenceImage::serialize(std::span(sentences.data(), 1));
+        auto two = SentenceImage::serialize(twice);
+        REQUIRE(one);
+        REQUIRE(two);
+        auto a = SentenceImage::view(*one);
+        auto b = SentenceImage::view(*two);
+        REQUIRE(a);
+        REQUIRE(b);
+        CHECK(a->node_count() == b->node_count());
+        CHECK(b->root(0) == b->root(1));
+    }
+
+    SUBCASE("invalid images") {
+        CHECK(SentenceImage::view(std::span<const char>()) == std::nullopt);
+        CHECK(SentenceImage::open(path.string()) == std::nullopt);
+
+        auto broken = *bytes;
+        broken[0] = 'X';
+        CHECK(SentenceImage::view(broken) == std::nullopt);
+
+        broken = *bytes;
+        broken.resize(broken.size() - 8);
+        CHECK(SentenceImage::view(broken) == std::nullopt);
+
+        // a node that points forward
+        broken = *bytes;
+        SentenceImage::BinaryNode node{uint8_t(NodeStore::Kind::NOT), {}, 1000, 0};
+        std::memcpy(broken.data() + 64, &node, sizeof(node));
+        CHECK(SentenceImage::view(broken) == std::nullopt);
+
+        // section offsets whose sums wrap around, at the header fields names_offset and roots_offset
+        for (size_t field : {40, 48}) {
+            for (uint64_t forged : {UINT64_MAX - 7, UINT64_MAX - 63, uint64_t(1) << 63}) {
+                broken = *bytes;
+                std::memcpy(broken.data() + field, &forged, sizeof(forged));
+                CHECK(SentenceImage::view(broken) == std::nullopt);
+            }
+        }
+
+        CHECK(SentenceImage::serialize(std::vector<Sentence>{Sentence()}) == std::nullopt);
+    }
+
+    SUBCASE("empty set") {
+        auto empty = SentenceImage::serialize(std::vector<Sentence>{});
+        REQUIRE(empty);
+        auto view = SentenceImage::view(*empty);
+        REQUIRE(view);
+        CHECK(view->root_count() == 0);
+        CHECK(view->symbol_count() == 0);
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
@@ -0,0 +1,302 @@
+#include <utility>
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/simplify.hpp"
+
+namespace pimpl
+{
+
+namespace
+{
+
+using Kind = NodeStore::Kind;
+using node_id_t = NodeStore::node_id_t;
+
+// Rewrite rules for one node whose children are already simplified
+// Hash-consing makes structural equality an id comparison, so x & x and x & ~x are cheap to spot
+class Rules
+{
+public:
+    explicit Rules(NodeStore& store) : store_(store), true_(store.make_bool(true)), false_(store.make_bool(false)) {}
+
+    node_id_t negate(node_id_t x)
+    {
+        const auto n = store_[x];
+        if (n.kind == Kind::BOOL) {
+            return n.left ? false_ : true_;
+        }
+        if (n.kind == Kind::NOT) {
+            return n.left;
+        }
+        return store_.make_not(x);
+    }
+
+    node_id_t conj(node_id_t a, node_id_t b)
+    {
+        if (a == false_ || b == false_ || complements(a, b)) return false_;
+        if (a == true_ || a == b) return b;
+        if (b == true_) return a;
+        return store_.make_binary(Kind::AND, a, b);
+    }
+
+    node_id_t disj(node_id_t a, node_id_t b)
+    {
+        if (a == true_ || b == true_ || complements(a, b)) return true_;
+        if (a == false_ || a == b) return b;
+        if (b == false_) return a;
+        return store_.make_binary(Kind::OR, a, b);
+    }
+
+    node_id_t imp(node_id_t a, node_id_t b)
+    {
+        if (a == false_ || b == true_ || a == b) return true_;
+        // ~b => b and a => ~a both come down to their right hand side
+        if (a == true_ || complements(a, b)) return b;
+        if (b == false_) return negate(a);
+        return store_.make_binary(Kind::IMP, a, b);
+    }
+
+    node_id_t iff(node_id_t a, node_id_t b)
+    {
+        if (a == b) return true_;
+        if (complements(a, b)) return false_;
+        if (a == true_) return b;
+        if (b == true_) return a;
+        if (a == false_) return negate(b);
+        if (b == false_) return negate(a);
+        return store_.make_binary(Kind::IFF, a, b);
+    }
+
+private:
+    bool complements(node_id_t a, node_id_t b) const
+    {
+        return (store_[a].kind == Kind::NOT && store_[a].left == b)
+            || (store_[b].kind == Kind::NOT && store_[b].left == a);
+    }
+
+    NodeStore& store_;
+    node_id_t true_;
+    node_id_t false_;
+};
+
+std::vector<bool> reachable_from(const NodeStore& store, node_id_t root)
+{
+    // Children always precede their parents, so one downward sweep marks every reachable node
+    std::vector<bool> reachable(root + 1, false);
+    reachable[root] = true;
+    for (node_id_t id = root + 1; id-- > 0; ) {
+        if (!reachable[id]) {
+            continue;
+        }
+        const auto& n = store[id];
+        if (n.kind == Kind::NOT) {
+            reachable[n.left] = true;
+        } else if (NodeStore::is_binary(n.kind)) {
+            reachable[n.left] = true;
+            reachable[n.right] = true;
+        }
+    }
+    return reachable;
+}
+
+}   // namespace
+
+size_t reachable_count(const NodeStore& store, NodeStore::node_id_t root)
+{
+    if (root >= store.size()) {
+        return 0;
+    }
+    size_t count = 0;
+    for (bool r : reachable_from(store, root)) {
+        count += r;
+    }
+    return count;
+}
+
+NodeStore::node_id_t simplify(NodeStore& store, NodeStore::node_id_t root)
+{
+    if (root >= store.size()) {
+        return NodeStore::INVALID;
+    }
+
+    // memo maps every reachable node to its simplified form, children are done before parents
+    const auto reachable = reachable_from(store, root);
+    std::vector<node_id_t> memo(root + 1, NodeStore::INVALID);
+    Rules rules(store);
+
+    for (node_id_t id = 0; id <= root; ++id) {
+        if (!reachable[id]) {
+            continue;
+        }
+        // copied, the rules may grow the store
+        const auto n = store[id];
+        switch (n.kind) {
+            case Kind::SYMBOL:
+            case Kind::BOOL:
+                memo[id] = id;
+                break;
+            case Kind::NOT:
+                memo[id] = rules.negate(memo[n.left]);
+                break;
+            case Kind::AND:
+                memo[id] = rules.conj(memo[n.left], memo[n.right]);
+                break;
+            case Kind::OR:
+                memo[id] = rules.disj(memo[n.left], memo[n.right]);
+                break;
+            case Kind::IMP:
+                memo[id] = rules.imp(memo[n.left], memo[n.right]);
+                break;
+            case Kind::IFF:
+                memo[id] = rules.iff(memo[n.left], memo[n.right]);
+                break;
+        }
+    }
+
+    return memo[root];
+}
+
+std::optional<Sentence> simplify(const Sentence& sentence, SimplifyStats* stats)
+{
+    NodeStore store;
+    auto root = store.add(sentence);
+    if (!root) {
+        return std::nullopt;
+    }
+
+    const auto result = simplify(store, *root);
+    if (stats != nullptr) {
+        stats->nodes_before = reachable_count(store, *root);
+        stats->nodes_after = reachable_count(store, result);
+    }
+
+    // symbols that were simplified away keep their original leaf in the map
+    auto simplified = store.sentence(result);
+    auto symbols = simplified.symbols();
+    for (const auto& [name, leaf] : sentence.symbols()) {
+        symbols.try_emplace(name, leaf);
+    }
+    return Sentence(simplified.data(), std::move(symbols));
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <random>
+
+#include "random_sentence.hpp"
+
+namespace
+{
+
+using s_t = pimpl::Sentence::sentence_t;
+using ptr_t = pimpl::Sentence::sentence_ptr_t;
+
+ptr_t sym(const char* name) { return std::make_shared<s_t>(name); }
+ptr_t lit(bool b) { return std::make_shared<s_t>(b); }
+ptr_t neg(ptr_t r) { return std::make_shared<s_t>(pimpl::Sentence::Not(r)); }
+template <typename Op>
+ptr_t bin(ptr_t l, ptr_t r) { return std::make_shared<s_t>(Op(l, r)); }
+
+}   // namespace
+
+TEST_CASE("simplify() rules")
+{
+    using namespace pimpl;
+    using S = Sentence;
+
+    auto x = sym("x");
+    auto y = sym("y");
+    auto check = [&](ptr_t data, ptr_t expected) {
+        const Sentence sentence(data, {{"x", x}, {"y", y}});
+        auto simplified = simplify(sentence);
+        REQUIRE(simplified);
+        CHECK(*simplified->data() == *expected);
+        // symbols that disappear are kept, so ids don't move
+        CHECK(simplified->symbol_names() == sentence.symbol_names());
+    };
+
+    check(neg(lit(true)), lit(false));
+    check(neg(neg(x)), x);
+    check(neg(neg(neg(x))), neg(x));
+
+    check(bin<S::And>(x, lit(true)), x);
+    check(bin<S::And>(lit(false), x), lit(false));
+    check(bin<S::And>(x, x), x);
+    check(bin<S::And>(neg(x), x), lit(false));
+
+    check(bin<S::Or>(lit(false), x), x);
+    check(bin<S::Or>(x, lit(true)), lit(true));
+    check(bin<S::Or>(x, neg(x)), lit(true));
+
+    check(bin<S::Imp>(lit(true), x), x);
+    check(bin<S::Imp>(x, lit(false)), neg(x));
+    check(bin<S::Imp>(neg(x), lit(false)), x);
+    check(bin<S::Imp>(x, x), lit(true));
+    check(bin<S::Imp>(neg(x), x), x);
+    check(bin<S::Imp>(x, neg(x)), neg(x));
+
+    check(bin<S::Iff>(x, x), lit(true));
+    check(bin<S::Iff>(x, neg(x)), lit(false));
+    check(bin<S::Iff>(lit(false), x), neg(x));
+    check(bin<S::Iff>(x, lit(true)), x);
+
+    // rewrites cascade bottom-up
+    check(bin<S::Or>(bin<S::And>(y, lit(true)), bin<S::And>(x, neg(neg(neg(x))))), y);
+    check(bin<S::Imp>(x, y), bin<S::Imp>(x, y));
+
+    CHECK(simplify(Sentence()) == std::nullopt);
+    CHECK(simplify(Sentence(x, {})) == std::nullopt);
+}
+
+TEST_CASE("simplify() on a DAG")
+{
+    using namespace pimpl;
+
+    // every level shares one child twice, the tree has 2^64 leaves but the DAG only 65 nodes
+    auto x = sym("x");
+    auto y = sym("y");
+    auto data = x;
+    for (int i = 0; i < 64; ++i) {
+        data = bin<Sentence::And>(data, data);
+    }
+    data = bin<Sentence::Or>(data, bin<Sentence::And>(y, lit(false)));
+    SimplifyStats stats;
+    auto simplified = simplify(Sentence(data, {{"x", x}, {"y", y}}), &stats);
+    REQUIRE(simplified);
+    CHECK(std::get<Sentence::Symbol>(*simplified->data()).name() == "x");
+    CHECK(stats.nodes_before == 64 + 1 + 4);
+    CHECK(stats.nodes_after == 1);
+}
+
+TEST_CASE("simplify() keeps the meaning")
+{
+    using namespace pimpl;
+
+    // random sentences over few symbols and plenty of constants
+    std::mt19937 rng(7);
+    const std::vector<ptr_t> leaves{sym("a"), sym("b"), sym("c"), lit(true), lit(false)};
+
+    for (int round = 0; round < 200; ++round) {
+        std::vector<ptr_t> pool(leaves);
+        pimpl::test::grow_random(rng, pool, 30);
+        const Sentence sentence(pool.back(), {{"a", leaves[0]}, {"b", leaves[1]}, {"c", leaves[2]}});
+
+        SimplifyStats stats;
+        auto simplified = simplify(sentence, &stats);
+        REQUIRE(simplified);
+        CHECK(stats.nodes_after <= stats.nodes_before);
+        REQUIRE(simplified->symbol_names() == sentence.symbol_names());
+
+        for (int bits = 0; bits < 8; ++bits) {
+            const bool values[] = {bool(bits & 1), bool(bits & 2), bool(bits & 4)};
+            CHECK(simplified->evaluate_ids(values) == sentence.evaluate_ids(values));
+        }
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
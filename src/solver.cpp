@@ -0,0 +1,719 @@
+#include <algorithm>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/solver.hpp"
+
+namespace pimpl
+{
+
+namespace
+{
+
+// Luby sequence 1 1 2 1 1 2 4 1 1 2 ... scaled by y
+double luby(double y, uint64_t x)
+{
+    uint64_t size = 1;
+    uint64_t seq = 0;
+    while (size < x + 1) {
+        ++seq;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != x) {
+        size = (size - 1) >> 1;
+        --seq;
+        x = x % size;
+    }
+    double r = 1;
+    for (uint64_t i = 0; i < seq; ++i) {
+        r *= y;
+    }
+    return r;
+}
+
+constexpr double VAR_DECAY = 0.95;
+constexpr float CLAUSE_DECAY = 0.999f;
+constexpr uint64_t RESTART_UNIT = 100;
+
+}   // namespace
+
+uint32_t Solver::new_var()
+{
+    uint32_t var = assigns_.size();
+    assigns_.push_back(0);
+    level_.push_back(0);
+    reason_.push_back(NO_CLAUSE);
+    phase_.push_back(true);
+    seen_.push_back(0);
+    activity_.push_back(0.0);
+    heap_index_.push_back(-1);
+    watches_.emplace_back();
+    watches_.emplace_back();
+    heap_insert(var);
+    return var;
+}
+
+bool Solver::add_clause(std::span<const lit_t> clause)
+{
+    if (!ok_) {
+        return false;
+    }
+
+    std::vector<lit_t> lits(clause.begin(), clause.end());
+    for (auto lit : lits) {
+        while (lit_var(lit) >= num_vars()) {
+            new_var();
+        }
+    }
+
+    // drop duplicates and literals false at level 0, skip tautologies and satisfied clauses
+    std::ranges::sort(lits);
+    size_t j = 0;
+    for (size_t i = 0; i < lits.size(); ++i) {
+        if (value(lits[i]) > 0 || (i + 1 < lits.size() && lits[i + 1] == lit_not(lits[i]))) {
+            return true;
+        }
+        if (value(lits[i]) == 0 && (j == 0 || lits[j - 1] != lits[i])) {
+            lits[j++] = lits[i];
+        }
+    }
+    lits.resize(j);
+
+    if (lits.empty()) {
+        ok_ = false;
+    } else if (lits.size() == 1) {
+        enqueue(lits[0], NO_CLAUSE);
+        ok_ = propagate() == NO_CLAUSE;
+    } else {
+        cref_t c = alloc_clause(lits, false, 0);
+        clauses_.push_back(c);
+        attach(c);
+    }
+    return ok_;
+}
+
+bool Solver::add_cnf(const Cnf& cnf)
+{
+    while (num_vars() < cnf.num_vars) {
+        new_var();
+    }
+    for (size_t i = 0; i < cnf.size(); ++i) {
+        add_clause(cnf.clause(i));
+    }
+    return ok_;
+}
+
+Solver::cref_t Solver::alloc_clause(std::span<const lit_t> lits, bool learned, uint32_t lbd)
+{
+    cref_t c = arena_.size();
+    arena_.push_back(lits.size());
+    arena_.push_back((lbd << 1) | learned);
+    arena_.push_back(std::bit_cast<uint32_t>(0.0f));
+    arena_.insert(arena_.end(), lits.begin(), lits.end());
+    return c;
+}
+
+void Solver::attach(cref_t c)
+{
+    const lit_t* lits = clause_lits(c);
+    watches_[lits[0]].push_back({c, lits[1]});
+    watches_[lits[1]].push_back({c, lits[0]});
+}
+
+void Solver::enqueue(lit_t lit, cref_t reason)
+{
+    uint32_t var = lit_var(lit);
+    assigns_[var] = lit_negated(lit) ? -1 : 1;
+    level_[var] = decision_level();
+    reason_[var] = reason;
+    trail_.push_back(lit);
+}
+
+Solver::cref_t Solver::propagate()
+{
+    cref_t conflict = NO_CLAUSE;
+
+    while (qhead_ < trail_.size()) {
+        const lit_t false_lit = lit_not(trail_[qhead_++]);
+        auto& ws = watches_[false_lit];
+        ++stats_.propagations;
+
+        size_t i = 0;
+        size_t j = 0;
+        while (i < ws.size()) {
+            const Watcher w = ws[i++];
+            if (value(w.blocker) > 0) {
+                ws[j++] = w;
+                continue;
+            }
+
+            // keep the false literal in the second position
+            lit_t* lits = clause_lits(w.clause);
+            if (lits[0] == false_lit) {
+                std::swap(lits[0], lits[1]);
+            }
+            const lit_t first = lits[0];
+            const Watcher moved{w.clause, first};
+            if (first != w.blocker && value(first) > 0) {
+                ws[j++] = moved;
+                continue;
+            }
+
+            // look for a new literal to watch
+            const uint32_t size = clause_size(w.clause);
+            bool found = false;
+            for (uint32_t k = 2; k < size; ++k) {
+                if (value(lits[k]) >= 0) {
+                    std::swap(lits[1], lits[k]);
+                    watches_[lits[1]].push_back(moved);
+                    found = true;
+                    break;
+                }
+            }
+            if (found) {
+                continue;
+            }
+
+            // the clause is unit or conflicting
+            ws[j++] = moved;
+            if (value(first) < 0) {
+                conflict = w.clause;
+                qhead_ = trail_.size();
+                while (i < ws.size()) {
+                    ws[j++] = ws[i++];
+                }
+            } else {
+                enqueue(first, w.clause);
+            }
+        }
+        ws.resize(j);
+    }
+
+    return conflict;
+}
+
+void Solver::analyze(cref_t conflict, std::vector<lit_t>& learned, uint32_t& backtrack_level, uint32_t& lbd)
+{
+    learned.assign(1, NO_LIT);     // room for the asserting literal
+    int path = 0;
+    lit_t p = NO_LIT;
+    size_t index = trail_.size();
+
+    // walk the implication graph back to the first unique implication point
+    do {
+        if (arena_[conflict + 1] & 1) {
+            bump_clause(conflict);
+        }
+        const lit_t* lits = clause_lits(conflict);
+        const uint32_t size = clause_size(conflict);
+        for (uint32_t k = (p == NO_LIT ? 0 : 1); k < size; ++k) {
+            const lit_t q = lits[k];
+            const uint32_t v = lit_var(q);
+            if (!seen_[v] && level_[v] > 0) {
+                bump_var(v);
+                seen_[v] = 1;
+                if (level_[v] >= decision_level()) {
+                    ++path;
+                } else {
+                    learned.push_back(q);
+                }
+            }
+        }
+
+        while (!seen_[lit_var(trail_[--index])]) {}
+        p = trail_[index];
+        conflict = reason_[lit_var(p)];
+        seen_[lit_var(p)] = 0;
+        --path;
+    } while (path > 0);
+    learned[0] = lit_not(p);
+
+    // drop literals implied by the rest of the clause
+    analyze_clear_.assign(learned.begin(), learned.end());
+    size_t j = 1;
+    for (size_t i = 1; i < learned.size(); ++i) {
+        if (!redundant(learned[i])) {
+            learned[j++] = learned[i];
+        }
+    }
+    learned.resize(j);
+    for (auto lit : analyze_clear_) {
+        seen_[lit_var(lit)] = 0;
+    }
+
+    // the second watch goes on the literal with the highest level below the conflict
+    backtrack_level = 0;
+    if (learned.size() > 1) {
+        size_t max_i = 1;
+        for (size_t i = 2; i < learned.size(); ++i) {
+            if (level_[lit_var(learned[i])] > level_[lit_var(learned[max_i])]) {
+                max_i = i;
+            }
+        }
+        std::swap(learned[1], learned[max_i]);
+        backtrack_level = level_[lit_var(learned[1])];
+    }
+
+    // literal block distance, the number of distinct decision levels
+    std::vector<uint32_t> levels;
+    for (auto lit : learned) {
+        levels.push_back(level_[lit_var(lit)]);
+    }
+    std::ranges::sort(levels);
+    lbd = std::unique(levels.begin(), levels.end()) - levels.begin();
+}
+
+bool Solver::redundant(lit_t lit)
+{
+    const cref_t reason = reason_[lit_var(lit)];
+    if (reason == NO_CLAUSE) {
+        return false;
+    }
+    const lit_t* lits = clause_lits(reason);
+    const uint32_t size = clause_size(reason);
+    for (uint32_t k = 1; k < size; ++k) {
+        const uint32_t v = lit_var(lits[k]);
+        if (!seen_[v] && level_[v] > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Solver::cancel_until(uint32_t level)
+{
+    if (decision_level() <= level) {
+        return;
+    }
+    for (size_t i = trail_.size(); i-- > trail_lim_[level]; ) {
+        const uint32_t v = lit_var(trail_[i]);
+        phase_[v] = lit_negated(trail_[i]);
+        assigns_[v] = 0;
+        reason_[v] = NO_CLAUSE;
+        heap_insert(v);
+    }
+    trail_.resize(trail_lim_[level]);
+    trail_lim_.resize(level);
+    qhead_ = trail_.size();
+}
+
+lit_t Solver::pick_branch()
+{
+    while (!heap_.empty()) {
+        uint32_t v = heap_pop();
+        if (assigns_[v] == 0) {
+            return make_lit(v, phase_[v]);
+        }
+    }
+    return NO_LIT;
+}
+
+Solver::Search Solver::search(uint64_t conflict_budget)
+{
+    std::vector<lit_t> learned;
+    uint64_t conflicts = 0;
+
+    while (true) {
+        const cref_t conflict = propagate();
+        if (conflict != NO_CLAUSE) {
+            ++stats_.conflicts;
+            ++conflicts;
+            if (decision_level() == 0) {
+                ok_ = false;
+                return Search::UNSAT;
+            }
+
+            uint32_t backtrack_level = 0;
+            uint32_t lbd = 0;
+            analyze(conflict, learned, backtrack_level, lbd);
+            cancel_until(backtrack_level);
+
+            if (learned.size() == 1) {
+                enqueue(learned[0], NO_CLAUSE);
+            } else {
+                cref_t c = alloc_clause(learned, true, lbd);
+                learned_.push_back(c);
+                attach(c);
+                bump_clause(c);
+                enqueue(learned[0], c);
+            }
+            ++stats_.learned;
+
+            var_inc_ /= VAR_DECAY;
+            clause_inc_ /= CLAUSE_DECAY;
+            continue;
+        }
+
+        if (conflicts >= conflict_budget) {
+            cancel_until(0);
+            return Search::RESTART;
+        }
+
+        // level 0 is fully propagated here, the only place clauses can be moved safely
+        if (decision_level() == 0 && learned_.size() >= max_learned_) {
+            reduce();
+        }
+
+        lit_t next = NO_LIT;
+        while (decision_level() < assumptions_.size()) {
+            const lit_t p = assumptions_[decision_level()];
+            if (value(p) > 0) {
+                // already true, open an empty level to keep levels and assumptions aligned
+                trail_lim_.push_back(trail_.size());
+            } else if (value(p) < 0) {
+                return Search::UNSAT;
+            } else {
+                next = p;
+                break;
+            }
+        }
+
+        if (next == NO_LIT) {
+            next = pick_branch();
+            if (next == NO_LIT) {
+                return Search::SAT;
+            }
+            ++stats_.decisions;
+        }
+
+        trail_lim_.push_back(trail_.size());
+        enqueue(next, NO_CLAUSE);
+    }
+}
+
+bool Solver::solve(std::span<const lit_t> assumptions)
+{
+    model_.clear();
+    if (!ok_) {
+        return false;
+    }
+
+    assumptions_.assign(assumptions.begin(), assumptions.end());
+    for (auto lit : assumptions_) {
+        while (lit_var(lit) >= num_vars()) {
+            new_var();
+        }
+    }
+    if (max_learned_ == 0) {
+        max_learned_ = std::max<size_t>(clauses_.size() / 3, 1000);
+    }
+
+    Search result = Search::RESTART;
+    for (uint64_t restart = 0; result == Search::RESTART; ++restart) {
+        result = search(static_cast<uint64_t>(luby(2, restart) * RESTART_UNIT));
+        stats_.restarts += result == Search::RESTART;
+    }
+
+    if (result == Search::SAT) {
+        model_.resize(num_vars());
+        for (uint32_t v = 0; v < num_vars(); ++v) {
+            model_[v] = assigns_[v] > 0;
+        }
+    }
+    cancel_until(0);
+    return result == Search::SAT;
+}
+
+void Solver::reduce()
+{
+    // Level 0 assignments are permanent: drop satisfied clauses and false literals.
+    // Propagation is complete, so every remaining clause keeps at least two unassigned literals
+    auto simplify = [this](std::vector<cref_t>& list) {
+        size_t j = 0;
+        for (cref_t c : list) {
+            lit_t* lits = clause_lits(c);
+            uint32_t size = clause_size(c);
+            bool satisfied = false;
+            uint32_t k = 0;
+            for (uint32_t i = 0; i < size; ++i) {
+                satisfied |= value(lits[i]) > 0;
+                if (value(lits[i]) == 0) {
+                    lits[k++] = lits[i];
+                }
+            }
+            if (!satisfied) {
+                arena_[c] = k;
+                list[j++] = c;
+            }
+        }
+        stats_.deleted += list.size() - j;
+        list.resize(j);
+    };
+    simplify(clauses_);
+    simplify(learned_);
+
+    // keep the better half of the learned clauses, plus every clause with a small LBD
+    std::ranges::sort(learned_, [this](cref_t a, cref_t b) {
+        if (clause_lbd(a) != clause_lbd(b)) {
+            return clause_lbd(a) < clause_lbd(b);
+        }
+        return clause_activity(a) > clause_activity(b);
+    });
+    size_t keep = learned_.size() / 2;
+    while (keep < learned_.size() && clause_lbd(learned_[keep]) <= 2) {
+        ++keep;
+    }
+    stats_.deleted += learned_.size() - keep;
+    learned_.resize(keep);
+
+    // compact the arena and rebuild the watches
+    std::vector<uint32_t> arena;
+    arena.reserve(arena_.size());
+    auto move = [this, &arena](std::vector<cref_t>& list) {
+        for (cref_t& c : list) {
+            cref_t moved = arena.size();
+            arena.insert(arena.end(), arena_.begin() + c, arena_.begin() + c + HEADER + clause_size(c));
+            c = moved;
+        }
+    };
+    move(clauses_);
+    move(learned_);
+    arena_ = std::move(arena);
+
+    for (auto& ws : watches_) {
+        ws.clear();
+    }
+    for (cref_t c : clauses_) {
+        attach(c);
+    }
+    for (cref_t c : learned_) {
+        attach(c);
+    }
+    for (auto lit : trail_) {
+        reason_[lit_var(lit)] = NO_CLAUSE;
+    }
+
+    max_learned_ += max_learned_ / 10;
+}
+
+void Solver::bump_var(uint32_t var)
+{
+    if ((activity_[var] += var_inc_) > 1e100) {
+        for (auto& a : activity_) {
+            a *= 1e-100;
+        }
+        var_inc_ *= 1e-100;
+    }
+    if (heap_index_[var] >= 0) {
+        heap_up(heap_index_[var]);
+    }
+}
+
+void Solver::bump_clause(cref_t c)
+{
+    float a = clause_activity(c) + clause_inc_;
+    set_clause_activity(c, a);
+    if (a > 1e20f) {
+        for (cref_t l : learned_) {
+            set_clause_activity(l, clause_activity(l) * 1e-20f);
+        }
+        clause_inc_ *= 1e-20f;
+    }
+}
+
+void Solver::heap_insert(uint32_t var)
+{
+    if (heap_index_[var] >= 0) {
+        return;
+    }
+    heap_index_[var] = heap_.size();
+    heap_.push_back(var);
+    heap_up(heap_.size() - 1);
+}
+
+void Solver::heap_up(size_t i)
+{
+    const uint32_t var = heap_[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (activity_[heap_[parent]] >= activity_[var]) {
+            break;
+        }
+        heap_[i] = heap_[parent];
+        heap_index_[heap_[i]] = i;
+        i = parent;
+    }
+    heap_[i] = var;
+    heap_index_[var] = i;
+}
+
+void Solver::heap_down(size_t i)
+{
+    const uint32_t var = heap_[i];
+    while (2 * i + 1 < heap_.size()) {
+        size_t child = 2 * i + 1;
+        if (child + 1 < heap_.size() && activity_[heap_[child + 1]] > activity_[heap_[child]]) {
+            ++child;
+        }
+        if (activity_[heap_[child]] <= activity_[var]) {
+            break;
+        }
+        heap_[i] = heap_[child];
+        heap_index_[heap_[i]] = i;
+        i = child;
+    }
+    heap_[i] = var;
+    heap_index_[var] = i;
+}
+
+uint32_t Solver::heap_pop()
+{
+    const uint32_t top = heap_.front();
+    heap_index_[top] = -1;
+    heap_.front() = heap_.back();
+    heap_.pop_back();
+    if (!heap_.empty()) {
+        heap_index_[heap_.front()] = 0;
+        heap_down(0);
+    }
+    return top;
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <random>
+
+namespace
+{
+
+bool satisfies(const pimpl::Cnf& cnf, const std::vector<bool>& model)
+{
+    for (size_t i = 0; i < cnf.size(); ++i) {
+        bool any = false;
+        for (auto lit : cnf.clause(i)) {
+            any |= model[pimpl::lit_var(lit)] != pimpl::lit_negated(lit);
+        }
+        if (!any) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool brute_force(const pimpl::Cnf& cnf)
+{
+    std::vector<bool> model(cnf.num_vars);
+    for (uint64_t bits = 0; bits < (uint64_t(1) << cnf.num_vars); ++bits) {
+        for (uint32_t v = 0; v < cnf.num_vars; ++v) {
+            model[v] = (bits >> v) & 1;
+        }
+        if (satisfies(cnf, model)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+pimpl::Cnf random_3sat(std::mt19937& rng, uint32_t vars, uint32_t clauses)
+{
+    pimpl::Cnf cnf;
+    cnf.num_vars = vars;
+    std::uniform_int_distribution<uint32_t> lit(0, 2 * vars - 1);
+    for (uint32_t i = 0; i < clauses; ++i) {
+        cnf.add_clause({lit(rng), lit(rng), lit(rng)});
+    }
+    return cnf;
+}
+
+// n + 1 pigeons in n holes
+pimpl::Cnf pigeonhole(uint32_t n)
+{
+    using pimpl::make_lit;
+    pimpl::Cnf cnf;
+    cnf.num_vars = (n + 1) * n;
+    auto var = [n](uint32_t pigeon, uint32_t hole) { return pigeon * n + hole; };
+    for (uint32_t p = 0; p <= n; ++p) {
+        std::vector<pimpl::lit_t> some_hole;
+        for (uint32_t h = 0; h < n; ++h) {
+            some_hole.push_back(make_lit(var(p, h)));
+        }
+        cnf.add_clause(some_hole);
+    }
+    for (uint32_t h = 0; h < n; ++h) {
+        for (uint32_t p = 0; p <= n; ++p) {
+            for (uint32_t q = p + 1; q <= n; ++q) {
+                cnf.add_clause({make_lit(var(p, h), true), make_lit(var(q, h), true)});
+            }
+        }
+    }
+    return cnf;
+}
+
+}   // namespace
+
+TEST_CASE("Solver")
+{
+    using namespace pimpl;
+
+    SUBCASE("trivial") {
+        Solver solver;
+        CHECK(solver.solve());
+        CHECK(solver.add_clause({make_lit(0), make_lit(1)}));
+        CHECK(solver.add_clause({make_lit(0, true)}));
+        REQUIRE(solver.solve());
+        CHECK(solver.model() == std::vector<bool>{false, true});
+        CHECK(!solver.add_clause({make_lit(1, true)}));
+        CHECK(!solver.solve());
+        CHECK(!solver.okay());
+    }
+
+    SUBCASE("empty and tautological clauses") {
+        Solver solver;
+        CHECK(solver.add_clause({make_lit(2), make_lit(2, true)}));
+        CHECK(solver.solve());
+        CHECK(!solver.add_clause(std::span<const lit_t>()));
+    }
+
+    SUBCASE("random 3-SAT agrees with brute force") {
+        std::mt19937 rng(42);
+        for (int round = 0; round < 200; ++round) {
+            auto cnf = random_3sat(rng, 12, 40 + round % 30);
+            Solver solver(cnf);
+            bool sat = solver.solve();
+            CHECK(sat == brute_force(cnf));
+            if (sat) {
+                CHECK(satisfies(cnf, solver.model()));
+            }
+        }
+    }
+
+    SUBCASE("pigeonhole is unsatisfiable") {
+        Solver solver(pigeonhole(7));
+        CHECK(!solver.solve());
+        CHECK(solver.stats().conflicts > 0);
+    }
+
+    SUBCASE("large satisfiable instance") {
+        // under-constrained random 3-SAT with 5000 variables
+        std::mt19937 rng(7);
+        auto cnf = random_3sat(rng, 5000, 15000);
+        Solver solver(cnf);
+        REQUIRE(solver.solve());
+        CHECK(satisfies(cnf, solver.model()));
+    }
+
+    SUBCASE("assumptions") {
+        // a => b, b => c
+        Solver solver;
+        solver.add_clause({make_lit(0, true), make_lit(1)});
+        solver.add_clause({make_lit(1, true), make_lit(2)});
+
+        REQUIRE(solver.solve({make_lit(0)}));
+        CHECK(solver.model()[2]);
+        CHECK(!solver.solve({make_lit(0), make_lit(2, true)}));
+        // assumptions don't stick
+        CHECK(solver.okay());
+        REQUIRE(solver.solve({make_lit(2, true)}));
+        CHECK(!solver.model()[0]);
+
+        // clauses can be added between calls
+        solver.add_clause({make_lit(0)});
+        CHECK(!solver.solve({make_lit(2, true)}));
+        CHECK(solver.solve());
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
@@ -0,0 +1,199 @@
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/stats.hpp"
+
+namespace pimpl::stats
+{
+
+namespace
+{
+
+#ifdef PIMPL_ENABLE_STATS
+
+void accumulate(Snapshot& into, const detail::Block& block)
+{
+    for (size_t i = 0; i < COUNTERS; ++i) {
+        into.counters[i] += block.counters[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < TIMERS; ++i) {
+        into.nanoseconds[i] += block.nanoseconds[i].load(std::memory_order_relaxed);
+        into.calls[i] += block.calls[i].load(std::memory_order_relaxed);
+    }
+}
+
+// Blocks of live threads, plus everything counted by threads that already finished
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<detail::Block>> blocks;
+    Snapshot retired;
+    Snapshot base;  // totals at the last reset()
+};
+
+Registry& registry()
+{
+    static Registry r;
+    return r;
+}
+
+Snapshot totals(Registry& r)
+{
+    Snapshot s = r.retired;
+    for (const auto& block : r.blocks) {
+        accumulate(s, *block);
+    }
+    s.threads += r.blocks.size();
+    return s;
+}
+
+#endif  // PIMPL_ENABLE_STATS
+
+}   // namespace
+
+#ifdef PIMPL_ENABLE_STATS
+
+namespace detail
+{
+
+Block* register_thread()
+{
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    r.blocks.push_back(std::make_unique<Block>());
+    return r.blocks.back().get();
+}
+
+LocalBlock::~LocalBlock()
+{
+    if (block == nullptr) {
+        return;
+    }
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    accumulate(r.retired, *block);
+    ++r.retired.threads;
+    std::erase_if(r.blocks, [this](const auto& b) { return b.get() == block; });
+}
+
+}   // namespace detail
+
+Snapshot snapshot()
+{
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    Snapshot s = totals(r);
+    for (size_t i = 0; i < COUNTERS; ++i) {
+        s.counters[i] -= r.base.counters[i];
+    }
+    for (size_t i = 0; i < TIMERS; ++i) {
+        s.nanoseconds[i] -= r.base.nanoseconds[i];
+        s.calls[i] -= r.base.calls[i];
+    }
+    return s;
+}
+
+void reset()
+{
+    // blocks are only ever written by their own thread, so a reset moves the baseline instead
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    r.base = totals(r);
+    r.base.threads = 0;
+}
+
+#else
+
+Snapshot snapshot()
+{
+    return {};
+}
+
+void reset()
+{
+}
+
+#endif  // PIMPL_ENABLE_STATS
+
+const char* name(Counter c)
+{
+    switch (c) {
+        case Counter::NODES_BUILT: return "nodes_built";
+        case Counter::NODES_VISITED: return "nodes_visited";
+        case Counter::SHORT_CIRCUITS: return "short_circuits";
+        case Counter::ALLOCATIONS: return "allocations";
+        case Counter::ALLOCATED_BYTES: return "allocated_bytes";
+    }
+    return "";
+}
+
+const char* name(Timer t)
+{
+    switch (t) {
+        case Timer::PARSE: return "parse";
+        case Timer::BUILD: return "build";
+        case Timer::EVALUATE: return "evaluate";
+    }
+    return "";
+}
+
+std::ostream& operator<<(std::ostream& out, const Snapshot& snapshot)
+{
+    for (size_t i = 0; i < COUNTERS; ++i) {
+        out << name(Counter(i)) << " " << snapshot.counters[i] << "\n";
+    }
+    for (size_t i = 0; i < TIMERS; ++i) {
+        out << name(Timer(i)) << "_ns " << snapshot.nanoseconds[i] << "\n"
+            << name(Timer(i)) << "_calls " << snapshot.calls[i] << "\n";
+    }
+    return out << "threads " << snapshot.threads << "\n";
+}
+
+}   // namespace pimpl::stats
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <sstream>
+#include <thread>
+
+#include "pimpl/sentence.hpp"
+
+TEST_CASE("stats")
+{
+    using namespace pimpl;
+    using s_t = Sentence::sentence_t;
+
+    auto a = std::make_shared<s_t>("a");
+    auto b = std::make_shared<s_t>("b");
+    const Sentence sentence(std::make_shared<s_t>(Sentence::And(a, b)), {{"a", a}, {"b", b}});
+    const bool ft[] = {false, true};
+
+    stats::reset();
+    CHECK(sentence.evaluate_ids(ft) == false);
+    std::thread([&] { CHECK(sentence.evaluate_ids(ft) == false); }).join();
+    const auto s = stats::snapshot();
+
+    if constexpr (stats::enabled) {
+        // the And and its left side, twice, and the right side is never looked at
+        CHECK(s[stats::Counter::NODES_VISITED] == 4);
+        CHECK(s[stats::Counter::SHORT_CIRCUITS] == 2);
+        CHECK(s.calls[size_t(stats::Timer::EVALUATE)] == 2);
+        CHECK(s.threads >= 2);
+
+        stats::reset();
+        CHECK(stats::snapshot()[stats::Counter::NODES_VISITED] == 0);
+    } else {
+        CHECK(s[stats::Counter::NODES_VISITED] == 0);
+        CHECK(s.threads == 0);
+    }
+
+    std::ostringstream out;
+    out << s;
+    CHECK(out.str().find("short_circuits ") != std::string::npos);
+}
+
+#endif  // PIMPL_ENABLE_TESTS
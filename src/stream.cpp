@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "doctest/doctest.h"
+#include "lexy/action/parse.hpp"
+#include "lexy/input/string_input.hpp"
+
+#include "pimpl/mapped_file.hpp"
+#include "pimpl/parsing.hpp"
+#include "pimpl/stats.hpp"
+#include "pimpl/stream.hpp"
+#include "pimpl/thread_pool.hpp"
+
+namespace pimpl
+{
+
+namespace
+{
+
+// Consumed pages of a mapped file are handed back every this many bytes
+constexpr size_t RELEASE_STRIDE = size_t(64) << 20;
+
+std::string_view trim(std::string_view line)
+{
+    constexpr std::string_view blanks = " \t\r";
+    const size_t begin = line.find_first_not_of(blanks);
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    return line.substr(begin, line.find_last_not_of(blanks) - begin + 1);
+}
+
+// Call fn(line number, offset past the line, trimmed line) for every non-blank line
+// until it returns false, returns the number of lines walked
+template <typename Fn>
+size_t for_each_line(std::string_view text, Fn&& fn)
+{
+    size_t lines = 0;
+    for (size_t begin = 0; begin < text.size(); ) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        ++lines;
+        auto line = trim(text.substr(begin, end - begin));
+        begin = end + 1;
+        if (!line.empty() && !fn(lines, begin, line)) {
+            break;
+        }
+    }
+    return lines;
+}
+
+ParseSummary parse_text(std::string_view text, const LineCallback& callback, const MappedFile* file)
+{
+    ParseSummary summary;
+    size_t released = 0;
+
+    summary.lines = for_each_line(text, [&](size_t number, size_t offset, std::string_view line) {
+        auto sentence = parse_sentence(line);
+        ++(sentence ? summary.sentences : summary.errors);
+        const bool more = callback(number, std::move(sentence));
+
+        if (file != nullptr && offset - released >= RELEASE_STRIDE) {
+            file->release(offset);
+            released = offset;
+        }
+        return more;
+    });
+
+    return summary;
+}
+
+struct Chunk
+{
+    std::string_view text;
+    size_t lines = 0;
+    std::vector<std::pair<size_t, std::optional<Sentence>>> sentences;   // by line within the chunk
+};
+
+ParseSummary parse_text(std::string_view text, ThreadPool& pool, const LineCallback& callback,
+                        size_t chunk_bytes, const MappedFile* file)
+{
+    ParseSummary summary;
+    chunk_bytes = std::max<size_t>(chunk_bytes, 1);
+    const size_t batch = 4 * pool.size();
+    std::vector<Chunk> chunks;
+
+    for (size_t offset = 0; offset < text.size(); ) {
+        // cut the next batch just after a newline, so every line lands in exactly one chunk
+        chunks.clear();
+        while (chunks.size() < batch && offset < text.size()) {
+            size_t end = text.size();
+            if (text.size() - offset > chunk_bytes) {
+                end = text.find('\n', offset + chunk_bytes - 1);
+                end = end == std::string_view::npos ? text.size() : end + 1;
+            }
+            chunks.push_back({text.substr(offset, end - offset)});
+            offset = end;
+        }
+
+        pool.parallel_for(chunks.size(), 1, [&chunks](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                Chunk& chunk = chunks[i];
+                chunk.lines = for_each_line(chunk.text, [&chunk](size_t number, size_t, std::string_view line) {
+                    chunk.sentences.emplace_back(number, parse_sentence(line));
+                    return true;
+                });
+            }
+        });
+
+        // merge in order, chunk line numbers are offset by every line before the chunk
+        for (auto& chunk : chunks) {
+            for (auto& [number, sentence] : chunk.sentences) {
+                ++(sentence ? summary.sentences : summary.errors);
+                if (!callback(summary.lines + number, std::move(sentence))) {
+                    summary.lines += number;
+                    return summary;
+                }
+            }
+            summary.lines += chunk.lines;
+        }
+
+        if (file != nullptr) {
+            file->release(offset);
+        }
+    }
+
+    return summary;
+}
+
+}   // namespace
+
+std::optional<Sentence> parse_sentence(std::string_view line)
+{
+    PIMPL_STATS_TIMER(PARSE);
+    line = trim(line);
+    auto input = lexy::string_input<lexy::utf8_encoding>(line.data(), line.size());
+
+    // the callbacks build the Sentence while parsing, there is no AST to convert
+    std::unordered_map<std::string, Sentence::sentence_ptr_t> symbols;
+    grammar::SentenceState state{&symbols};
+    auto result = lexy::parse<grammar::GrammarSentenceLine>(input, state, lexy::noop);
+    if (!result.is_success()) {
+        return std::nullopt;
+    }
+    return Sentence(result.value(), std::move(symbols));
+}
+
+ParseSummary parse_lines(std::string_view text, const LineCallback& callback)
+{
+    return parse_text(text, callback, nullptr);
+}
+
+std::optional<ParseSummary> parse_file(const std::string& path, const LineCallback& callback)
+{
+    auto file = MappedFile::open(path);
+    if (!file) {
+        return std::nullopt;
+    }
+    return parse_text(file->text(), callback, &*file);
+}
+
+ParseSummary parse_lines(std::string_view text, ThreadPool& pool, const LineCallback& callback, size_t chunk_bytes)
+{
+    return parse_text(text, pool, callback, chunk_bytes, nullptr);
+}
+
+std::optional<ParseSummary> parse_file(const std::string& path, ThreadPool& pool, const LineCallback& callback,
+                                       size_t chunk_bytes)
+{
+    auto file = MappedFile::open(path);
+    if (!file) {
+        return std::nullopt;
+    }
+    return parse_text(file->text(), pool, callback, chunk_bytes, &*file);
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+TEST_CASE("parse_sentence")
+{
+    using namespace pimpl;
+
+    auto sentence = parse_sentence("  a & ~b\r");
+    REQUIRE(sentence);
+    CHECK(sentence->symbol_names() == std::vector<std::string>{"a", "b"});
+    CHECK(sentence->evaluate(std::unordered_map<std::string, bool>{{"a", true}, {"b", false}}) == true);
+
+    CHECK(parse_sentence("") == std::nullopt);
+    CHECK(parse_sentence("a &") == std::nullopt);
+    CHECK(parse_sentence("a b") == std::nullopt);
+}
+
+TEST_CASE("parse_lines")
+{
+    using namespace pimpl;
+
+    const std::string text = "a => b\n\n   \n~c\r\nd & \nT | e";
+    std::vector<size_t> lines;
+    std::vector<bool> parsed;
+    auto collect = [&](size_t line, std::optional<Sentence> sentence) {
+        lines.push_back(line);
+        parsed.push_back(sentence.has_value());
+        return true;
+    };
+
+    SUBCASE("every line") {
+        auto summary = parse_lines(text, collect);
+        CHECK(summary.lines == 6);
+        CHECK(summary.sentences == 3);
+        CHECK(summary.errors == 1);
+        CHECK(lines == std::vector<size_t>{1, 4, 5, 6});
+        CHECK(parsed == std::vector<bool>{true, true, false, true});
+    }
+
+    SUBCASE("stop early") {
+        auto summary = parse_lines(text, [&](size_t line, std::optional<Sentence> sentence) {
+            collect(line, std::move(sentence));
+            return line < 4;
+        });
+        CHECK(summary.sentences == 2);
+        CHECK(lines == std::vector<size_t>{1, 4});
+    }
+
+    SUBCASE("file") {
+        const auto path = std::filesystem::temp_directory_path() / "pimpl_parse_file_test.txt";
+        std::ofstream(path, std::ios::binary) << text;
+        auto summary = parse_file(path.string(), collect);
+        std::filesystem::remove(path);
+        REQUIRE(summary);
+        CHECK(summary->sentences == 3);
+        CHECK(lines == std::vector<size_t>{1, 4, 5, 6});
+
+        CHECK(parse_file(path.string(), collect) == std::nullopt);
+    }
+}
+
+TEST_CASE("parse_lines in parallel")
+{
+    using namespace pimpl;
+
+    // every seventh line is broken, some lines are blank
+    std::string text;
+    for (int i = 0; i < 5000; ++i) {
+        if (i % 7 == 3) {
+            text += "x" + std::to_string(i) + " &\n";
+        } else if (i % 11 == 5) {
+            text += "\r\n";
+        } else {
+            text += "x" + std::to_string(i) + " => ~(y & x" + std::to_string(i + 1) + ")\n";
+        }
+    }
+
+    using Line = std::pair<size_t, std::vector<std::string>>;
+    auto record = [](std::vector<Line>& out) {
+        return [&out](size_t line, std::optional<Sentence> sentence) {
+            out.emplace_back(line, sentence ? sentence->symbol_names() : std::vector<std::string>{});
+            return true;
+        };
+    };
+
+    std::vector<Line> expected;
+    const auto sequential = parse_lines(text, record(expected));
+
+    for (size_t threads : {1, 4}) {
+        ThreadPool pool(threads);
+        for (size_t chunk_bytes : {size_t(1), size_t(100), size_t(4096), size_t(1) << 20}) {
+            std::vector<Line> lines;
+            const auto summary = parse_lines(text, pool, record(lines), chunk_bytes);
+            CHECK(summary.lines == sequential.lines);
+            CHECK(summary.sentences == sequential.sentences);
+            CHECK(summary.errors == sequential.errors);
+            CHECK(lines == expected);
+        }
+
+        // stopping early reports the line it stopped on
+        std::vector<Line> lines;
+        const auto summary = parse_lines(text, pool, [&lines](size_t line, std::optional<Sentence>) {
+            lines.emplace_back(line, std::vector<std::string>{});
+            return line < 1000;
+        }, 256);
+        REQUIRE(!lines.empty());
+        CHECK(lines.back().first >= 1000);
+        CHECK(summary.lines == lines.back().first);
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
@@ -0,0 +1,110 @@
+#include <mutex>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/symbol_table.hpp"
+
+namespace pimpl
+{
+
+SymbolTable& SymbolTable::global()
+{
+    static SymbolTable table;
+    return table;
+}
+
+SymbolTable::symbol_id_t SymbolTable::intern(std::string_view name)
+{
+    if (auto id = find(name)) {
+        return *id;
+    }
+
+    // another thread may have added the name between the two locks
+    std::unique_lock lock(mutex_);
+    if (auto it = ids_.find(name); it != ids_.end()) {
+        return it->second;
+    }
+    symbol_id_t id = names_.size();
+    names_.emplace_back(name);
+    ids_.emplace(names_.back(), id);
+    return id;
+}
+
+std::optional<SymbolTable::symbol_id_t> SymbolTable::find(std::string_view name) const
+{
+    std::shared_lock lock(mutex_);
+    if (auto it = ids_.find(name); it != ids_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+const std::string& SymbolTable::name(symbol_id_t id) const
+{
+    std::shared_lock lock(mutex_);
+    return names_[id];
+}
+
+size_t SymbolTable::size() const
+{
+    std::shared_lock lock(mutex_);
+    return names_.size();
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <thread>
+#include <vector>
+
+TEST_CASE("SymbolTable")
+{
+    using namespace pimpl;
+
+    SUBCASE("dense ids") {
+        SymbolTable table;
+        CHECK(table.intern("a") == 0u);
+        CHECK(table.intern("b") == 1u);
+        CHECK(table.intern("a") == 0u);
+        CHECK(table.size() == 2);
+        CHECK(table.name(1) == "b");
+        CHECK(table.find("b") == 1u);
+        CHECK(table.find("c") == std::nullopt);
+
+        // names stay put while the table grows
+        const std::string& a = table.name(0);
+        for (int i = 0; i < 10000; ++i) {
+            table.intern("s" + std::to_string(i));
+        }
+        CHECK(&table.name(0) == &a);
+        CHECK(table.find("s9999") == 10001u);
+    }
+
+    SUBCASE("concurrent interning") {
+        SymbolTable table;
+        std::vector<std::vector<SymbolTable::symbol_id_t>> ids(4);
+        std::vector<std::thread> threads;
+        for (auto& out : ids) {
+            threads.emplace_back([&table, &out] {
+                for (int i = 0; i < 2000; ++i) {
+                    out.push_back(table.intern("x" + std::to_string(i)));
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        CHECK(table.size() == 2000);
+        for (const auto& out : ids) {
+            CHECK(out == ids[0]);
+        }
+        for (int i = 0; i < 2000; ++i) {
+            CHECK(table.name(ids[0][i]) == "x" + std::to_string(i));
+        }
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <utility>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/thread_pool.hpp"
+
+namespace pimpl
+{
+
+namespace
+{
+
+// Pool whose job the current thread is running, nested parallel_for() calls on it run inline
+thread_local const ThreadPool* active_pool = nullptr;
+
+}   // namespace
+
+ThreadPool::ThreadPool(size_t threads)
+{
+    threads = std::max<size_t>(threads, 1);
+    workers_.reserve(threads - 1);
+    for (size_t i = 0; i + 1 < threads; ++i) {
+        workers_.emplace_back(&ThreadPool::worker, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& w : workers_) {
+        w.join();
+    }
+}
+
+void ThreadPool::worker(size_t index)
+{
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+
+        run(index);
+
+        std::lock_guard lock(mutex_);
+        if (--running_ == 0) {
+            done_.notify_all();
+        }
+    }
+}
+
+void ThreadPool::run(size_t participant)
+{
+    const size_t participants = size();
+    auto drain = [this](Range& range) {
+        for (size_t chunk; !failed_.load(std::memory_order_relaxed)
+                           && (chunk = range.next.fetch_add(1, std::memory_order_relaxed)) < range.end; ) {
+            size_t begin = chunk * grain_;
+            (*fn_)(begin, std::min(n_, begin + grain_));
+        }
+    };
+
+    const ThreadPool* outer = std::exchange(active_pool, this);
+    try {
+        // own range first, then steal from the others
+        for (size_t i = 0; i < participants; ++i) {
+            drain(ranges_[(participant + i) % participants]);
+        }
+    } catch (...) {
+        failed_ = true;
+        std::lock_guard lock(mutex_);
+        if (!error_) {
+            error_ = std::current_exception();
+        }
+    }
+    active_pool = outer;
+}
+
+void ThreadPool::parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+    if (n == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunks = (n + grain - 1) / grain;
+    auto run_inline = [n, grain, &fn] {
+        for (size_t begin = 0; begin < n; begin += grain) {
+            fn(begin, std::min(n, begin + grain));
+        }
+    };
+
+    // every participant is busy with the outer job, and job_mutex_ may be held by this very thread
+    if (active_pool == this) {
+        run_inline();
+        return;
+    }
+
+    std::lock_guard job_lock(job_mutex_);
+
+    if (workers_.empty() || chunks == 1) {
+        const ThreadPool* outer = std::exchange(active_pool, this);
+        try {
+            run_inline();
+        } catch (...) {
+            active_pool = outer;
+            throw;
+        }
+        active_pool = outer;
+        return;
+    }
+
+    const size_t participants = size();
+    ranges_ = std::make_unique<Range[]>(participants);
+    for (size_t p = 0; p < participants; ++p) {
+        ranges_[p].next = p * chunks / participants;
+        ranges_[p].end = (p + 1) * chunks / participants;
+    }
+    fn_ = &fn;
+    n_ = n;
+    grain_ = grain;
+    failed_ = false;
+    error_ = nullptr;
+
+    {
+        std::lock_guard lock(mutex_);
+        running_ = workers_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    run(0);
+
+    // run() never throws, so fn_ stays valid until every worker is done with it
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [this] { return running_ == 0; });
+    fn_ = nullptr;
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+#include <stdexcept>
+
+TEST_CASE("ThreadPool::parallel_for")
+{
+    using namespace pimpl;
+
+    for (size_t threads : {1, 2, 5}) {
+        ThreadPool pool(threads);
+        CHECK(pool.size() == threads);
+
+        // every index exactly once
+        for (size_t n : {0, 1, 7, 1000, 12345}) {
+            std::vector<std::atomic<int>> hits(n);
+            pool.parallel_for(n, 64, [&hits](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    hits[i].fetch_add(1);
+                }
+            });
+            CHECK(std::ranges::all_of(hits, [](const auto& h) { return h.load() == 1; }));
+        }
+
+        // chunks respect the grain
+        std::atomic<size_t> largest = 0;
+        pool.parallel_for(1000, 33, [&largest](size_t begin, size_t end) {
+            size_t size = end - begin;
+            size_t seen = largest.load();
+            while (size > seen && !largest.compare_exchange_weak(seen, size)) {}
+        });
+        CHECK(largest.load() == 33);
+
+        // the pool can be reused
+        std::atomic<size_t> sum = 0;
+        for (int i = 0; i < 50; ++i) {
+            pool.parallel_for(100, 1, [&sum](size_t begin, size_t end) { sum += end - begin; });
+        }
+        CHECK(sum.load() == 5000);
+
+        // the first exception reaches the caller after every participant has stopped
+        std::atomic<int> calls = 0;
+        CHECK_THROWS(pool.parallel_for(1000, 1, [&calls](size_t begin, size_t) {
+            ++calls;
+            if (begin % 100 == 7) {
+                throw std::runtime_error("chunk failed");
+            }
+        }));
+        CHECK(calls.load() < 1000);
+        sum = 0;
+        pool.parallel_for(100, 1, [&sum](size_t begin, size_t end) { sum += end - begin; });
+        CHECK(sum.load() == 100);
+
+        // nested loops on the same pool run inline instead of waiting on themselves
+        sum = 0;
+        pool.parallel_for(8, 1, [&pool, &sum](size_t, size_t) {
+            pool.parallel_for(100, 7, [&sum](size_t begin, size_t end) { sum += end - begin; });
+        });
+        CHECK(sum.load() == 800);
+        CHECK_THROWS(pool.parallel_for(4, 1, [&pool](size_t, size_t) {
+            pool.parallel_for(10, 1, [](size_t, size_t) { throw std::runtime_error("inner failed"); });
+        }));
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <bit>
+
+#include "doctest/doctest.h"
+
+#include "pimpl/truth_table.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define PIMPL_X86_DISPATCH 1
+#else
+#define PIMPL_X86_DISPATCH 0
+#endif
+
+namespace pimpl
+{
+
+namespace
+{
+
+// Bit patterns of the first six symbols within a word of the truth table
+constexpr uint64_t ROW_PATTERNS[6] = {
+    0xaaaaaaaaaaaaaaaaull,
+    0xccccccccccccccccull,
+    0xf0f0f0f0f0f0f0f0ull,
+    0xff00ff00ff00ff00ull,
+    0xffff0000ffff0000ull,
+    0xffffffff00000000ull,
+};
+
+// The evaluation loop, W words per node
+// Always inlined so that each wrapper below is compiled for its own instruction set
+template <size_t W>
+inline __attribute__((always_inline)) void run_kernel(
+    const NodeStore::Node* code, size_t n, const uint64_t* symbols, uint64_t* values)
+{
+    using Kind = NodeStore::Kind;
+
+    for (size_t i = 0; i < n; ++i) {
+        const NodeStore::Node node = code[i];
+        uint64_t* out = values + i * W;
+        switch (node.kind) {
+            case Kind::SYMBOL: {
+                const uint64_t* s = symbols + size_t(node.left) * W;
+                for (size_t w = 0; w < W; ++w) out[w] = s[w];
+                break;
+            }
+            case Kind::BOOL: {
+                const uint64_t v = node.left ? ~0ull : 0ull;
+                for (size_t w = 0; w < W; ++w) out[w] = v;
+                break;
+            }
+            case Kind::NOT: {
+                const uint64_t* r = values + size_t(node.left) * W;
+                for (size_t w = 0; w < W; ++w) out[w] = ~r[w];
+                break;
+            }
+            case Kind::AND: {
+                const uint64_t* l = values + size_t(node.left) * W;
+                const uint64_t* r = values + size_t(node.right) * W;
+                for (size_t w = 0; w < W; ++w) out[w] = l[w] & r[w];
+                break;
+            }
+            case Kind::OR: {
+                const uint64_t* l = values + size_t(node.left) * W;
+                const uint64_t* r = values + size_t(node.right) * W;
+                for (size_t w = 0; w < W; ++w) out[w] = l[w] | r[w];
+                break;
+            }
+            case Kind::IMP: {
+                const uint64_t* l = values + size_t(node.left) * W;
+                const uint64_t* r = values + size_t(node.right) * W;
+                for (size_t w = 0; w < W; ++w) out[w] = ~l[w] | r[w];
+                break;
+            }
+            case Kind::IFF: {
+                const uint64_t* l = values + size_t(node.left) * W;
+                const uint64_t* r = values + size_t(node.right) * W;
+                for (size_t w = 0; w < W; ++w) out[w] = ~(l[w] ^ r[w]);
+                break;
+            }
+        }
+    }
+}
+
+void kernel_scalar(const NodeStore::Node* code, size_t n, const uint64_t* symbols, uint64_t* values)
+{
+    run_kernel<1>(code, n, symbols, values);
+}
+
+#if PIMPL_X86_DISPATCH
+__attribute__((target("avx2")))
+void kernel_avx2(const NodeStore::Node* code, size_t n, const uint64_t* symbols, uint64_t* values)
+{
+    run_kernel<4>(code, n, symbols, values);
+}
+
+__attribute__((target("avx512f")))
+void kernel_avx512(const NodeStore::Node* code, size_t n, const uint64_t* symbols, uint64_t* values)
+{
+    run_kernel<8>(code, n, symbols, values);
+}
+#endif
+
+}   // namespace
+
+BitSliceEvaluator::BitSliceEvaluator(const Sentence& sentence)
+    : symbols_(sentence.symbol_names())
+{
+    NodeStore store;
+    auto root = store.add(sentence);
+    if (!root) {
+        return;
+    }
+
+    // the root is the last node added, and every node in the store is reachable from it
+    code_.reserve(*root + 1);
+    for (NodeStore::node_id_t id = 0; id <= *root; ++id) {
+        code_.push_back(store[id]);
+    }
+}
+
+BitSliceEvaluator::Isa BitSliceEvaluator::detected_isa()
+{
+    static const Isa isa = [] {
+#if PIMPL_X86_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return Isa::AVX512;
+        if (__builtin_cpu_supports("avx2")) return Isa::AVX2;
+#endif
+        return Isa::SCALAR;
+    }();
+    return isa;
+}
+
+void BitSliceEvaluator::use_isa(Isa isa)
+{
+    isa_ = std::min(isa, detected_isa());
+}
+
+size_t BitSliceEvaluator::words_per_pass() const
+{
+    switch (isa_) {
+        case Isa::AVX512: return 8;
+        case Isa::AVX2: return 4;
+        default: return 1;
+    }
+}
+
+BitSliceEvaluator::kernel_t BitSliceEvaluator::kernel() const
+{
+#if PIMPL_X86_DISPATCH
+    switch (isa_) {
+        case Isa::AVX512: return kernel_avx512;
+        case Isa::AVX2: return kernel_avx2;
+        default: break;
+    }
+#endif
+    return kernel_scalar;
+}
+
+bool BitSliceEvaluator::evaluate(std::span<const uint64_t> symbol_words, std::span<uint64_t> out) const
+{
+    const size_t words = out.size();
+    if (!valid() || symbol_words.size() != symbols_.size() * words) {
+        return false;
+    }
+
+    const size_t W = words_per_pass();
+    const auto run = kernel();
+    std::vector<uint64_t> pass_symbols(symbols_.size() * W);
+    std::vector<uint64_t> scratch(code_.size() * W);
+    const uint64_t* root = scratch.data() + (code_.size() - 1) * W;
+
+    for (size_t first = 0; first < words; first += W) {
+        const size_t count = std::min(W, words - first);
+        for (size_t s = 0; s < symbols_.size(); ++s) {
+            for (size_t w = 0; w < W; ++w) {
+                pass_symbols[s * W + w] = w < count ? symbol_words[s * words + first + w] : 0;
+            }
+        }
+        run(code_.data(), code_.size(), pass_symbols.data(), scratch.data());
+        std::copy_n(root, count, out.begin() + first);
+    }
+
+    return true;
+}
+
+void BitSliceEvaluator::table_pass(
+    uint64_t word, uint64_t* symbol_words, uint64_t* scratch, uint64_t* out) const
+{
+    const size_t W = words_per_pass();
+    for (size_t s = 0; s < symbols_.size(); ++s) {
+        for (size_t w = 0; w < W; ++w) {
+            symbol_words[s * W + w] = s < 6
+                ? ROW_PATTERNS[s]
+                : (((word + w) >> (s - 6)) & 1 ? ~0ull : 0ull);
+        }
+    }
+    kernel()(code_.data(), code_.size(), symbol_words, scratch);
+    std::copy_n(scratch + (code_.size() - 1) * W, W, out);
+}
+
+bool BitSliceEvaluator::truth_table(uint64_t first_word, std::span<uint64_t> out) const
+{
+    if (!valid() || symbols_.size() > MAX_TABLE_SYMBOLS) {
+        return false;
+    }
+
+    const uint64_t rows = uint64_t(1) << symbols_.size();
+    const uint64_t total_words = (rows + 63) / 64;
+    if (first_word + out.size() > total_words) {
+        return false;
+    }
+
+    const size_t W = words_per_pass();
+    std::vector<uint64_t> symbol_words(symbols_.size() * W);
+    std::vector<uint64_t> scratch(code_.size() * W);
+    std::vector<uint64_t> pass(W);
+
+    for (size_t i = 0; i < out.size(); i += W) {
+        table_pass(first_word + i, symbol_words.data(), scratch.data(), pass.data());
+        std::copy_n(pass.begin(), std::min(W, out.size() - i), out.begin() + i);
+    }
+
+    // fewer than 6 symbols leave part of the only word unused
+    if (rows < 64 && !out.empty()) {
+        out[0] &= (uint64_t(1) << rows) - 1;
+    }
+
+    return true;
+}
+
+std::optional<std::vector<uint64_t>> BitSliceEvaluator::truth_table() const
+{
+    if (!valid() || symbols_.size() > MAX_TABLE_SYMBOLS) {
+        return std::nullopt;
+    }
+
+    std::vector<uint64_t> table(((uint64_t(1) << symbols_.size()) + 63) / 64);
+    truth_table(0, table);
+    return table;
+}
+
+std::optional<uint64_t> BitSliceEvaluator::count_true() const
+{
+    if (!valid() || symbols_.size() > MAX_TABLE_SYMBOLS) {
+        return std::nullopt;
+    }
+
+    const uint64_t rows = uint64_t(1) << symbols_.size();
+    const uint64_t total_words = (rows + 63) / 64;
+    const size_t W = words_per_pass();
+    std::vector<uint64_t> symbol_words(symbols_.size() * W);
+    std::vector<uint64_t> scratch(code_.size() * W);
+    std::vector<uint64_t> pass(W);
+
+    uint64_t count = 0;
+    for (uint64_t word = 0; word < total_words; word += W) {
+        table_pass(word, symbol_words.data(), scratch.data(), pass.data());
+        for (size_t w = 0; w < W && word + w < total_words; ++w) {
+            uint64_t bits = pass[w];
+            if (rows < 64) {
+                bits &= (uint64_t(1) << rows) - 1;
+            }
+            count += std::popcount(bits);
+        }
+    }
+
+    return count;
+}
+
+}   // namespace pimpl
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PIMPL_ENABLE_TESTS
+
+TEST_CASE("BitSliceEvaluator")
+{
+    using namespace pimpl;
+    using Kind = NodeStore::Kind;
+    using s_t = Sentence::sentence_t;
+
+    NodeStore store;
+
+    SUBCASE("malformed sentences") {
+        CHECK(!BitSliceEvaluator(Sentence()).valid());
+        CHECK(!BitSliceEvaluator(Sentence(std::make_shared<s_t>(std::monostate()), {})).valid());
+        CHECK(!BitSliceEvaluator(Sentence(std::make_shared<s_t>("a"), {})).valid());
+        CHECK(BitSliceEvaluator(Sentence()).truth_table() == std::nullopt);
+    }
+
+    SUBCASE("small table") {
+        // a => b, rows are (a, b) = 00, 10, 01, 11
+        auto sentence = store.sentence(
+            store.make_binary(Kind::IMP, store.make_symbol("a"), store.make_symbol("b")));
+        BitSliceEvaluator eval(sentence);
+        REQUIRE(eval.valid());
+        CHECK(eval.truth_table() == std::vector<uint64_t>{0b1101});
+        CHECK(eval.count_true() == 3u);
+    }
+
+    SUBCASE("constant") {
+        BitSliceEvaluator eval(store.sentence(store.make_bool(true)));
+        CHECK(eval.truth_table() == std::vector<uint64_t>{1});
+        CHECK(eval.count_true() == 1u);
+    }
+
+    SUBCASE("matches Sentence::evaluate, for every instruction set") {
+        // parity of 10 symbols xor'ed together through <=>, and'ed with an implication chain
+        std::vector<std::string> names;
+        NodeStore::node_id_t parity = store.make_bool(true);
+        NodeStore::node_id_t chain = store.make_bool(true);
+        for (int i = 0; i < 10; ++i) {
+            names.push_back("s" + std::to_string(i));
+            auto s = store.make_symbol(names.back());
+            parity = store.make_not(store.make_binary(Kind::IFF, parity, s));
+            chain = store.make_binary(Kind::OR, store.make_binary(Kind::IMP, s, chain), store.make_not(s));
+        }
+        auto sentence = store.sentence(store.make_binary(Kind::AND, parity, chain));
+        std::ranges::sort(names);
+
+        for (auto isa : {BitSliceEvaluator::Isa::SCALAR, BitSliceEvaluator::Isa::AVX2,
+                         BitSliceEvaluator::Isa::AVX512}) {
+            BitSliceEvaluator eval(sentence);
+            eval.use_isa(isa);
+            REQUIRE(eval.symbols() == names);
+
+            auto table = eval.truth_table();
+            REQUIRE(table);
+            REQUIRE(table->size() == 16);
+            uint64_t expected_count = 0;
+            for (uint64_t row = 0; row < 1024; row += 37) {
+                std::unordered_map<std::string, bool> values;
+                for (size_t i = 0; i < names.size(); ++i) {
+                    values[names[i]] = (row >> i) & 1;
+                }
+                CHECK(sentence.evaluate(values) == bool(((*table)[row / 64] >> (row % 64)) & 1));
+            }
+            for (auto word : *table) {
+                expected_count += std::popcount(word);
+            }
+            CHECK(eval.count_true() == expected_count);
+            CHECK(expected_count == 512);
+
+            std::vector<uint64_t> slice(5);
+            REQUIRE(eval.truth_table(3, slice));
+            CHECK(std::equal(slice.begin(), slice.end(), table->begin() + 3));
+            CHECK(!eval.truth_table(14, slice));
+        }
+    }
+
+    SUBCASE("arbitrary assignments") {
+        auto sentence = store.sentence(
+            store.make_binary(Kind::OR, store.make_symbol("x"), store.make_not(store.make_symbol("y"))));
+        BitSliceEvaluator eval(sentence);
+        // words for x then y, three words each
+        std::vector<uint64_t> symbol_words = {0xf0, 0x0, 0x1, 0xff, ~0ull, 0x3};
+        std::vector<uint64_t> out(3);
+        REQUIRE(eval.evaluate(symbol_words, out));
+        CHECK(out[0] == (0xf0 | ~0xffull));
+        CHECK(out[1] == 0);
+        CHECK(out[2] == (0x1 | ~0x3ull));
+        CHECK(!eval.evaluate(symbol_words, std::span<uint64_t>(out).first(2)));
+    }
+}
+
+#endif  // PIMPL_ENABLE_TESTS
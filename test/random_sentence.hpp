@@ -0,0 +1,55 @@
+#ifndef __PIMPL__TEST__RANDOM_SENTENCE_HPP__
+#define __PIMPL__TEST__RANDOM_SENTENCE_HPP__
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pimpl/sentence.hpp"
+
+namespace pimpl::test
+{
+
+// Symbol leaves named prefix0, prefix1, ... and the symbol table of a sentence over them
+struct RandomSymbols
+{
+    std::vector<Sentence::sentence_ptr_t> leaves;
+    std::unordered_map<std::string, Sentence::sentence_ptr_t> table;
+};
+
+inline RandomSymbols random_symbols(size_t count, const std::string& prefix = "s")
+{
+    RandomSymbols symbols;
+    for (size_t i = 0; i < count; ++i) {
+        const std::string name = prefix + std::to_string(i);
+        symbols.leaves.push_back(std::make_shared<Sentence::sentence_t>(name));
+        symbols.table.emplace(name, symbols.leaves.back());
+    }
+    return symbols;
+}
+
+// Append ops random operator nodes to pool, each over two entries already in it, and return the last
+// Later nodes reuse earlier ones, so the result is a DAG that shares subtrees
+inline Sentence::sentence_ptr_t grow_random(std::mt19937& rng, std::vector<Sentence::sentence_ptr_t>& pool, int ops)
+{
+    using s_t = Sentence::sentence_t;
+    for (int i = 0; i < ops; ++i) {
+        auto l = pool[rng() % pool.size()];
+        auto r = pool[rng() % pool.size()];
+        switch (rng() % 5) {
+            case 0: pool.push_back(std::make_shared<s_t>(Sentence::Not(l))); break;
+            case 1: pool.push_back(std::make_shared<s_t>(Sentence::And(l, r))); break;
+            case 2: pool.push_back(std::make_shared<s_t>(Sentence::Or(l, r))); break;
+            case 3: pool.push_back(std::make_shared<s_t>(Sentence::Imp(l, r))); break;
+            default: pool.push_back(std::make_shared<s_t>(Sentence::Iff(l, r))); break;
+        }
+    }
+    return pool.back();
+}
+
+}   // namespace pimpl::test
+
+#endif  // __PIMPL__TEST__RANDOM_SENTENCE_HPP__